@@ -227,7 +227,10 @@ bool cdch_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *it
 
 bool cdch_set_config(uint8_t dev_addr, uint8_t itf_num)
 {
-  (void) dev_addr; (void) itf_num;
+  // notify usbh that driver enumeration is complete
+  // itf_num+1 to account for data interface as well
+  usbh_driver_set_config_complete(dev_addr, itf_num+1);
+
   return true;
 }
 
@@ -211,7 +211,7 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint1
 
   //------------- Endpoint Descriptor -------------//
   p_desc = tu_desc_next(p_desc);
-  TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in), 0);
+  TU_ASSERT(usbd_open_edpt_pair_ctx(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in, p_hid), 0);
 
   if ( desc_itf->bInterfaceSubClass == HID_SUBCLASS_BOOT ) p_hid->itf_protocol = desc_itf->bInterfaceProtocol;
 
@@ -385,16 +385,11 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 {
   (void) result;
 
-  uint8_t instance = 0;
-  hidd_interface_t * p_hid = _hidd_itf;
+  // Interface was attached to its endpoints when opened
+  hidd_interface_t * p_hid = (hidd_interface_t *) usbd_edpt_ctx(rhport, ep_addr);
+  TU_ASSERT(p_hid);
 
-  // Identify which interface to use
-  for (instance = 0; instance < CFG_TUD_HID; instance++)
-  {
-    p_hid = &_hidd_itf[instance];
-    if ( (ep_addr == p_hid->ep_out) || (ep_addr == p_hid->ep_in) ) break;
-  }
-  TU_ASSERT(instance < CFG_TUD_HID);
+  uint8_t const instance = (uint8_t) (p_hid - _hidd_itf);
 
   // Sent report successfully
   if (ep_addr == p_hid->ep_in)
@@ -73,6 +73,8 @@
 
 #include "tusb_error.h"   // TODO remove
 #include "tusb_timeout.h" // TODO remove
+#include "tusb_trace.h"
+#include "tusb_log.h"
 
 //--------------------------------------------------------------------+
 // Internal Helper used by Host and Device Stack
@@ -299,6 +301,21 @@ void tu_print_var(uint8_t const* buf, uint32_t bufsize)
 #define TU_LOG_VAR(n, ...)    TU_XSTRCAT3(TU_LOG, n, _VAR)(__VA_ARGS__)
 #define TU_LOG_INT(n, ...)    TU_XSTRCAT3(TU_LOG, n, _INT)(__VA_ARGS__)
 #define TU_LOG_HEX(n, ...)    TU_XSTRCAT3(TU_LOG, n, _HEX)(__VA_ARGS__)
+
+#if CFG_TUSB_DEBUG_DEFERRED
+
+#define TU_LOG_LOCATION()     TU_LOG_DEFERRED("%s: %d:\r\n", __PRETTY_FUNCTION__, __LINE__)
+#define TU_LOG_FAILED()       TU_LOG_DEFERRED("%s: %d: Failed\r\n", __PRETTY_FUNCTION__, __LINE__)
+
+// Log Level 1: Error
+#define TU_LOG1               TU_LOG_DEFERRED
+#define TU_LOG1_MEM(_buf, _count, _indent) tu_log_push_mem(TU_LOG_REC_MEM, (_buf), (_count))
+#define TU_LOG1_VAR(_x)       tu_log_push_mem(TU_LOG_REC_VAR, (_x), sizeof(*(_x)))
+#define TU_LOG1_INT(_x)       TU_LOG_DEFERRED(#_x " = %ld\r\n", (unsigned long) (_x) )
+#define TU_LOG1_HEX(_x)       TU_LOG_DEFERRED(#_x " = %lX\r\n", (unsigned long) (_x) )
+
+#else
+
 #define TU_LOG_LOCATION()     tu_printf("%s: %d:\r\n", __PRETTY_FUNCTION__, __LINE__)
 #define TU_LOG_FAILED()       tu_printf("%s: %d: Failed\r\n", __PRETTY_FUNCTION__, __LINE__)
 
@@ -309,6 +326,8 @@ void tu_print_var(uint8_t const* buf, uint32_t bufsize)
 #define TU_LOG1_INT(_x)       tu_printf(#_x " = %ld\r\n", (unsigned long) (_x) )
 #define TU_LOG1_HEX(_x)       tu_printf(#_x " = %lX\r\n", (unsigned long) (_x) )
 
+#endif
+
 // Log Level 2: Warn
 #if CFG_TUSB_DEBUG >= 2
   #define TU_LOG2             TU_LOG1
@@ -49,8 +49,41 @@ static inline void _ff_unlock(tu_fifo_mutex_t mutex)
 
 #else
 
-#define _ff_lock(_mutex)
-#define _ff_unlock(_mutex)
+#define _ff_lock(_mutex)    do {} while (0)
+#define _ff_unlock(_mutex)  do {} while (0)
+
+#endif
+
+// In SPSC (and MPSC) mode the write and read side only synchronize through the indices: the
+// index owned by the other side is loaded with acquire and the own index is published with
+// release ordering, so items are always visible before the index covering them.
+#if CFG_TUSB_FIFO_SPSC || CFG_TUSB_FIFO_MPSC
+
+#if !defined(__GNUC__)
+  #error "CFG_TUSB_FIFO_SPSC/CFG_TUSB_FIFO_MPSC require GCC compatible __atomic builtins"
+#endif
+
+// writers claim space with 32 bit compare-and-swap on wr_claim, a library call that is not interrupt
+// safe on cores without exclusive access (e.g ARMv6-M)
+#if CFG_TUSB_FIFO_MPSC && !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+  #error "CFG_TUSB_FIFO_MPSC requires lock-free 32 bit atomics, not available on this target (e.g ARMv6-M)"
+#endif
+
+#if CFG_TUSB_FIFO_MPSC && CFG_TUSB_FIFO_WIDE_INDEX
+  #error "CFG_TUSB_FIFO_MPSC packs the write index into 16 bit and does not support CFG_TUSB_FIFO_WIDE_INDEX"
+#endif
+
+#if CFG_TUSB_FIFO_MPSC && CFG_TUSB_FIFO_STATS
+  #error "CFG_TUSB_FIFO_STATS is not supported with CFG_TUSB_FIFO_MPSC"
+#endif
+
+#define _ff_idx_load(_idx)        __atomic_load_n(&(_idx), __ATOMIC_ACQUIRE)
+#define _ff_idx_store(_idx, _v)   __atomic_store_n(&(_idx), (_v), __ATOMIC_RELEASE)
+
+#else
+
+#define _ff_idx_load(_idx)        (_idx)
+#define _ff_idx_store(_idx, _v)   ((_idx) = (_v))
 
 #endif
 
@@ -64,9 +97,24 @@ typedef enum
   TU_FIFO_COPY_CST_FULL_WORDS, ///< Copy from/to a constant source/destination address - required for e.g. STM32 to write into USB hardware FIFO
 } tu_fifo_copy_mode_t;
 
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
+// FIFO has multiple writers, see tu_fifo_config_mpsc()
+TU_ATTR_ALWAYS_INLINE static inline bool _ff_mpsc(tu_fifo_t const* f)
 {
-  if (depth > 0x8000) return false;               // Maximum depth is 2^15 items
+#if CFG_TUSB_FIFO_MPSC
+  return f->mpsc;
+#else
+  (void) f;
+  return false;
+#endif
+}
+
+static bool _ff_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable, bool mpsc)
+{
+  if (depth > TU_FIFO_DEPTH_MAX) return false;    // Maximum depth is half the index space
+
+#if CFG_TUSB_FIFO_POW2_ONLY
+  if (!TU_FIFO_IS_POW2(depth)) return false;
+#endif
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
@@ -75,14 +123,26 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   f->depth  = depth;
   f->item_size = item_size;
   f->overwritable = overwritable;
+  f->pow2 = TU_FIFO_IS_POW2(depth);
 
   // Limit index space to 2*depth - this allows for a fast "modulo" calculation
-  // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
+  // but limits the maximum depth to half the index space and buffer overflows are detectable
   // only if overflow happens once (important for unsupervised DMA applications)
   f->max_pointer_idx = 2*depth - 1;
-  f->non_used_index_space = UINT16_MAX - f->max_pointer_idx;
+  f->non_used_index_space = TU_FIFO_IDX_MAX - f->max_pointer_idx;
 
   f->rd_idx = f->wr_idx = 0;
+  f->wr_reserved = f->rd_acquired = 0;
+#if CFG_TUSB_FIFO_MPSC
+  f->mpsc = mpsc;
+  f->wr_claim = 0;
+#else
+  (void) mpsc;
+#endif
+
+#if CFG_TUSB_FIFO_STATS
+  tu_memclr(&f->stats, sizeof(f->stats));
+#endif
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
@@ -90,76 +150,260 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   return true;
 }
 
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable)
+{
+  return _ff_config(f, buffer, depth, item_size, overwritable, false);
+}
+
+#if CFG_TUSB_FIFO_MPSC
+bool tu_fifo_config_mpsc(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size)
+{
+  return _ff_config(f, buffer, depth, item_size, false, true);
+}
+#endif
+
 // Static functions are intended to work on local variables
-static inline uint16_t _ff_mod(uint16_t idx, uint16_t depth)
+TU_ATTR_ALWAYS_INLINE static inline tu_fifo_idx_t _ff_min(tu_fifo_idx_t x, tu_fifo_idx_t y)
+{
+  return (x < y) ? x : y;
+}
+
+static inline tu_fifo_idx_t _ff_mod(tu_fifo_idx_t idx, tu_fifo_idx_t depth)
 {
   while ( idx >= depth) idx -= depth;
   return idx;
 }
 
-// Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
-// Code adapted from dcd_synopsis.c
-// TODO generalize with configurable 1 byte or 4 byte each read
-static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t len)
+// With a power-of-two depth the index space 2*depth divides the range of tu_fifo_idx_t, so all pointer
+// arithmetic reduces to masking and the non_used_index_space correction is not needed
+TU_ATTR_ALWAYS_INLINE static inline bool _ff_pow2(tu_fifo_t* f)
 {
-  volatile const uint32_t * rx_fifo = (volatile const uint32_t *) app_buf;
+#if CFG_TUSB_FIFO_POW2_ONLY
+  (void) f;
+  return true;
+#else
+  return f->pow2;
+#endif
+}
+
+//--------------------------------------------------------------------+
+// Hardware FIFO access
+//--------------------------------------------------------------------+
 
-  // Reading full available 32 bit words from const app address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+void tu_hwfifo_write32(volatile uint32_t * reg, void const * src, uint32_t len)
+{
+  uint8_t const * src8 = (uint8_t const *) src;
+  uint32_t full_words = len >> 2;
+
+  if ( ((uintptr_t) src8 & 0x03) == 0 )
+  {
+    uint32_t const * src32 = (uint32_t const *) src;
+
+    while (full_words >= 4)
+    {
+      *reg = src32[0];
+      *reg = src32[1];
+      *reg = src32[2];
+      *reg = src32[3];
+      src32 += 4;
+      full_words -= 4;
+    }
+    while (full_words--) *reg = *src32++;
+
+    src8 = (uint8_t const *) src32;
+  }
+  else
   {
-    tu_unaligned_write32(ff_buf, *rx_fifo);
-    ff_buf += 4;
+    while (full_words--)
+    {
+      *reg = tu_unaligned_read32(src8);
+      src8 += 4;
+    }
   }
 
-  // Read the remaining 1-3 bytes from const app address
+  // Write the remaining 1-3 bytes as one word
   uint8_t const bytes_rem = len & 0x03;
   if ( bytes_rem )
   {
-    uint32_t tmp32 = *rx_fifo;
-    memcpy(ff_buf, &tmp32, bytes_rem);
+    uint32_t tmp32 = src8[0];
+    if ( bytes_rem > 1 ) tmp32 |= ((uint32_t) src8[1]) << 8;
+    if ( bytes_rem > 2 ) tmp32 |= ((uint32_t) src8[2]) << 16;
+
+    *reg = tmp32;
   }
 }
 
-// Intended to be used to write to hardware USB FIFO in e.g. STM32
-// where all data is written to a constant address in full word copies
-static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t len)
+void tu_hwfifo_read32(volatile const uint32_t * reg, void * dst, uint32_t len)
 {
-  volatile uint32_t * tx_fifo = (volatile uint32_t *) app_buf;
+  uint8_t * dst8 = (uint8_t *) dst;
+  uint32_t full_words = len >> 2;
 
-  // Pushing full available 32 bit words to const app address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+  if ( ((uintptr_t) dst8 & 0x03) == 0 )
+  {
+    uint32_t * dst32 = (uint32_t *) dst;
+
+    while (full_words >= 4)
+    {
+      dst32[0] = *reg;
+      dst32[1] = *reg;
+      dst32[2] = *reg;
+      dst32[3] = *reg;
+      dst32 += 4;
+      full_words -= 4;
+    }
+    while (full_words--) *dst32++ = *reg;
+
+    dst8 = (uint8_t *) dst32;
+  }
+  else
   {
-    *tx_fifo = tu_unaligned_read32(ff_buf);
-    ff_buf += 4;
+    while (full_words--)
+    {
+      tu_unaligned_write32(dst8, *reg);
+      dst8 += 4;
+    }
   }
 
-  // Write the remaining 1-3 bytes into const app address
+  // Read the remaining 1-3 bytes from one word
   uint8_t const bytes_rem = len & 0x03;
   if ( bytes_rem )
   {
-    uint32_t tmp32 = 0;
-    memcpy(&tmp32, ff_buf, bytes_rem);
+    uint32_t const tmp32 = *reg;
+    dst8[0] = tu_u32_byte0(tmp32);
+    if ( bytes_rem > 1 ) dst8[1] = tu_u32_byte1(tmp32);
+    if ( bytes_rem > 2 ) dst8[2] = tu_u32_byte2(tmp32);
+  }
+}
+
+void tu_hwfifo_write16(volatile uint16_t * reg, void const * src, uint32_t len)
+{
+  uint8_t const * src8 = (uint8_t const *) src;
+  uint32_t half_words = len >> 1;
 
-    *tx_fifo = tmp32;
+  if ( ((uintptr_t) src8 & 0x01) == 0 )
+  {
+    uint16_t const * src16 = (uint16_t const *) src;
+
+    while (half_words >= 4)
+    {
+      *reg = src16[0];
+      *reg = src16[1];
+      *reg = src16[2];
+      *reg = src16[3];
+      src16 += 4;
+      half_words -= 4;
+    }
+    while (half_words--) *reg = *src16++;
+
+    src8 = (uint8_t const *) src16;
   }
+  else
+  {
+    while (half_words--)
+    {
+      *reg = tu_unaligned_read16(src8);
+      src8 += 2;
+    }
+  }
+
+  // Write the remaining byte as one half word
+  if ( len & 0x01 ) *reg = src8[0];
+}
+
+void tu_hwfifo_read16(volatile const uint16_t * reg, void * dst, uint32_t len)
+{
+  uint8_t * dst8 = (uint8_t *) dst;
+  uint32_t half_words = len >> 1;
+
+  if ( ((uintptr_t) dst8 & 0x01) == 0 )
+  {
+    uint16_t * dst16 = (uint16_t *) dst;
+
+    while (half_words >= 4)
+    {
+      dst16[0] = *reg;
+      dst16[1] = *reg;
+      dst16[2] = *reg;
+      dst16[3] = *reg;
+      dst16 += 4;
+      half_words -= 4;
+    }
+    while (half_words--) *dst16++ = *reg;
+
+    dst8 = (uint8_t *) dst16;
+  }
+  else
+  {
+    while (half_words--)
+    {
+      tu_unaligned_write16(dst8, *reg);
+      dst8 += 2;
+    }
+  }
+
+  // Read the remaining byte from one half word
+  if ( len & 0x01 ) dst8[0] = tu_u16_low(*reg);
+}
+
+void tu_hwfifo_write8(volatile uint8_t * reg, void const * src, uint32_t len)
+{
+  uint8_t const * src8 = (uint8_t const *) src;
+
+  while (len >= 4)
+  {
+    *reg = src8[0];
+    *reg = src8[1];
+    *reg = src8[2];
+    *reg = src8[3];
+    src8 += 4;
+    len -= 4;
+  }
+  while (len--) *reg = *src8++;
+}
+
+void tu_hwfifo_read8(volatile const uint8_t * reg, void * dst, uint32_t len)
+{
+  uint8_t * dst8 = (uint8_t *) dst;
+
+  while (len >= 4)
+  {
+    dst8[0] = *reg;
+    dst8[1] = *reg;
+    dst8[2] = *reg;
+    dst8[3] = *reg;
+    dst8 += 4;
+    len -= 4;
+  }
+  while (len--) *dst8++ = *reg;
+}
+
+// Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
+static inline void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint32_t len)
+{
+  tu_hwfifo_read32((volatile const uint32_t *) app_buf, ff_buf, len);
+}
+
+// Intended to be used to write to hardware USB FIFO in e.g. STM32
+// where all data is written to a constant address in full word copies
+static inline void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint32_t len)
+{
+  tu_hwfifo_write32((volatile uint32_t *) app_buf, ff_buf, len);
 }
 
 // send one item to FIFO WITHOUT updating write pointer
-static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
+static inline void _ff_push(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(f->buffer + (rel * f->item_size), app_buf, f->item_size);
 }
 
 // send n items to FIFO WITHOUT updating write pointer
-static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t rel, tu_fifo_copy_mode_t copy_mode)
+static void _ff_push_n(tu_fifo_t* f, void const * app_buf, tu_fifo_idx_t n, tu_fifo_idx_t rel, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const nLin = f->depth - rel;
-  uint16_t const nWrap = n - nLin;
+  tu_fifo_idx_t const nLin = f->depth - rel;
+  tu_fifo_idx_t const nWrap = n - nLin;
 
-  uint16_t nLin_bytes = nLin * f->item_size;
-  uint16_t nWrap_bytes = nWrap * f->item_size;
+  uint32_t nLin_bytes = (uint32_t) nLin * f->item_size;
+  uint32_t nWrap_bytes = (uint32_t) nWrap * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rel * f->item_size);
@@ -196,7 +440,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         // Wrap around case
 
         // Write full words to linear part of buffer
-        uint16_t nLin_4n_bytes = nLin_bytes & 0xFFFC;
+        uint32_t nLin_4n_bytes = nLin_bytes & 0xFFFFFFFCu;
         _ff_push_const_addr(ff_buf, app_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -205,7 +449,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         uint8_t rem = nLin_bytes & 0x03;
         if (rem > 0)
         {
-          uint8_t remrem = tu_min16(nWrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(nWrap_bytes, 4-rem);
           nWrap_bytes -= remrem;
 
           uint32_t tmp32 = *rx_fifo;
@@ -231,19 +475,19 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
 }
 
 // get one item from FIFO WITHOUT updating read pointer
-static inline void _ff_pull(tu_fifo_t* f, void * app_buf, uint16_t rel)
+static inline void _ff_pull(tu_fifo_t* f, void * app_buf, tu_fifo_idx_t rel)
 {
   memcpy(app_buf, f->buffer + (rel * f->item_size), f->item_size);
 }
 
 // get n items from FIFO WITHOUT updating read pointer
-static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu_fifo_copy_mode_t copy_mode)
+static void _ff_pull_n(tu_fifo_t* f, void* app_buf, tu_fifo_idx_t n, tu_fifo_idx_t rel, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const nLin = f->depth - rel;
-  uint16_t const nWrap = n - nLin; // only used if wrapped
+  tu_fifo_idx_t const nLin = f->depth - rel;
+  tu_fifo_idx_t const nWrap = n - nLin; // only used if wrapped
 
-  uint16_t nLin_bytes = nLin * f->item_size;
-  uint16_t nWrap_bytes = nWrap * f->item_size;
+  uint32_t nLin_bytes = (uint32_t) nLin * f->item_size;
+  uint32_t nWrap_bytes = (uint32_t) nWrap * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rel * f->item_size);
@@ -279,7 +523,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
         // Wrap around case
 
         // Read full words from linear part of buffer
-        uint16_t nLin_4n_bytes = nLin_bytes & 0xFFFC;
+        uint32_t nLin_4n_bytes = nLin_bytes & 0xFFFFFFFCu;
         _ff_pull_const_addr(app_buf, ff_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -288,7 +532,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
         uint8_t rem = nLin_bytes & 0x03;
         if (rem > 0)
         {
-          uint8_t remrem = tu_min16(nWrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) tu_min32(nWrap_bytes, 4-rem);
           nWrap_bytes -= remrem;
 
           uint32_t tmp32=0;
@@ -318,12 +562,14 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rel, tu
 }
 
 // Advance an absolute pointer
-static uint16_t advance_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
+static tu_fifo_idx_t advance_pointer(tu_fifo_t* f, tu_fifo_idx_t p, tu_fifo_idx_t offset)
 {
+  if (_ff_pow2(f)) return (tu_fifo_idx_t) (p + offset) & f->max_pointer_idx;
+
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  if ((p > (uint16_t)(p + offset)) || ((uint16_t)(p + offset) > f->max_pointer_idx))
+  if ((p > (tu_fifo_idx_t)(p + offset)) || ((tu_fifo_idx_t)(p + offset) > f->max_pointer_idx))
   {
     p = (p + offset) + f->non_used_index_space;
   }
@@ -335,12 +581,14 @@ static uint16_t advance_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
 }
 
 // Backward an absolute pointer
-static uint16_t backward_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
+static tu_fifo_idx_t backward_pointer(tu_fifo_t* f, tu_fifo_idx_t p, tu_fifo_idx_t offset)
 {
+  if (_ff_pow2(f)) return (tu_fifo_idx_t) (p - offset) & f->max_pointer_idx;
+
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  if ((p < (uint16_t)(p - offset)) || ((uint16_t)(p - offset) > f->max_pointer_idx))
+  if ((p < (tu_fifo_idx_t)(p - offset)) || ((tu_fifo_idx_t)(p - offset) > f->max_pointer_idx))
   {
     p = (p - offset) - f->non_used_index_space;
   }
@@ -352,15 +600,19 @@ static uint16_t backward_pointer(tu_fifo_t* f, uint16_t p, uint16_t offset)
 }
 
 // get relative from absolute pointer
-static uint16_t get_relative_pointer(tu_fifo_t* f, uint16_t p)
+static tu_fifo_idx_t get_relative_pointer(tu_fifo_t* f, tu_fifo_idx_t p)
 {
+  if (_ff_pow2(f)) return p & (f->depth - 1);
+
   return _ff_mod(p, f->depth);
 }
 
 // Works on local copies of w and r - return only the difference and as such can be used to determine an overflow
-static inline uint16_t _tu_fifo_count(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline tu_fifo_idx_t _tu_fifo_count(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
-  uint16_t cnt = wAbs-rAbs;
+  if (_ff_pow2(f)) return (tu_fifo_idx_t) (wAbs - rAbs) & f->max_pointer_idx;
+
+  tu_fifo_idx_t cnt = wAbs-rAbs;
 
   // In case we have non-power of two depth we need a further modification
   if (rAbs > wAbs) cnt -= f->non_used_index_space;
@@ -369,13 +621,13 @@ static inline uint16_t _tu_fifo_count(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs
 }
 
 // Works on local copies of w and r
-static inline bool _tu_fifo_empty(uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_empty(tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return wAbs == rAbs;
 }
 
 // Works on local copies of w and r
-static inline bool _tu_fifo_full(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_full(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return (_tu_fifo_count(f, wAbs, rAbs) == f->depth);
 }
@@ -386,23 +638,23 @@ static inline bool _tu_fifo_full(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
 // write more than 2*depth-1 items in one rush without updating write pointer. Otherwise
 // write pointer wraps and you pointer states are messed up. This can only happen if you
 // use DMAs, write functions do not allow such an error.
-static inline bool _tu_fifo_overflowed(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline bool _tu_fifo_overflowed(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return (_tu_fifo_count(f, wAbs, rAbs) > f->depth);
 }
 
 // Works on local copies of w
 // For more details see _tu_fifo_overflow()!
-static inline void _tu_fifo_correct_read_pointer(tu_fifo_t* f, uint16_t wAbs)
+static inline void _tu_fifo_correct_read_pointer(tu_fifo_t* f, tu_fifo_idx_t wAbs)
 {
-  f->rd_idx = backward_pointer(f, wAbs, f->depth);
+  _ff_idx_store(f->rd_idx, backward_pointer(f, wAbs, f->depth));
 }
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t rAbs)
+static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
-  uint16_t cnt = _tu_fifo_count(f, wAbs, rAbs);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, wAbs, rAbs);
 
   // Check overflow and correct if required
   if (cnt > f->depth)
@@ -414,7 +666,7 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t
   // Skip beginning of buffer
   if (cnt == 0) return false;
 
-  uint16_t rRel = get_relative_pointer(f, rAbs);
+  tu_fifo_idx_t rRel = get_relative_pointer(f, rAbs);
 
   // Peek data
   _ff_pull(f, p_buffer, rRel);
@@ -424,15 +676,15 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wAbs, uint16_t
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint16_t wAbs, uint16_t rAbs, tu_fifo_copy_mode_t copy_mode)
+static tu_fifo_idx_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t cnt = _tu_fifo_count(f, wAbs, rAbs);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, wAbs, rAbs);
 
   // Check overflow and correct if required
   if (cnt > f->depth)
   {
     _tu_fifo_correct_read_pointer(f, wAbs);
-    rAbs = f->rd_idx;
+    rAbs = _ff_idx_load(f->rd_idx);
     cnt = f->depth;
   }
 
@@ -442,7 +694,7 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   // Check if we can read something at and after offset - if too less is available we read what remains
   if (cnt < n) n = cnt;
 
-  uint16_t rRel = get_relative_pointer(f, rAbs);
+  tu_fifo_idx_t rRel = get_relative_pointer(f, rAbs);
 
   // Peek data
   _ff_pull_n(f, p_buffer, n, rRel, copy_mode);
@@ -451,24 +703,140 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
 }
 
 // Works on local copies of w and r
-static inline uint16_t _tu_fifo_remaining(tu_fifo_t* f, uint16_t wAbs, uint16_t rAbs)
+static inline tu_fifo_idx_t _tu_fifo_remaining(tu_fifo_t* f, tu_fifo_idx_t wAbs, tu_fifo_idx_t rAbs)
 {
   return f->depth - _tu_fifo_count(f, wAbs, rAbs);
 }
 
-static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+#if CFG_TUSB_FIFO_MPSC
+// Writers first claim space by advancing the claimed index in wr_claim, which also counts
+// the writers still copying. The last writer to finish publishes the claimed index to
+// wr_idx, so the reader never sees a slot that is not completely written. Both steps are
+// compare-and-swap loops that only retry when another writer made progress, hence an ISR
+// preempting a writer never waits for it.
+#define _FF_CLAIM_IDX(_c)       ((tu_fifo_idx_t) ((_c) & 0xFFFFu))
+#define _FF_CLAIM_PENDING(_c)   ((_c) >> 16)
+#define _FF_CLAIM_ONE           (1ul << 16)
+
+// Claim up to n items (exactly n if all is set), returns number of items claimed and
+// their absolute start index in w
+static tu_fifo_idx_t _ff_mp_claim(tu_fifo_t* f, tu_fifo_idx_t n, bool all, tu_fifo_idx_t* w)
+{
+  uint32_t c = __atomic_load_n(&f->wr_claim, __ATOMIC_RELAXED);
+  uint32_t next;
+  tu_fifo_idx_t cnt;
+
+  do
+  {
+    *w = _FF_CLAIM_IDX(c);
+
+    tu_fifo_idx_t const used = _tu_fifo_count(f, *w, _ff_idx_load(f->rd_idx));
+    tu_fifo_idx_t const free = (used >= f->depth) ? 0 : (f->depth - used);
+
+    if ( all && (n > free) ) return 0;
+    cnt = _ff_min(n, free);
+    if ( cnt == 0 ) return 0;
+
+    next = advance_pointer(f, *w, cnt) | ((_FF_CLAIM_PENDING(c) + 1) << 16);
+  } while ( !__atomic_compare_exchange_n(&f->wr_claim, &c, next, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+
+  return cnt;
+}
+
+// Mark own claim as written and publish all claims if no other writer is still copying
+static void _ff_mp_publish(tu_fifo_t* f)
+{
+  uint32_t const c = __atomic_sub_fetch(&f->wr_claim, _FF_CLAIM_ONE, __ATOMIC_ACQ_REL);
+  if ( _FF_CLAIM_PENDING(c) ) return;
+
+  // A later writer may already have published further, wr_idx must only move forward.
+  // Compare distances from the read index, which neither index can be behind of.
+  tu_fifo_idx_t const target = _FF_CLAIM_IDX(c);
+  tu_fifo_idx_t const r      = _ff_idx_load(f->rd_idx);
+  tu_fifo_idx_t cur          = __atomic_load_n(&f->wr_idx, __ATOMIC_RELAXED);
+
+  while ( _tu_fifo_count(f, target, r) > _tu_fifo_count(f, cur, r) )
+  {
+    if ( __atomic_compare_exchange_n(&f->wr_idx, &cur, target, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED) ) break;
+  }
+}
+#endif
+
+// Account a write of n out of requested items into a FIFO holding cnt items. Items beyond
+// depth are lost either way: rejected when not overwritable, overwritten otherwise.
+TU_ATTR_ALWAYS_INLINE static inline void _ff_stats_write(tu_fifo_t* f, tu_fifo_idx_t cnt, tu_fifo_idx_t requested, tu_fifo_idx_t n)
+{
+#if CFG_TUSB_FIFO_STATS
+  uint32_t const cnt32 = _ff_min(cnt, f->depth);
+
+  if (cnt32 + requested > f->depth) f->stats.overflow += cnt32 + requested - f->depth;
+
+  tu_fifo_idx_t const level = (tu_fifo_idx_t) tu_min32(cnt32 + n, f->depth);
+  if (level > f->stats.high_water) f->stats.high_water = level;
+
+  f->stats.bytes_written += (uint32_t) n * f->item_size;
+#else
+  (void) f; (void) cnt; (void) requested; (void) n;
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void _ff_stats_read(tu_fifo_t* f, tu_fifo_idx_t requested, tu_fifo_idx_t n)
+{
+#if CFG_TUSB_FIFO_STATS
+  if (n < requested) f->stats.underrun++;
+  f->stats.bytes_read += (uint32_t) n * f->item_size;
+#else
+  (void) f; (void) requested; (void) n;
+#endif
+}
+
+// Describe n items starting at relative pointer rel as linear and wrapped part
+static void _ff_buffer_info(tu_fifo_t* f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t rel, tu_fifo_idx_t n)
+{
+  if (n == 0)
+  {
+    info->len_lin  = 0;
+    info->len_wrap = 0;
+    info->ptr_lin  = NULL;
+    info->ptr_wrap = NULL;
+    return;
+  }
+
+  info->len_lin  = _ff_min(n, f->depth - rel);
+  info->len_wrap = n - info->len_lin;
+  info->ptr_lin  = f->buffer + (rel * f->item_size);
+  info->ptr_wrap = info->len_wrap ? f->buffer : NULL;
+}
+
+static tu_fifo_idx_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   if ( n == 0 ) return 0;
 
+#if CFG_TUSB_FIFO_MPSC
+  if ( f->mpsc )
+  {
+    tu_fifo_idx_t wClaim;
+    n = _ff_mp_claim(f, n, false, &wClaim);
+    if ( n == 0 ) return 0;
+
+    _ff_push_n(f, data, n, get_relative_pointer(f, wClaim), copy_mode);
+    _ff_mp_publish(f);
+
+    return n;
+  }
+#endif
+
   _ff_lock(f->mutex_wr);
 
-  uint16_t w = f->wr_idx, r = f->rd_idx;
+  tu_fifo_idx_t w = _ff_idx_load(f->wr_idx), r = _ff_idx_load(f->rd_idx);
   uint8_t const* buf8 = (uint8_t const*) data;
+  tu_fifo_idx_t const requested = n;
+  tu_fifo_idx_t const cnt = _tu_fifo_count(f, w, r);
 
   if (!f->overwritable)
   {
     // Not overwritable limit up to full
-    n = tu_min16(n, _tu_fifo_remaining(f, w, r));
+    n = _ff_min(n, _tu_fifo_remaining(f, w, r));
   }
   else if (n >= f->depth)
   {
@@ -482,29 +850,32 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     w = r;
   }
 
-  uint16_t wRel = get_relative_pointer(f, w);
+  tu_fifo_idx_t wRel = get_relative_pointer(f, w);
 
   // Write data
   _ff_push_n(f, buf8, n, wRel, copy_mode);
 
   // Advance pointer
-  f->wr_idx = advance_pointer(f, w, n);
+  _ff_idx_store(f->wr_idx, advance_pointer(f, w, n));
+  _ff_stats_write(f, cnt, requested, n);
 
   _ff_unlock(f->mutex_wr);
 
   return n;
 }
 
-static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+static tu_fifo_idx_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n, tu_fifo_copy_mode_t copy_mode)
 {
   _ff_lock(f->mutex_rd);
 
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
-  n = _tu_fifo_peek_n(f, buffer, n, f->wr_idx, f->rd_idx, copy_mode);
+  tu_fifo_idx_t const requested = n;
+  n = _tu_fifo_peek_n(f, buffer, n, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx), copy_mode);
 
   // Advance read pointer
-  f->rd_idx = advance_pointer(f, f->rd_idx, n);
+  _ff_idx_store(f->rd_idx, advance_pointer(f, _ff_idx_load(f->rd_idx), n));
+  _ff_stats_read(f, requested, n);
 
   _ff_unlock(f->mutex_rd);
   return n;
@@ -525,9 +896,9 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_count(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_count(tu_fifo_t* f)
 {
-  return tu_min16(_tu_fifo_count(f, f->wr_idx, f->rd_idx), f->depth);
+  return _ff_min(_tu_fifo_count(f, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx)), f->depth);
 }
 
 /******************************************************************************/
@@ -545,7 +916,7 @@ uint16_t tu_fifo_count(tu_fifo_t* f)
 /******************************************************************************/
 bool tu_fifo_empty(tu_fifo_t* f)
 {
-  return _tu_fifo_empty(f->wr_idx, f->rd_idx);
+  return _tu_fifo_empty(_ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
 }
 
 /******************************************************************************/
@@ -563,7 +934,7 @@ bool tu_fifo_empty(tu_fifo_t* f)
 /******************************************************************************/
 bool tu_fifo_full(tu_fifo_t* f)
 {
-  return _tu_fifo_full(f, f->wr_idx, f->rd_idx);
+  return _tu_fifo_full(f, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
 }
 
 /******************************************************************************/
@@ -579,9 +950,9 @@ bool tu_fifo_full(tu_fifo_t* f)
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_remaining(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_remaining(tu_fifo_t* f)
 {
-  return _tu_fifo_remaining(f, f->wr_idx, f->rd_idx);
+  return _tu_fifo_remaining(f, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
 }
 
 /******************************************************************************/
@@ -607,14 +978,14 @@ uint16_t tu_fifo_remaining(tu_fifo_t* f)
 /******************************************************************************/
 bool tu_fifo_overflowed(tu_fifo_t* f)
 {
-  return _tu_fifo_overflowed(f, f->wr_idx, f->rd_idx);
+  return _tu_fifo_overflowed(f, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
 }
 
 // Only use in case tu_fifo_overflow() returned true!
 void tu_fifo_correct_read_pointer(tu_fifo_t* f)
 {
   _ff_lock(f->mutex_rd);
-  _tu_fifo_correct_read_pointer(f, f->wr_idx);
+  _tu_fifo_correct_read_pointer(f, _ff_idx_load(f->wr_idx));
   _ff_unlock(f->mutex_rd);
 }
 
@@ -640,10 +1011,11 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
 
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
-  bool ret = _tu_fifo_peek(f, buffer, f->wr_idx, f->rd_idx);
+  bool ret = _tu_fifo_peek(f, buffer, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
 
   // Advance pointer
-  f->rd_idx = advance_pointer(f, f->rd_idx, ret);
+  _ff_idx_store(f->rd_idx, advance_pointer(f, _ff_idx_load(f->rd_idx), ret));
+  _ff_stats_read(f, 1, ret);
 
   _ff_unlock(f->mutex_rd);
   return ret;
@@ -665,16 +1037,75 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
     @returns number of items read from the FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_INC);
 }
 
-uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, tu_fifo_idx_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
 
+/******************************************************************************/
+/*!
+    @brief Read into several segments (e.g. a header and its payload) at once
+
+    Segments are filled in order under one lock with a single read pointer
+    update. If less data is available, the remaining segments are left
+    untouched.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  iov
+                Array of segments to fill, lengths in items
+    @param[in]  iovcnt
+                Number of segments
+
+    @returns Number of items read from the FIFO
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_read_iov(tu_fifo_t* f, tu_fifo_iovec_t const * iov, uint8_t iovcnt)
+{
+  _ff_lock(f->mutex_rd);
+
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx));
+
+  // Check overflow and correct if required
+  if (cnt > f->depth)
+  {
+    _tu_fifo_correct_read_pointer(f, w);
+    cnt = f->depth;
+  }
+
+  tu_fifo_idx_t const r = _ff_idx_load(f->rd_idx);
+  tu_fifo_idx_t rRel = get_relative_pointer(f, r);
+  tu_fifo_idx_t total = 0;
+
+  for(uint8_t i = 0; i < iovcnt && total < cnt; i++)
+  {
+    tu_fifo_idx_t const n = _ff_min(iov[i].len, cnt - total);
+    if ( n == 0 ) continue;
+
+    _ff_pull_n(f, iov[i].buf, n, rRel, TU_FIFO_COPY_INC);
+
+    rRel += n;
+    if ( rRel >= f->depth ) rRel -= f->depth;
+    total += n;
+  }
+
+  _ff_idx_store(f->rd_idx, advance_pointer(f, r, total));
+
+  uint32_t requested = 0;
+  for(uint8_t i = 0; i < iovcnt; i++) requested += iov[i].len;
+  _ff_stats_read(f, (tu_fifo_idx_t) tu_min32(requested, TU_FIFO_IDX_MAX), total);
+
+  _ff_unlock(f->mutex_rd);
+
+  return total;
+}
+
 /******************************************************************************/
 /*!
     @brief Read one item without removing it from the FIFO.
@@ -693,7 +1124,7 @@ uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint1
 bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
 {
   _ff_lock(f->mutex_rd);
-  bool ret = _tu_fifo_peek(f, p_buffer, f->wr_idx, f->rd_idx);
+  bool ret = _tu_fifo_peek(f, p_buffer, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx));
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -713,10 +1144,10 @@ bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
     @returns Number of bytes written to p_buffer
  */
 /******************************************************************************/
-uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
+tu_fifo_idx_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n)
 {
   _ff_lock(f->mutex_rd);
-  uint16_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+  tu_fifo_idx_t ret = _tu_fifo_peek_n(f, p_buffer, n, _ff_idx_load(f->wr_idx), _ff_idx_load(f->rd_idx), TU_FIFO_COPY_INC);
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -739,27 +1170,43 @@ uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
 /******************************************************************************/
 bool tu_fifo_write(tu_fifo_t* f, const void * data)
 {
+#if CFG_TUSB_FIFO_MPSC
+  if ( f->mpsc )
+  {
+    tu_fifo_idx_t wClaim;
+    if ( 0 == _ff_mp_claim(f, 1, true, &wClaim) ) return false;
+
+    _ff_push(f, data, get_relative_pointer(f, wClaim));
+    _ff_mp_publish(f);
+
+    return true;
+  }
+#endif
+
   _ff_lock(f->mutex_wr);
 
   bool ret;
-  uint16_t const w = f->wr_idx;
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  tu_fifo_idx_t const r = _ff_idx_load(f->rd_idx);
 
-  if ( _tu_fifo_full(f, w, f->rd_idx) && !f->overwritable )
+  if ( _tu_fifo_full(f, w, r) && !f->overwritable )
   {
     ret = false;
   }else
   {
-    uint16_t wRel = get_relative_pointer(f, w);
+    tu_fifo_idx_t wRel = get_relative_pointer(f, w);
 
     // Write data
     _ff_push(f, data, wRel);
 
     // Advance pointer
-    f->wr_idx = advance_pointer(f, w, 1);
+    _ff_idx_store(f->wr_idx, advance_pointer(f, w, 1));
 
     ret = true;
   }
 
+  _ff_stats_write(f, _tu_fifo_count(f, w, r), 1, ret);
+
   _ff_unlock(f->mutex_wr);
 
   return ret;
@@ -779,7 +1226,7 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
+tu_fifo_idx_t tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_INC);
 }
@@ -799,11 +1246,87 @@ uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, uint16_t n)
+tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, tu_fifo_idx_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
 
+/******************************************************************************/
+/*!
+    @brief Write several segments (e.g. a header and its payload) as one block
+
+    All segments are written under one lock and become visible with a single
+    write pointer update, so a reader never sees a partial block. If the FIFO
+    is not overwritable and the block does not fit, nothing is written.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  iov
+                Array of segments to write, lengths in items
+    @param[in]  iovcnt
+                Number of segments
+    @return Number of written elements
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_write_iov(tu_fifo_t* f, tu_fifo_iovec_const_t const * iov, uint8_t iovcnt)
+{
+  uint32_t total = 0;
+  for(uint8_t i = 0; i < iovcnt; i++) total += iov[i].len;
+
+  if ( total == 0 || total > f->depth ) return 0;
+
+  bool const mpsc = _ff_mpsc(f);
+  tu_fifo_idx_t w = 0;
+  tu_fifo_idx_t cnt = 0;
+
+  if ( mpsc )
+  {
+#if CFG_TUSB_FIFO_MPSC
+    if ( 0 == _ff_mp_claim(f, (tu_fifo_idx_t) total, true, &w) ) return 0;
+#endif
+  }else
+  {
+    _ff_lock(f->mutex_wr);
+
+    w   = _ff_idx_load(f->wr_idx);
+    cnt = _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx));
+
+    if ( !f->overwritable && (total > _tu_fifo_remaining(f, w, _ff_idx_load(f->rd_idx))) )
+    {
+      _ff_stats_write(f, cnt, (tu_fifo_idx_t) total, 0);
+      _ff_unlock(f->mutex_wr);
+      return 0;
+    }
+  }
+
+  tu_fifo_idx_t wRel = get_relative_pointer(f, w);
+
+  for(uint8_t i = 0; i < iovcnt; i++)
+  {
+    if ( iov[i].len == 0 ) continue;
+
+    _ff_push_n(f, iov[i].buf, iov[i].len, wRel, TU_FIFO_COPY_INC);
+
+    wRel += iov[i].len;
+    if ( wRel >= f->depth ) wRel -= f->depth;
+  }
+
+  if ( mpsc )
+  {
+#if CFG_TUSB_FIFO_MPSC
+    _ff_mp_publish(f);
+#endif
+  }else
+  {
+    _ff_idx_store(f->wr_idx, advance_pointer(f, w, (tu_fifo_idx_t) total));
+    _ff_stats_write(f, cnt, (tu_fifo_idx_t) total, (tu_fifo_idx_t) total);
+
+    _ff_unlock(f->mutex_wr);
+  }
+
+  return (tu_fifo_idx_t) total;
+}
+
 /******************************************************************************/
 /*!
     @brief Clear the fifo read and write pointers
@@ -818,14 +1341,62 @@ bool tu_fifo_clear(tu_fifo_t *f)
   _ff_lock(f->mutex_rd);
 
   f->rd_idx = f->wr_idx = 0;
+  f->wr_reserved = f->rd_acquired = 0;
+#if CFG_TUSB_FIFO_MPSC
+  f->wr_claim = 0;
+#endif
   f->max_pointer_idx = 2*f->depth-1;
-  f->non_used_index_space = UINT16_MAX - f->max_pointer_idx;
+  f->non_used_index_space = TU_FIFO_IDX_MAX - f->max_pointer_idx;
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
   return true;
 }
 
+#if CFG_TUSB_FIFO_STATS
+/******************************************************************************/
+/*!
+    @brief Get a snapshot of the FIFO statistics
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] stats
+                Receives the statistics
+ */
+/******************************************************************************/
+void tu_fifo_get_stats(tu_fifo_t *f, tu_fifo_stats_t *stats)
+{
+  _ff_lock(f->mutex_wr);
+  _ff_lock(f->mutex_rd);
+
+  *stats = f->stats;
+
+  _ff_unlock(f->mutex_wr);
+  _ff_unlock(f->mutex_rd);
+}
+
+/******************************************************************************/
+/*!
+    @brief Reset the FIFO statistics, the high-water mark restarts at the
+    current fill level
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+ */
+/******************************************************************************/
+void tu_fifo_reset_stats(tu_fifo_t *f)
+{
+  _ff_lock(f->mutex_wr);
+  _ff_lock(f->mutex_rd);
+
+  tu_memclr(&f->stats, sizeof(f->stats));
+  f->stats.high_water = tu_fifo_count(f);
+
+  _ff_unlock(f->mutex_wr);
+  _ff_unlock(f->mutex_rd);
+}
+#endif
+
 /******************************************************************************/
 /*!
     @brief Change the fifo mode to overwritable or not overwritable
@@ -838,6 +1409,9 @@ bool tu_fifo_clear(tu_fifo_t *f)
 /******************************************************************************/
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
 {
+  // multiple writers never overwrite
+  if (overwritable && _ff_mpsc(f)) return false;
+
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
 
@@ -865,9 +1439,14 @@ bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
                 Number of items the write pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->wr_idx = advance_pointer(f, f->wr_idx, n);
+  // see tu_fifo_get_write_info()
+  TU_ASSERT(!_ff_mpsc(f), );
+
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  _ff_idx_store(f->wr_idx, advance_pointer(f, w, n));
+  _ff_stats_write(f, _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx)), n, n);
 }
 
 /******************************************************************************/
@@ -886,9 +1465,10 @@ void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
                 Number of items the read pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
+void tu_fifo_advance_read_pointer(tu_fifo_t *f, tu_fifo_idx_t n)
 {
-  f->rd_idx = advance_pointer(f, f->rd_idx, n);
+  _ff_idx_store(f->rd_idx, advance_pointer(f, _ff_idx_load(f->rd_idx), n));
+  _ff_stats_read(f, n, n);
 }
 
 /******************************************************************************/
@@ -909,9 +1489,9 @@ void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
 void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
   // Operate on temporary values in case they change in between
-  uint16_t w = f->wr_idx, r = f->rd_idx;
+  tu_fifo_idx_t w = _ff_idx_load(f->wr_idx), r = _ff_idx_load(f->rd_idx);
 
-  uint16_t cnt = _tu_fifo_count(f, w, r);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, r);
 
   // Check overflow and correct if required - may happen in case a DMA wrote too fast
   if (cnt > f->depth)
@@ -919,40 +1499,11 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
     _ff_lock(f->mutex_rd);
     _tu_fifo_correct_read_pointer(f, w);
     _ff_unlock(f->mutex_rd);
-    r = f->rd_idx;
+    r = _ff_idx_load(f->rd_idx);
     cnt = f->depth;
   }
 
-  // Check if fifo is empty
-  if (cnt == 0)
-  {
-    info->len_lin  = 0;
-    info->len_wrap = 0;
-    info->ptr_lin  = NULL;
-    info->ptr_wrap = NULL;
-    return;
-  }
-
-  // Get relative pointers
-  w = get_relative_pointer(f, w);
-  r = get_relative_pointer(f, r);
-
-  // Copy pointer to buffer to start reading from
-  info->ptr_lin = &f->buffer[r];
-
-  // Check if there is a wrap around necessary
-  if (w > r) {
-    // Non wrapping case
-    info->len_lin  = cnt;
-    info->len_wrap = 0;
-    info->ptr_wrap = NULL;
-  }
-  else
-  {
-    info->len_lin  = f->depth - r;         // Also the case if FIFO was full
-    info->len_wrap = cnt - info->len_lin;
-    info->ptr_wrap = f->buffer;
-  }
+  _ff_buffer_info(f, info, get_relative_pointer(f, r), cnt);
 }
 
 /******************************************************************************/
@@ -972,36 +1523,408 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 /******************************************************************************/
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
-  uint16_t w = f->wr_idx, r = f->rd_idx;
-  uint16_t free = _tu_fifo_remaining(f, w, r);
+  // with multiple writers, writing past tu_fifo_write*() would bypass the index claimed by others
+  if ( _ff_mpsc(f) )
+  {
+    _ff_buffer_info(f, info, 0, 0);
+    TU_ASSERT(false, );
+  }
+
+  tu_fifo_idx_t w = _ff_idx_load(f->wr_idx), r = _ff_idx_load(f->rd_idx);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, r);
+
+  // Nothing is free if FIFO is full or overflowed
+  tu_fifo_idx_t free = (cnt >= f->depth) ? 0 : (f->depth - cnt);
+
+  _ff_buffer_info(f, info, get_relative_pointer(f, w), free);
+}
+
+/******************************************************************************/
+/*!
+   @brief Reserve space for zero-copy writing
+
+   Reserves up to n free items and returns them as a linear and a wrapped part,
+   which the caller may fill directly e.g. by a DMA or a parser. The written items
+   become visible to readers only after tu_fifo_write_commit(). Even an overwritable
+   FIFO only hands out free space here, no unread data gets overwritten.
+
+   On success the write mutex stays locked until tu_fifo_write_commit() is called,
+   which makes the reservation safe against other writers and tu_fifo_clear().
+   Do not call any other write function or tu_fifo_clear() from the same context
+   before committing.
 
-  if (free == 0)
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which receives the reserved spans
+   @param[in]       n
+                    Number of items wanted
+
+   @returns Number of items reserved. If zero, no commit must follow.
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_write_reserve(tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t n)
+{
+  // not available with multiple writers
+  if ( _ff_mpsc(f) )
   {
-    info->len_lin = 0;
-    info->len_wrap = 0;
-    info->ptr_lin = NULL;
-    info->ptr_wrap = NULL;
-    return;
+    _ff_buffer_info(f, info, 0, 0);
+    TU_ASSERT(false, 0);
   }
 
-  // Get relative pointers
-  w = get_relative_pointer(f, w);
-  r = get_relative_pointer(f, r);
+  _ff_lock(f->mutex_wr);
+
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  tu_fifo_idx_t const cnt = _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx));
+  tu_fifo_idx_t const free = (cnt >= f->depth) ? 0 : (f->depth - cnt);
 
-  // Copy pointer to buffer to start writing to
-  info->ptr_lin = &f->buffer[w];
+  n = _ff_min(n, free);
+  _ff_buffer_info(f, info, get_relative_pointer(f, w), n);
+  f->wr_reserved = n;
 
-  if (w < r)
+  if (n == 0) _ff_unlock(f->mutex_wr);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Commit items written into a reservation
+
+   Advances the write pointer by n items (at most the reserved amount) and
+   releases the write mutex taken by tu_fifo_write_reserve(). In case the FIFO
+   was cleared in the meantime (possible only without RTOS), nothing is committed.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items actually written, may be less than reserved
+
+   @returns Number of items committed
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_write_commit(tu_fifo_t *f, tu_fifo_idx_t n)
+{
+  // Nothing reserved: reserve returned zero and the mutex was never held, or fifo got cleared
+  if (f->wr_reserved == 0) return 0;
+
+  n = _ff_min(n, f->wr_reserved);
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  _ff_idx_store(f->wr_idx, advance_pointer(f, w, n));
+  _ff_stats_write(f, _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx)), n, n);
+  f->wr_reserved = 0;
+
+  _ff_unlock(f->mutex_wr);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Acquire data for zero-copy reading
+
+   Acquires up to n items and returns them as a linear and a wrapped part, which
+   the caller may consume directly e.g. by a DMA. The items stay in the FIFO until
+   tu_fifo_read_release(). This function checks for an overflow and corrects read
+   pointer if required. Note that the writer of an overwritable FIFO may still
+   overwrite acquired items.
+
+   On success the read mutex stays locked until tu_fifo_read_release() is called.
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[out]      *info
+                    Pointer to struct which receives the acquired spans
+   @param[in]       n
+                    Number of items wanted
+
+   @returns Number of items acquired. If zero, no release must follow.
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_read_acquire(tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t n)
+{
+  _ff_lock(f->mutex_rd);
+
+  tu_fifo_idx_t const w = _ff_idx_load(f->wr_idx);
+  tu_fifo_idx_t cnt = _tu_fifo_count(f, w, _ff_idx_load(f->rd_idx));
+
+  // Check overflow and correct if required
+  if (cnt > f->depth)
   {
-    // Non wrapping case
-    info->len_lin = r-w;
-    info->len_wrap = 0;
-    info->ptr_wrap = NULL;
+    _tu_fifo_correct_read_pointer(f, w);
+    cnt = f->depth;
+  }
+
+  n = _ff_min(n, cnt);
+  _ff_buffer_info(f, info, get_relative_pointer(f, _ff_idx_load(f->rd_idx)), n);
+  f->rd_acquired = n;
+
+  if (n == 0) _ff_unlock(f->mutex_rd);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+   @brief Release items consumed from an acquired span
+
+   Advances the read pointer by n items (at most the acquired amount) and
+   releases the read mutex taken by tu_fifo_read_acquire().
+
+   @param[in]       f
+                    Pointer to FIFO
+   @param[in]       n
+                    Number of items actually consumed, may be less than acquired
+
+   @returns Number of items released
+ */
+/******************************************************************************/
+tu_fifo_idx_t tu_fifo_read_release(tu_fifo_t *f, tu_fifo_idx_t n)
+{
+  if (f->rd_acquired == 0) return 0;
+
+  n = _ff_min(n, f->rd_acquired);
+  _ff_idx_store(f->rd_idx, advance_pointer(f, _ff_idx_load(f->rd_idx), n));
+  _ff_stats_read(f, n, n);
+  f->rd_acquired = 0;
+
+  _ff_unlock(f->mutex_rd);
+
+  return n;
+}
+
+//--------------------------------------------------------------------+
+// Record FIFO
+//--------------------------------------------------------------------+
+
+// Header value marking the rest of the buffer as skipped, a tail of 1 byte has no room
+// for a header and is always skipped
+#define _FF_RECORD_PAD    0xFFFFu
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t _ff_record_hdr_get(uint8_t const* p)
+{
+  return tu_u16(p[1], p[0]);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void _ff_record_hdr_set(uint8_t* p, uint16_t len)
+{
+  p[0] = tu_u16_low(len);
+  p[1] = tu_u16_high(len);
+}
+
+// Locate the next record in acquired data. Returns pointer to its header and sets the
+// number of bytes to skip in front of it and the record length.
+static uint8_t* _ff_record_locate(tu_fifo_buffer_info_t const* info, uint16_t* skip, uint16_t* len)
+{
+  uint8_t* hdr = (uint8_t*) info->ptr_lin;
+  *skip = 0;
+
+  if ( (info->len_lin < TU_FIFO_RECORD_HDR_SIZE) || (_ff_record_hdr_get(hdr) == _FF_RECORD_PAD) )
+  {
+    // padded tail, record starts at the beginning of the buffer
+    *skip = info->len_lin;
+    hdr   = (uint8_t*) info->ptr_wrap;
+  }
+
+  *len = _ff_record_hdr_get(hdr);
+  return hdr;
+}
+
+/******************************************************************************/
+/*!
+    @brief Reserve contiguous space for a record of up to len bytes
+
+    The FIFO must be configured with item_size 1 and not overwritable. On
+    success the write mutex stays locked until tu_fifo_record_commit().
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  len
+                Maximum length of the record
+
+    @returns Pointer to the record payload, NULL if there is not enough space
+ */
+/******************************************************************************/
+void* tu_fifo_record_reserve(tu_fifo_t *f, uint16_t len)
+{
+  TU_ASSERT(f->item_size == 1 && !f->overwritable, NULL);
+  TU_VERIFY(len < _FF_RECORD_PAD, NULL);
+
+  uint32_t const need = (uint32_t) len + TU_FIFO_RECORD_HDR_SIZE;
+  TU_VERIFY(need <= f->depth, NULL);
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_idx_t const n = tu_fifo_write_reserve(f, &info, f->depth);
+  if (n == 0) return NULL;
+
+  uint8_t* hdr;
+  uint32_t total;
+
+  if ( info.len_lin >= need )
+  {
+    hdr   = (uint8_t*) info.ptr_lin;
+    total = need;
+  }
+  else if ( info.len_wrap >= need )
+  {
+    // skip the linear tail, the reader recognizes a tail of 1 byte without header
+    if ( info.len_lin >= TU_FIFO_RECORD_HDR_SIZE ) _ff_record_hdr_set((uint8_t*) info.ptr_lin, _FF_RECORD_PAD);
+    hdr   = (uint8_t*) info.ptr_wrap;
+    total = info.len_lin + need;
   }
   else
   {
-    info->len_lin = f->depth - w;
-    info->len_wrap = free - info->len_lin; // Remaining length - n already was limited to free or FIFO depth
-    info->ptr_wrap = f->buffer;            // Always start of buffer
+    tu_fifo_write_commit(f, 0);
+    return NULL;
   }
+
+  f->wr_reserved = (tu_fifo_idx_t) total;
+  return hdr + TU_FIFO_RECORD_HDR_SIZE;
+}
+
+/******************************************************************************/
+/*!
+    @brief Commit a record written into space from tu_fifo_record_reserve()
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  len
+                Actual length of the record, at most the reserved length
+
+    @returns True if the record was committed
+ */
+/******************************************************************************/
+bool tu_fifo_record_commit(tu_fifo_t *f, uint16_t len)
+{
+  // Nothing reserved or fifo got cleared
+  if (f->wr_reserved == 0) return false;
+
+  // A reservation crossing the end of the buffer was padded and starts at the beginning
+  tu_fifo_idx_t const rel  = get_relative_pointer(f, _ff_idx_load(f->wr_idx));
+  uint32_t const      tail = f->depth - rel;
+  uint32_t const      pad  = (f->wr_reserved > tail) ? tail : 0;
+  uint8_t*            hdr  = f->buffer + (pad ? 0 : rel);
+
+  uint32_t const reserved_len = f->wr_reserved - pad - TU_FIFO_RECORD_HDR_SIZE;
+  if (len > reserved_len) len = (uint16_t) reserved_len;
+
+  _ff_record_hdr_set(hdr, len);
+  tu_fifo_write_commit(f, (tu_fifo_idx_t) (pad + TU_FIFO_RECORD_HDR_SIZE + len));
+
+  return true;
+}
+
+/******************************************************************************/
+/*!
+    @brief Acquire the oldest record for zero-copy reading
+
+    On success the read mutex stays locked until tu_fifo_record_release().
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] len
+                Length of the record
+
+    @returns Pointer to the record payload, NULL if the FIFO is empty
+ */
+/******************************************************************************/
+void const* tu_fifo_record_acquire(tu_fifo_t *f, uint16_t *len)
+{
+  TU_ASSERT(f->item_size == 1 && !f->overwritable, NULL);
+
+  tu_fifo_buffer_info_t info;
+  if ( 0 == tu_fifo_read_acquire(f, &info, f->depth) ) return NULL;
+
+  uint16_t skip;
+  uint8_t const* hdr = _ff_record_locate(&info, &skip, len);
+
+  f->rd_acquired = (tu_fifo_idx_t) (skip + TU_FIFO_RECORD_HDR_SIZE + *len);
+  return hdr + TU_FIFO_RECORD_HDR_SIZE;
+}
+
+/******************************************************************************/
+/*!
+    @brief Remove the record acquired by tu_fifo_record_acquire()
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+
+    @returns True if a record was removed
+ */
+/******************************************************************************/
+bool tu_fifo_record_release(tu_fifo_t *f)
+{
+  return tu_fifo_read_release(f, f->rd_acquired) > 0;
+}
+
+/******************************************************************************/
+/*!
+    @brief Get the length of the oldest record without removing it
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] len
+                Length of the record
+
+    @returns False if the FIFO is empty
+ */
+/******************************************************************************/
+bool tu_fifo_record_peek_len(tu_fifo_t *f, uint16_t *len)
+{
+  if ( NULL == tu_fifo_record_acquire(f, len) ) return false;
+
+  tu_fifo_read_release(f, 0);
+  return true;
+}
+
+/******************************************************************************/
+/*!
+    @brief Write one record
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  data
+                Record payload
+    @param[in]  len
+                Length of the record
+
+    @returns False if there is not enough space, nothing is written then
+ */
+/******************************************************************************/
+bool tu_fifo_record_write(tu_fifo_t *f, void const *data, uint16_t len)
+{
+  void* buf = tu_fifo_record_reserve(f, len);
+  if (buf == NULL) return false;
+
+  if (len) memcpy(buf, data, len);
+  return tu_fifo_record_commit(f, len);
+}
+
+/******************************************************************************/
+/*!
+    @brief Read and remove one record
+
+    A record longer than bufsize is truncated, the remainder is dropped.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] buf
+                Destination buffer
+    @param[in]  bufsize
+                Size of the destination buffer
+
+    @returns Number of bytes copied, 0 if the FIFO is empty
+ */
+/******************************************************************************/
+uint16_t tu_fifo_record_read(tu_fifo_t *f, void *buf, uint16_t bufsize)
+{
+  uint16_t len;
+  void const* rec = tu_fifo_record_acquire(f, &len);
+  if (rec == NULL) return 0;
+
+  if (len > bufsize) len = bufsize;
+  if (len) memcpy(buf, rec, len);
+  tu_fifo_record_release(f);
+
+  return len;
 }
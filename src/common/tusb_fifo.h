@@ -40,53 +40,126 @@ extern "C" {
 // Also, this FIFO is ready to be used in combination with a DMA as the write and
 // read pointers can be updated from within a DMA ISR. Overflows are detectable
 // within a certain number (see tu_fifo_overflow()).
+// With CFG_TUSB_FIFO_SPSC one writer and one reader thread may run concurrently
+// without mutexes; functions changing both sides (config, clear, set_overwritable)
+// must then not run concurrently with any other access. Overwritable FIFOs may hand
+// out items the writer is overwriting at the same time.
+// With CFG_TUSB_FIFO_MPSC, a FIFO configured by tu_fifo_config_mpsc() may be written by
+// any number of tasks and ISRs at the same time through tu_fifo_write(), tu_fifo_write_n()
+// and tu_fifo_write_iov(). Writers claim space lock-free without the write mutex and the
+// written items become visible to the reader once all overlapping writers are done. Such
+// a FIFO is never overwritten, the other write functions (reserve/commit, get_write_info/
+// advance_write_pointer, records) are not available on it and assert. All other FIFOs
+// keep their single writer behavior.
 
 #include "common/tusb_common.h"
 
 // mutex is only needed for RTOS
 // for OS None, we don't get preempted
-#define CFG_FIFO_MUTEX      (CFG_TUSB_OS != OPT_OS_NONE)
+// for single producer/single consumer FIFOs, indices are updated lock-free
+#define CFG_FIFO_MUTEX      ((CFG_TUSB_OS != OPT_OS_NONE) && !CFG_TUSB_FIFO_SPSC)
 
 #if CFG_FIFO_MUTEX
 #include "osal/osal.h"
 #define tu_fifo_mutex_t  osal_mutex_t
 #endif
 
+// Index and item count type. Absolute indices run over 2*depth, so the maximum
+// depth is half the index space: 2^15 items by default, 2^31 items with
+// CFG_TUSB_FIFO_WIDE_INDEX e.g. for large high speed buffers in external RAM.
+#if CFG_TUSB_FIFO_WIDE_INDEX
+typedef uint32_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT32_MAX
+#else
+typedef uint16_t tu_fifo_idx_t;
+#define TU_FIFO_IDX_MAX     UINT16_MAX
+#endif
+
+#define TU_FIFO_DEPTH_MAX   ((TU_FIFO_IDX_MAX >> 1) + 1)
+
+#if CFG_TUSB_FIFO_STATS
+typedef struct
+{
+  tu_fifo_idx_t high_water ; ///< maximum number of items seen in the FIFO
+  uint32_t overflow        ; ///< items lost on write, either rejected (FIFO full) or overwritten
+  uint32_t underrun        ; ///< read calls that returned less than requested
+  uint32_t bytes_written   ; ///< total bytes written
+  uint32_t bytes_read      ; ///< total bytes read
+} tu_fifo_stats_t;
+#endif
+
 typedef struct
 {
-  uint8_t* buffer               ; ///< buffer pointer
-  uint16_t depth                ; ///< max items
-  uint16_t item_size            ; ///< size of each item
-  bool overwritable             ;
+  uint8_t* buffer                    ; ///< buffer pointer
+  tu_fifo_idx_t depth                ; ///< max items
+  uint16_t item_size                 ; ///< size of each item
+  bool overwritable                  ;
+  bool pow2                          ; ///< depth is a power of two, index arithmetic is done by masking
+#if CFG_TUSB_FIFO_MPSC
+  bool mpsc                          ; ///< multiple writers, configured by tu_fifo_config_mpsc()
+#endif
 
-  uint16_t non_used_index_space ; ///< required for non-power-of-two buffer length
-  uint16_t max_pointer_idx      ; ///< maximum absolute pointer index
+  tu_fifo_idx_t non_used_index_space ; ///< required for non-power-of-two buffer length
+  tu_fifo_idx_t max_pointer_idx      ; ///< maximum absolute pointer index
 
-  volatile uint16_t wr_idx      ; ///< write pointer
-  volatile uint16_t rd_idx      ; ///< read pointer
+  volatile tu_fifo_idx_t wr_idx      ; ///< write pointer
+  volatile tu_fifo_idx_t rd_idx      ; ///< read pointer
+
+  tu_fifo_idx_t wr_reserved          ; ///< items reserved by tu_fifo_write_reserve() and not yet committed
+#if CFG_TUSB_FIFO_MPSC
+  volatile uint32_t wr_claim         ; ///< write index claimed by writers (low half) and number of writers still copying (high half)
+#endif
+  tu_fifo_idx_t rd_acquired          ; ///< items acquired by tu_fifo_read_acquire() and not yet released
 
 #if CFG_FIFO_MUTEX
   tu_fifo_mutex_t mutex_wr;
   tu_fifo_mutex_t mutex_rd;
 #endif
 
+#if CFG_TUSB_FIFO_STATS
+  tu_fifo_stats_t stats;
+#endif
+
 } tu_fifo_t;
 
 typedef struct
 {
-  uint16_t len_lin  ; ///< linear length in item size
-  uint16_t len_wrap ; ///< wrapped length in item size
-  void * ptr_lin    ; ///< linear part start pointer
-  void * ptr_wrap   ; ///< wrapped part start pointer
+  tu_fifo_idx_t len_lin  ; ///< linear length in item size
+  tu_fifo_idx_t len_wrap ; ///< wrapped length in item size
+  void * ptr_lin         ; ///< linear part start pointer
+  void * ptr_wrap        ; ///< wrapped part start pointer
 } tu_fifo_buffer_info_t;
 
+// Segment for tu_fifo_write_iov() / tu_fifo_read_iov(), len is in items
+typedef struct
+{
+  void const *  buf;
+  tu_fifo_idx_t len;
+} tu_fifo_iovec_const_t;
+
+typedef struct
+{
+  void *        buf;
+  tu_fifo_idx_t len;
+} tu_fifo_iovec_t;
+
+#define TU_FIFO_IS_POW2(_depth)   ( ((_depth) & ((_depth)-1)) == 0 )
+
+#if CFG_TUSB_FIFO_POW2_ONLY
+// index arithmetic always masks: a static FIFO with other depth fails to compile (negative array size)
+#define _TU_FIFO_POW2(_depth)     ( sizeof(char[TU_FIFO_IS_POW2(_depth) ? 1 : -1]) == 1 )
+#else
+#define _TU_FIFO_POW2(_depth)     TU_FIFO_IS_POW2(_depth)
+#endif
+
 #define TU_FIFO_INIT(_buffer, _depth, _type, _overwritable) \
 {                                                           \
   .buffer               = _buffer,                          \
   .depth                = _depth,                           \
   .item_size            = sizeof(_type),                    \
   .overwritable         = _overwritable,                    \
-  .non_used_index_space = UINT16_MAX - (2*(_depth)-1),      \
+  .pow2                 = _TU_FIFO_POW2(_depth),            \
+  .non_used_index_space = TU_FIFO_IDX_MAX - (2*(_depth)-1), \
   .max_pointer_idx      = 2*(_depth)-1,                     \
 }
 
@@ -97,7 +170,18 @@ typedef struct
 
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable);
 bool tu_fifo_clear(tu_fifo_t *f);
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size, bool overwritable);
+
+#if CFG_TUSB_FIFO_MPSC
+// Configure a not overwritable FIFO for multiple concurrent writers, see top of this file
+bool tu_fifo_config_mpsc(tu_fifo_t *f, void* buffer, tu_fifo_idx_t depth, uint16_t item_size);
+#endif
+
+#if CFG_TUSB_FIFO_STATS
+// Statistics survive tu_fifo_clear(), they are only reset by tu_fifo_config() and tu_fifo_reset_stats()
+void tu_fifo_get_stats(tu_fifo_t *f, tu_fifo_stats_t *stats);
+void tu_fifo_reset_stats(tu_fifo_t *f);
+#endif
 
 #if CFG_FIFO_MUTEX
 TU_ATTR_ALWAYS_INLINE static inline
@@ -108,34 +192,36 @@ void tu_fifo_config_mutex(tu_fifo_t *f, tu_fifo_mutex_t write_mutex_hdl, tu_fifo
 }
 #endif
 
-bool     tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
-uint16_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, uint16_t n);
-uint16_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, uint16_t n);
+bool          tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
+tu_fifo_idx_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_write_iov              (tu_fifo_t* f, tu_fifo_iovec_const_t const * iov, uint8_t iovcnt);
 
-bool     tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
-uint16_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, uint16_t n);
+bool          tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_iov               (tu_fifo_t* f, tu_fifo_iovec_t const * iov, uint8_t iovcnt);
 
-bool     tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
+bool          tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_idx_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_idx_t n);
 
-uint16_t tu_fifo_count                  (tu_fifo_t* f);
-uint16_t tu_fifo_remaining              (tu_fifo_t* f);
-bool     tu_fifo_empty                  (tu_fifo_t* f);
-bool     tu_fifo_full                   (tu_fifo_t* f);
-bool     tu_fifo_overflowed             (tu_fifo_t* f);
-void     tu_fifo_correct_read_pointer   (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_count                  (tu_fifo_t* f);
+tu_fifo_idx_t tu_fifo_remaining              (tu_fifo_t* f);
+bool          tu_fifo_empty                  (tu_fifo_t* f);
+bool          tu_fifo_full                   (tu_fifo_t* f);
+bool          tu_fifo_overflowed             (tu_fifo_t* f);
+void          tu_fifo_correct_read_pointer   (tu_fifo_t* f);
 
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t tu_fifo_depth(tu_fifo_t* f)
+tu_fifo_idx_t tu_fifo_depth(tu_fifo_t* f)
 {
   return f->depth;
 }
 
 // Pointer modifications intended to be used in combinations with DMAs.
 // USE WITH CARE - NO SAFTY CHECKS CONDUCTED HERE! NOT MUTEX PROTECTED!
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
-void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_idx_t n);
+void tu_fifo_advance_read_pointer (tu_fifo_t *f, tu_fifo_idx_t n);
 
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
@@ -143,6 +229,52 @@ void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
 void tu_fifo_get_read_info (tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
 
+// Zero-copy access: reserve space (or acquire data) as up to two linear spans, fill (or drain)
+// them in place e.g. by a DMA or a parser, then commit (or release) the number of items used.
+// The write (read) mutex is held from a successful reserve (acquire) until the matching
+// commit (release), so a concurrent tu_fifo_clear() waits for the owner to finish. If zero
+// is returned, nothing is held and no commit (release) must follow.
+tu_fifo_idx_t tu_fifo_write_reserve(tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_write_commit (tu_fifo_t *f, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_acquire (tu_fifo_t *f, tu_fifo_buffer_info_t *info, tu_fifo_idx_t n);
+tu_fifo_idx_t tu_fifo_read_release (tu_fifo_t *f, tu_fifo_idx_t n);
+
+//--------------------------------------------------------------------+
+// Record FIFO
+//--------------------------------------------------------------------+
+
+// Variable length records (e.g. HID reports, NCM datagrams, ACL frames) on a byte FIFO
+// (item_size 1, not overwritable). Each record is stored contiguously behind a 16 bit
+// length header, so it can be handed to a DCD as is. A record that does not fit before
+// the end of the buffer is placed at the start and the tail is skipped. Reserve/acquire
+// hold the mutex the same way as tu_fifo_write_reserve()/tu_fifo_read_acquire().
+#define TU_FIFO_RECORD_HDR_SIZE   2
+
+bool     tu_fifo_record_write   (tu_fifo_t *f, void const *data, uint16_t len);
+uint16_t tu_fifo_record_read    (tu_fifo_t *f, void *buf, uint16_t bufsize);
+bool     tu_fifo_record_peek_len(tu_fifo_t *f, uint16_t *len);
+
+void*       tu_fifo_record_reserve(tu_fifo_t *f, uint16_t len);
+bool        tu_fifo_record_commit (tu_fifo_t *f, uint16_t len);
+void const* tu_fifo_record_acquire(tu_fifo_t *f, uint16_t *len);
+bool        tu_fifo_record_release(tu_fifo_t *f);
+
+
+//--------------------------------------------------------------------+
+// Hardware FIFO access
+//--------------------------------------------------------------------+
+
+// Copy between a buffer and a hardware FIFO register at a constant address (e.g. USB
+// peripheral data register) using 8, 16 or 32 bit accesses. Aligned buffers take an
+// unrolled word path. Trailing bytes that do not fill a whole access are packed LSB
+// first into one last access, DCDs with byte lane access (e.g. MUSB) can instead finish
+// the tail with narrower calls.
+void tu_hwfifo_write32(volatile uint32_t * reg, void const * src, uint32_t len);
+void tu_hwfifo_read32 (volatile const uint32_t * reg, void * dst, uint32_t len);
+void tu_hwfifo_write16(volatile uint16_t * reg, void const * src, uint32_t len);
+void tu_hwfifo_read16 (volatile const uint16_t * reg, void * dst, uint32_t len);
+void tu_hwfifo_write8 (volatile uint8_t * reg, void const * src, uint32_t len);
+void tu_hwfifo_read8  (volatile const uint8_t * reg, void * dst, uint32_t len);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,129 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_LOG_H_
+#define _TUSB_LOG_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Deferred binary logging. With CFG_TUSB_DEBUG_DEFERRED the TU_LOG family does not format text:
+// each format string is placed in section .tu_log_fmt and only its position plus the raw
+// arguments (cast to 32 bit) are pushed to a RAM ring. tools/log_decode.py reconstructs the text
+// with the format strings from the firmware ELF. Arguments printed with %s must point to strings
+// in the ELF (literals, descriptor name tables ...), others are shown as their address.
+//
+// Format strings are never read by the target. Keep them out of the image by placing the section
+// as not loaded in the linker script, e.g. for GNU ld
+//   .tu_log_fmt 0 (INFO) : { KEEP(*(.tu_log_fmt)) }
+//
+// Records are drained with tu_log_read() e.g. to a UART or RTT channel and the byte stream is
+// decoded by the host tool. Alternatively dump _tu_log from a debugger, the ring is self describing.
+
+//--------------------------------------------------------------------+
+// Ring and Records
+//--------------------------------------------------------------------+
+
+#define TU_LOG_MAGIC        0x474f4c54 // "TLOG" little endian
+#define TU_LOG_VERSION      1
+
+// Record header word, written last: marker | type << 16 | count
+#define TU_LOG_REC_MARK     0xA5000000u
+#define TU_LOG_REC_MARK_MASK 0xFF000000u
+
+// Bytes captured by TU_LOG_MEM()/TU_LOG_VAR(), the rest is dropped
+#define TU_LOG_MEM_MAX      64
+
+enum
+{
+  TU_LOG_REC_PRINTF = 0, // format id, count arguments
+  TU_LOG_REC_MEM,        // total byte count, count bytes padded to words (tu_print_mem)
+  TU_LOG_REC_VAR,        // same as MEM, printed inline (tu_print_var)
+};
+
+typedef struct
+{
+  uint32_t magic;     // TU_LOG_MAGIC, also tells the byte order to the decoder
+  uint32_t version;
+  uint32_t depth;     // words in buf
+  uint32_t wr_idx;    // words claimed by writers
+  uint32_t rd_idx;    // words consumed by tu_log_read()
+  uint32_t dropped;   // records dropped since ring was full
+  uint32_t buf[CFG_TUSB_DEBUG_DEFERRED_DEPTH];
+}tu_log_ring_t;
+
+extern tu_log_ring_t _tu_log;
+
+// Anchor in .tu_log_fmt, format id is the offset of the format string to it
+extern char const tu_log_fmt_base[];
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+
+// Push a formatted log record. Safe to call from ISR and tasks concurrently (lock-free),
+// the record is dropped if the ring is full
+void tu_log_push(char const* fmt, uint8_t nargs, uint32_t const* args);
+
+// Push a memory dump record of TU_LOG_REC_MEM or TU_LOG_REC_VAR type
+void tu_log_push_mem(uint8_t type, void const* buf, uint32_t count);
+
+// Copy complete records to buffer and release them from the ring. Return number of bytes copied.
+// Only one context may read.
+uint32_t tu_log_read(void* buffer, uint32_t bufsize);
+
+//--------------------------------------------------------------------+
+// Log Macros
+//--------------------------------------------------------------------+
+
+#define _TU_LOG_ARG(_x)     ((uint32_t) (uintptr_t) (_x))
+
+#define _TU_LOG_ARGS_0()
+#define _TU_LOG_ARGS_1(_a1)                                    , _TU_LOG_ARG(_a1)
+#define _TU_LOG_ARGS_2(_a1, _a2)                               , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_1(_a2)
+#define _TU_LOG_ARGS_3(_a1, _a2, _a3)                          , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_2(_a2, _a3)
+#define _TU_LOG_ARGS_4(_a1, _a2, _a3, _a4)                     , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_3(_a2, _a3, _a4)
+#define _TU_LOG_ARGS_5(_a1, _a2, _a3, _a4, _a5)                , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_4(_a2, _a3, _a4, _a5)
+#define _TU_LOG_ARGS_6(_a1, _a2, _a3, _a4, _a5, _a6)           , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_5(_a2, _a3, _a4, _a5, _a6)
+#define _TU_LOG_ARGS_7(_a1, _a2, _a3, _a4, _a5, _a6, _a7)      , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_6(_a2, _a3, _a4, _a5, _a6, _a7)
+#define _TU_LOG_ARGS_8(_a1, _a2, _a3, _a4, _a5, _a6, _a7, _a8) , _TU_LOG_ARG(_a1) _TU_LOG_ARGS_7(_a2, _a3, _a4, _a5, _a6, _a7, _a8)
+
+// printf() replacement: format string goes to .tu_log_fmt, arguments are stored after a dummy
+// first element so that the array is never empty
+#define TU_LOG_DEFERRED(_fmt, ...) do                                                        \
+  {                                                                                          \
+    static char const _tu_log_fmt[] TU_ATTR_SECTION(.tu_log_fmt) = _fmt;                     \
+    uint32_t const _tu_log_args[TU_ARGS_NUM(__VA_ARGS__) + 1] =                              \
+      { 0 TU_XSTRCAT(_TU_LOG_ARGS_, TU_ARGS_NUM(__VA_ARGS__))(__VA_ARGS__) };                \
+    tu_log_push(_tu_log_fmt, TU_ARGS_NUM(__VA_ARGS__), _tu_log_args + 1);                    \
+  } while (0)
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_LOG_H_ */
@@ -0,0 +1,181 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_TRACE_H_
+#define _TUSB_TRACE_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Binary event trace. With CFG_TUSB_TRACE each TU_TRACE() point writes one fixed size record
+// into a RAM ring instead of formatting text, so that tracing barely changes timing. Writers
+// (ISRs and tasks) claim slots with an atomic increment and never wait, the oldest records
+// are overwritten. The ring is self describing: dump _tusb_trace from a debugger e.g.
+//   (gdb) dump binary value trace.bin _tusb_trace
+// and turn it into a timeline with tools/trace_decode.py trace.bin
+
+//--------------------------------------------------------------------+
+// Trace Events
+//--------------------------------------------------------------------+
+
+// Record field usage per event, fields not listed are 0. Events of a range are numbered by
+// the stack event (dcd_eventid_t, hcd_eventid_t) they trace, keep tools/trace_decode.py in sync.
+typedef enum
+{
+  // DCD event reported by the port, usually in ISR. Setup packets are recorded with
+  // driver = bmRequestType, result = bRequest, len = wValue | wIndex << 16.
+  // Transfer complete with ep_addr, result, len and bus reset with len = speed.
+  TUSB_TRACE_DCD_EVENT        = 0x00,
+
+  // Event posted to usbd queue: same fields as DCD event except driver = queue priority for
+  // all but setup
+  TUSB_TRACE_USBD_QUEUE_POST  = 0x10,
+
+  // Event taken from usbd queue by tud_task(): same fields as DCD event
+  TUSB_TRACE_USBD_QUEUE_GET   = 0x20,
+
+  // Transfer submitted by class driver: driver, ep_addr, len, result = 1. Recorded before the
+  // controller is armed, a transfer refused by it is followed by the same record with result = 0
+  TUSB_TRACE_USBD_XFER        = 0x30,
+  TUSB_TRACE_USBD_XFER_QUEUE,
+
+  // Class driver opened at SET_CONFIGURATION: driver, ep_addr = interface number, len = bytes claimed
+  TUSB_TRACE_USBD_CLASS_OPEN,
+
+  // Class driver xfer_cb() from tud_task() or ISR hook: driver, ep_addr, result, len
+  TUSB_TRACE_USBD_CLASS_XFER_CB,
+  TUSB_TRACE_USBD_CLASS_ISR_CB,
+
+  // Control endpoint transfer complete handled by usbd_control: ep_addr, result, len
+  TUSB_TRACE_USBD_CONTROL_XFER_CB,
+
+  // Event dropped since its usbd queue is full: driver = queue priority, result = dcd_eventid_t
+  TUSB_TRACE_USBD_QUEUE_OVERFLOW,
+
+  // HCD event reported by the port: driver = device address, transfer complete with ep_addr, result, len
+  TUSB_TRACE_HCD_EVENT        = 0x40,
+
+  // Event taken from usbh queue by tuh_task(): same fields as HCD event
+  TUSB_TRACE_USBH_QUEUE_GET   = 0x50,
+
+  // Transfer submitted by host class driver: same as usbd transfer with driver = device address
+  TUSB_TRACE_USBH_XFER        = 0x60,
+
+  // Host class driver xfer_cb(): driver, ep_addr, result, len
+  TUSB_TRACE_USBH_CLASS_XFER_CB,
+}tusb_trace_event_t;
+
+#define TUSB_TRACE_MAGIC      0x52545554 // "TUTR" little endian
+#define TUSB_TRACE_VERSION    1
+
+// Driver id of records not related to a class driver
+#define TUSB_TRACE_NO_DRIVER  0xff
+
+typedef struct
+{
+  uint32_t time;      // CFG_TUSB_TRACE_TIMESTAMP() ticks
+  uint8_t  event;     // tusb_trace_event_t
+  uint8_t  ep_addr;
+  uint8_t  driver;    // class driver id
+  uint8_t  result;
+  uint32_t len;
+}tusb_trace_rec_t;
+
+TU_VERIFY_STATIC(sizeof(tusb_trace_rec_t) == 12, "size is not correct");
+
+typedef struct
+{
+  uint32_t magic;     // TUSB_TRACE_MAGIC, also tells the byte order to the decoder
+  uint8_t  version;
+  uint8_t  rec_size;
+  uint16_t depth;
+  uint32_t wr_idx;    // number of records ever written, slot is wr_idx % depth
+  tusb_trace_rec_t rec[CFG_TUSB_TRACE_DEPTH];
+}tusb_trace_t;
+
+//--------------------------------------------------------------------+
+// Trace Recording
+//--------------------------------------------------------------------+
+#if CFG_TUSB_TRACE
+
+#if !defined(__GNUC__)
+  #error "CFG_TUSB_TRACE requires GCC compatible __atomic builtins"
+#endif
+
+// records are claimed with a 32 bit fetch-add, which is a library call instead of an instruction
+// on cores without exclusive access (e.g ARMv6-M) and would not be safe against interrupts
+#if !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+  #error "CFG_TUSB_TRACE requires lock-free 32 bit atomics, not available on this target (e.g ARMv6-M)"
+#endif
+
+TU_VERIFY_STATIC((CFG_TUSB_TRACE_DEPTH & (CFG_TUSB_TRACE_DEPTH-1)) == 0 && CFG_TUSB_TRACE_DEPTH <= 0x8000,
+                 "CFG_TUSB_TRACE_DEPTH must be a power of two up to 32768");
+
+extern tusb_trace_t _tusb_trace;
+
+// Invoked for each record when CFG_TUSB_TRACE_TIMESTAMP is not overridden, records are stamped 0 if not implemented
+TU_ATTR_WEAK uint32_t tusb_trace_timestamp_cb(void);
+
+#ifndef CFG_TUSB_TRACE_TIMESTAMP
+  #define CFG_TUSB_TRACE_TIMESTAMP()  (tusb_trace_timestamp_cb ? tusb_trace_timestamp_cb() : 0)
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline
+void tusb_trace_record(uint8_t event, uint8_t ep_addr, uint8_t driver, uint8_t result, uint32_t len)
+{
+  // slot is owned once claimed, a writer preempting this one takes the next slot
+  uint32_t const idx = __atomic_fetch_add(&_tusb_trace.wr_idx, 1, __ATOMIC_RELAXED);
+  tusb_trace_rec_t* rec = &_tusb_trace.rec[idx & (CFG_TUSB_TRACE_DEPTH-1)];
+
+  rec->time    = CFG_TUSB_TRACE_TIMESTAMP();
+  rec->event   = event;
+  rec->ep_addr = ep_addr;
+  rec->driver  = driver;
+  rec->result  = result;
+  rec->len     = len;
+}
+
+// Drop all records, only consistent while no event is traced
+TU_ATTR_ALWAYS_INLINE static inline void tusb_trace_clear(void)
+{
+  __atomic_store_n(&_tusb_trace.wr_idx, 0, __ATOMIC_RELAXED);
+}
+
+#define TU_TRACE(_event, _ep_addr, _driver, _result, _len) \
+  tusb_trace_record((uint8_t) (_event), (uint8_t) (_ep_addr), (uint8_t) (_driver), (uint8_t) (_result), (uint32_t) (_len))
+
+#else
+
+#define TU_TRACE(_event, _ep_addr, _driver, _result, _len)
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_TRACE_H_ */
@@ -72,7 +72,10 @@
 // TU_VERIFY Helper
 //--------------------------------------------------------------------+
 
-#if CFG_TUSB_DEBUG
+#if CFG_TUSB_DEBUG && CFG_TUSB_DEBUG_DEFERRED
+  #define _MESS_ERR(_err)   TU_LOG_DEFERRED("%s %d: failed, error = %s\r\n", __func__, __LINE__, tusb_strerr[_err])
+  #define _MESS_FAILED()    TU_LOG_DEFERRED("%s %d: ASSERT FAILED\r\n", __func__, __LINE__)
+#elif CFG_TUSB_DEBUG
   #include <stdio.h>
   #define _MESS_ERR(_err)   tu_printf("%s %d: failed, error = %s\r\n", __func__, __LINE__, tusb_strerr[_err])
   #define _MESS_FAILED()    tu_printf("%s %d: ASSERT FAILED\r\n", __func__, __LINE__)
@@ -63,6 +63,10 @@ typedef enum
   // Not an DCD event, just a convenient way to defer ISR function
   USBD_EVENT_FUNC_CALL,
 
+  // Not an DCD event, wake up tud_task() blocked on the transfer queue to check other queues
+  // or on behalf of application with tud_task_wakeup()
+  USBD_EVENT_WAKEUP,
+
   DCD_EVENT_COUNT
 } dcd_eventid_t;
 
@@ -85,7 +89,11 @@ typedef struct TU_ATTR_ALIGNED(4)
     struct {
       uint8_t  ep_addr;
       uint8_t  result;
+      uint8_t  gen;   // set by usbd: endpoint generation, stale if endpoint is closed before dispatch
       uint32_t len;
+#if CFG_TUD_EDPT_LATENCY
+      uint32_t stamp; // set by usbd
+#endif
     }xfer_complete;
 
     // FUNC_CALL
@@ -133,6 +141,10 @@ void dcd_connect(uint8_t rhport) TU_ATTR_WEAK;
 // Disconnect by disabling internal pull-up resistor on D+/D-
 void dcd_disconnect(uint8_t rhport) TU_ATTR_WEAK;
 
+// Enable/Disable Start-of-frame interrupt. Invoked by the stack when the first class driver or SOF timer
+// needs it and after the last one is done. Optional, SOF interrupt is left as it is if not implemented.
+void dcd_sof_enable(uint8_t rhport, bool en) TU_ATTR_WEAK;
+
 //--------------------------------------------------------------------+
 // Endpoint API
 //--------------------------------------------------------------------+
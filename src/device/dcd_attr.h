@@ -208,6 +208,10 @@
 #elif TU_CHECK_MCU(OPT_MCU_FT93X)
   #define DCD_ATTR_ENDPOINT_MAX   16
 
+//------------- Simulation -------------//
+#elif TU_CHECK_MCU(OPT_MCU_SIM)
+  #define DCD_ATTR_ENDPOINT_MAX   16
+
 #else
   #warning "DCD_ATTR_ENDPOINT_MAX is not defined for this MCU, default to 8"
   #define DCD_ATTR_ENDPOINT_MAX   8
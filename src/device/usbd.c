@@ -44,6 +44,24 @@
   #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+// Queue for bus events, setup, control endpoint transfers and deferred function calls
+#ifndef CFG_TUD_TASK_QUEUE_HIGH_SZ
+  #define CFG_TUD_TASK_QUEUE_HIGH_SZ  8
+#endif
+
+// Queue for SOF, at most one is pending
+#ifndef CFG_TUD_TASK_QUEUE_LOW_SZ
+  #define CFG_TUD_TASK_QUEUE_LOW_SZ   8
+#endif
+
+// Number of slots in SOF timer wheel, must be power of 2.
+// Timers due more than a wheel turn away share a slot with sooner ones and are skipped until due.
+#ifndef CFG_TUD_TIMER_WHEEL_SZ
+  #define CFG_TUD_TIMER_WHEEL_SZ      16
+#endif
+
+TU_VERIFY_STATIC( (CFG_TUD_TIMER_WHEEL_SZ & (CFG_TUD_TIMER_WHEEL_SZ-1)) == 0, "CFG_TUD_TIMER_WHEEL_SZ must be power of 2");
+
 //--------------------------------------------------------------------+
 // Device Data
 //--------------------------------------------------------------------+
@@ -79,10 +97,84 @@ typedef struct
     // TODO merge ep2drv here, 4-bit should be sufficient
   }ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+  void* ep_ctx[CFG_TUD_ENDPPOINT_MAX][2]; // class driver context of endpoint, see usbd_edpt_open_ctx()
+
 }usbd_device_t;
 
 static usbd_device_t _usbd_dev;
 
+#if CFG_TUD_BIND_CACHE
+// Interface & endpoint to driver binding of last configuration opened by probing all drivers.
+// Replayed by next SET_CONFIGURATION of the same configuration descriptor, only the bound driver is opened.
+typedef struct
+{
+  uint8_t const* desc_cfg;  // configuration descriptor the plan is computed from
+  uint16_t total_len;
+  uint8_t  cfg_num;         // 0 if plan is invalid
+  uint8_t  func_count;
+
+  struct
+  {
+    uint16_t drv_len;
+    uint8_t  drv_id;
+  }func[TU_ARRAY_SIZE(_usbd_dev.itf2drv)]; // in descriptor order, at most one per interface
+
+  uint8_t itf2drv[TU_ARRAY_SIZE(_usbd_dev.itf2drv)];
+  uint8_t ep2drv[CFG_TUD_ENDPPOINT_MAX][2];
+}usbd_bind_plan_t;
+
+static usbd_bind_plan_t _usbd_bind_plan;
+#endif
+
+#if CFG_TUD_EDPT_XFER_CHUNK
+// Transfer in progress on an endpoint, only used when it does not fit in dcd_edpt_xfer()'s 16-bit length
+typedef struct
+{
+  void*    buf;        // start of next chunk: buffer or tu_fifo_t
+  uint32_t remaining;  // bytes not submitted to DCD yet
+  uint32_t xferred;    // bytes transferred by previous chunks
+  uint16_t chunk_max;  // largest multiple of the packet size that fits in 16-bit, set when endpoint is opened
+  bool     is_fifo;
+}usbd_xfer_t;
+
+static usbd_xfer_t _usbd_xfer[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_QUEUE_SZ
+TU_VERIFY_STATIC(CFG_TUD_EDPT_QUEUE_SZ <= 128, "CFG_TUD_EDPT_QUEUE_SZ must not exceed 128");
+
+// Per endpoint transfer queue. Requests are pushed by usbd_edpt_xfer_queue() and popped
+// by dcd_event_handler() which arms the next one as soon as the DCD reports completion.
+typedef struct
+{
+  struct
+  {
+    uint8_t * buffer;
+    uint32_t  total_bytes;
+  }req[CFG_TUD_EDPT_QUEUE_SZ];
+
+  volatile uint8_t rd;      // free running, advanced in dcd_event_handler()
+  volatile uint8_t wr;      // free running, advanced in usbd_edpt_xfer_queue()
+  volatile bool    armed;   // a queued transfer is in flight on the DCD
+  uint8_t          count;   // submitted transfers whose xfer_cb() is not invoked yet
+}usbd_edpt_queue_t;
+
+static usbd_edpt_queue_t _usbd_edpt_q[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_ISR_CB
+static usbd_edpt_isr_cb_t _usbd_edpt_isr_cb[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_LATENCY
+static tud_edpt_latency_t _usbd_edpt_latency[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+// Bumped whenever an endpoint is closed (usbd_edpt_close(), SET_CONFIGURATION, bus reset) and stamped
+// into its transfer complete events: tud_task() drops completions queued before the endpoint was closed.
+// Not part of _usbd_dev, must survive configuration_reset().
+static uint8_t _usbd_ep_gen[CFG_TUD_ENDPPOINT_MAX][2];
+
 //--------------------------------------------------------------------+
 // Class Driver
 //--------------------------------------------------------------------+
@@ -92,155 +184,129 @@ static usbd_device_t _usbd_dev;
   #define DRIVER_NAME(_name)
 #endif
 
-// Built-in class drivers
-static usbd_class_driver_t const _usbd_driver[] =
+#if CFG_TUD_DFU_RUNTIME || CFG_TUD_DFU
+// DFU drivers have no endpoint other than control
+static bool driver_xfer_cb_none(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  #if CFG_TUD_CDC
-  {
-    DRIVER_NAME("CDC")
-    .init             = cdcd_init,
-    .reset            = cdcd_reset,
-    .open             = cdcd_open,
-    .control_xfer_cb  = cdcd_control_xfer_cb,
-    .xfer_cb          = cdcd_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+  (void) rhport; (void) ep_addr; (void) result; (void) xferred_bytes;
+  return false;
+}
+#endif
 
-  #if CFG_TUD_MSC
-  {
-    DRIVER_NAME("MSC")
-    .init             = mscd_init,
-    .reset            = mscd_reset,
-    .open             = mscd_open,
-    .control_xfer_cb  = mscd_control_xfer_cb,
-    .xfer_cb          = mscd_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+// Built-in class drivers in probing order, one X(id, name, init, reset, open, control_xfer_cb, xfer_cb) per
+// enabled class. Expanded into the driver table and, with CFG_TUD_DRIVER_STATIC_DISPATCH, into switch
+// based dispatchers. Built-in drivers have no sof()/sof_frames() callback.
+#if CFG_TUD_CDC
+  #define USBD_DRIVER_CDC(X)  X(CDC, "CDC", cdcd_init, cdcd_reset, cdcd_open, cdcd_control_xfer_cb, cdcd_xfer_cb)
+#else
+  #define USBD_DRIVER_CDC(X)
+#endif
 
-  #if CFG_TUD_HID
-  {
-    DRIVER_NAME("HID")
-    .init             = hidd_init,
-    .reset            = hidd_reset,
-    .open             = hidd_open,
-    .control_xfer_cb  = hidd_control_xfer_cb,
-    .xfer_cb          = hidd_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_MSC
+  #define USBD_DRIVER_MSC(X)  X(MSC, "MSC", mscd_init, mscd_reset, mscd_open, mscd_control_xfer_cb, mscd_xfer_cb)
+#else
+  #define USBD_DRIVER_MSC(X)
+#endif
 
-  #if CFG_TUD_AUDIO
-  {
-    DRIVER_NAME("AUDIO")
-    .init             = audiod_init,
-    .reset            = audiod_reset,
-    .open             = audiod_open,
-    .control_xfer_cb  = audiod_control_xfer_cb,
-    .xfer_cb          = audiod_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_HID
+  #define USBD_DRIVER_HID(X)  X(HID, "HID", hidd_init, hidd_reset, hidd_open, hidd_control_xfer_cb, hidd_xfer_cb)
+#else
+  #define USBD_DRIVER_HID(X)
+#endif
 
-  #if CFG_TUD_VIDEO
-  {
-    DRIVER_NAME("VIDEO")
-    .init             = videod_init,
-    .reset            = videod_reset,
-    .open             = videod_open,
-    .control_xfer_cb  = videod_control_xfer_cb,
-    .xfer_cb          = videod_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_AUDIO
+  #define USBD_DRIVER_AUDIO(X)  X(AUDIO, "AUDIO", audiod_init, audiod_reset, audiod_open, audiod_control_xfer_cb, audiod_xfer_cb)
+#else
+  #define USBD_DRIVER_AUDIO(X)
+#endif
 
-  #if CFG_TUD_MIDI
-  {
-    DRIVER_NAME("MIDI")
-    .init             = midid_init,
-    .open             = midid_open,
-    .reset            = midid_reset,
-    .control_xfer_cb  = midid_control_xfer_cb,
-    .xfer_cb          = midid_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_VIDEO
+  #define USBD_DRIVER_VIDEO(X)  X(VIDEO, "VIDEO", videod_init, videod_reset, videod_open, videod_control_xfer_cb, videod_xfer_cb)
+#else
+  #define USBD_DRIVER_VIDEO(X)
+#endif
 
-  #if CFG_TUD_VENDOR
-  {
-    DRIVER_NAME("VENDOR")
-    .init             = vendord_init,
-    .reset            = vendord_reset,
-    .open             = vendord_open,
-    .control_xfer_cb  = tud_vendor_control_xfer_cb,
-    .xfer_cb          = vendord_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_MIDI
+  #define USBD_DRIVER_MIDI(X)  X(MIDI, "MIDI", midid_init, midid_reset, midid_open, midid_control_xfer_cb, midid_xfer_cb)
+#else
+  #define USBD_DRIVER_MIDI(X)
+#endif
 
-  #if CFG_TUD_USBTMC
-  {
-    DRIVER_NAME("TMC")
-    .init             = usbtmcd_init_cb,
-    .reset            = usbtmcd_reset_cb,
-    .open             = usbtmcd_open_cb,
-    .control_xfer_cb  = usbtmcd_control_xfer_cb,
-    .xfer_cb          = usbtmcd_xfer_cb,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_VENDOR
+  #define USBD_DRIVER_VENDOR(X)  X(VENDOR, "VENDOR", vendord_init, vendord_reset, vendord_open, tud_vendor_control_xfer_cb, vendord_xfer_cb)
+#else
+  #define USBD_DRIVER_VENDOR(X)
+#endif
 
-  #if CFG_TUD_DFU_RUNTIME
-  {
-    DRIVER_NAME("DFU-RUNTIME")
-    .init             = dfu_rtd_init,
-    .reset            = dfu_rtd_reset,
-    .open             = dfu_rtd_open,
-    .control_xfer_cb  = dfu_rtd_control_xfer_cb,
-    .xfer_cb          = NULL,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_USBTMC
+  #define USBD_DRIVER_TMC(X)  X(TMC, "TMC", usbtmcd_init_cb, usbtmcd_reset_cb, usbtmcd_open_cb, usbtmcd_control_xfer_cb, usbtmcd_xfer_cb)
+#else
+  #define USBD_DRIVER_TMC(X)
+#endif
 
-  #if CFG_TUD_DFU
-  {
-    DRIVER_NAME("DFU")
-    .init             = dfu_moded_init,
-    .reset            = dfu_moded_reset,
-    .open             = dfu_moded_open,
-    .control_xfer_cb  = dfu_moded_control_xfer_cb,
-    .xfer_cb          = NULL,
-    .sof              = NULL
-  },
-  #endif
+#if CFG_TUD_DFU_RUNTIME
+  #define USBD_DRIVER_DFU_RT(X)  X(DFU_RT, "DFU-RUNTIME", dfu_rtd_init, dfu_rtd_reset, dfu_rtd_open, dfu_rtd_control_xfer_cb, driver_xfer_cb_none)
+#else
+  #define USBD_DRIVER_DFU_RT(X)
+#endif
 
-  #if CFG_TUD_ECM_RNDIS || CFG_TUD_NCM
-  {
-    DRIVER_NAME("NET")
-    .init             = netd_init,
-    .reset            = netd_reset,
-    .open             = netd_open,
-    .control_xfer_cb  = netd_control_xfer_cb,
-    .xfer_cb          = netd_xfer_cb,
-    .sof              = NULL,
-  },
-  #endif
+#if CFG_TUD_DFU
+  #define USBD_DRIVER_DFU(X)  X(DFU, "DFU", dfu_moded_init, dfu_moded_reset, dfu_moded_open, dfu_moded_control_xfer_cb, driver_xfer_cb_none)
+#else
+  #define USBD_DRIVER_DFU(X)
+#endif
 
-  #if CFG_TUD_BTH
-  {
-    DRIVER_NAME("BTH")
-    .init             = btd_init,
-    .reset            = btd_reset,
-    .open             = btd_open,
-    .control_xfer_cb  = btd_control_xfer_cb,
-    .xfer_cb          = btd_xfer_cb,
-    .sof              = NULL
+#if CFG_TUD_ECM_RNDIS || CFG_TUD_NCM
+  #define USBD_DRIVER_NET(X)  X(NET, "NET", netd_init, netd_reset, netd_open, netd_control_xfer_cb, netd_xfer_cb)
+#else
+  #define USBD_DRIVER_NET(X)
+#endif
+
+#if CFG_TUD_BTH
+  #define USBD_DRIVER_BTH(X)  X(BTH, "BTH", btd_init, btd_reset, btd_open, btd_control_xfer_cb, btd_xfer_cb)
+#else
+  #define USBD_DRIVER_BTH(X)
+#endif
+
+#define USBD_BUILTIN_DRIVERS(X) \
+  USBD_DRIVER_CDC(X) \
+  USBD_DRIVER_MSC(X) \
+  USBD_DRIVER_HID(X) \
+  USBD_DRIVER_AUDIO(X) \
+  USBD_DRIVER_VIDEO(X) \
+  USBD_DRIVER_MIDI(X) \
+  USBD_DRIVER_VENDOR(X) \
+  USBD_DRIVER_TMC(X) \
+  USBD_DRIVER_DFU_RT(X) \
+  USBD_DRIVER_DFU(X) \
+  USBD_DRIVER_NET(X) \
+  USBD_DRIVER_BTH(X)
+
+#define DRIVER_ENTRY(_id, _name, _init, _reset, _open, _control_xfer_cb, _xfer_cb) \
+  {                                       \
+    DRIVER_NAME(_name)                    \
+    .init             = _init,            \
+    .reset            = _reset,           \
+    .open             = _open,            \
+    .control_xfer_cb  = _control_xfer_cb, \
+    .xfer_cb          = _xfer_cb,         \
+    .sof              = NULL,             \
+    .sof_frames       = NULL              \
   },
-  #endif
+
+#define DRIVER_ID(_id, _name, _init, _reset, _open, _control_xfer_cb, _xfer_cb) BUILTIN_DRVID_##_id,
+
+// Built-in class drivers
+static usbd_class_driver_t const _usbd_driver[] =
+{
+  USBD_BUILTIN_DRIVERS(DRIVER_ENTRY)
 };
 
-enum { BUILTIN_DRIVER_COUNT = TU_ARRAY_SIZE(_usbd_driver) };
+enum
+{
+  USBD_BUILTIN_DRIVERS(DRIVER_ID)
+  BUILTIN_DRIVER_COUNT
+};
 
 // Additional class drivers implemented by application
 static usbd_class_driver_t const * _app_driver = NULL;
@@ -265,16 +331,116 @@ static inline usbd_class_driver_t const * get_driver(uint8_t drvid)
 
 #define TOTAL_DRIVER_COUNT    (_app_driver_count + BUILTIN_DRIVER_COUNT)
 
+// Driver callbacks used by tud_task() and SET_CONFIGURATION. Application drivers are always called through
+// their table, built-in ones with CFG_TUD_DRIVER_STATIC_DISPATCH by direct calls the compiler can inline.
+#if CFG_TUD_DRIVER_STATIC_DISPATCH
+
+#define DRIVER_CASE_RESET(_id, _name, _init, _reset, _open, _control_xfer_cb, _xfer_cb) \
+  case BUILTIN_DRVID_##_id: _reset(rhport); return;
+
+#define DRIVER_CASE_OPEN(_id, _name, _init, _reset, _open, _control_xfer_cb, _xfer_cb) \
+  case BUILTIN_DRVID_##_id: return _open(rhport, desc_itf, max_len);
+
+#define DRIVER_CASE_XFER_CB(_id, _name, _init, _reset, _open, _control_xfer_cb, _xfer_cb) \
+  case BUILTIN_DRVID_##_id: return _xfer_cb(rhport, ep_addr, result, xferred_bytes);
+
+static void driver_reset(uint8_t drvid, uint8_t rhport)
+{
+  if ( drvid >= _app_driver_count )
+  {
+    switch ( drvid - _app_driver_count )
+    {
+      USBD_BUILTIN_DRIVERS(DRIVER_CASE_RESET)
+      default: return;
+    }
+  }
+
+  get_driver(drvid)->reset(rhport);
+}
+
+static uint16_t driver_open(uint8_t drvid, uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t max_len)
+{
+  if ( drvid >= _app_driver_count )
+  {
+    switch ( drvid - _app_driver_count )
+    {
+      USBD_BUILTIN_DRIVERS(DRIVER_CASE_OPEN)
+      default: return 0;
+    }
+  }
+
+  return get_driver(drvid)->open(rhport, desc_itf, max_len);
+}
+
+static bool driver_xfer_cb(uint8_t drvid, uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  if ( drvid >= _app_driver_count )
+  {
+    switch ( drvid - _app_driver_count )
+    {
+      USBD_BUILTIN_DRIVERS(DRIVER_CASE_XFER_CB)
+      default: return false;
+    }
+  }
+
+  return get_driver(drvid)->xfer_cb(rhport, ep_addr, result, xferred_bytes);
+}
+
+#else
+
+TU_ATTR_ALWAYS_INLINE static inline void driver_reset(uint8_t drvid, uint8_t rhport)
+{
+  get_driver(drvid)->reset(rhport);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline
+uint16_t driver_open(uint8_t drvid, uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t max_len)
+{
+  return get_driver(drvid)->open(rhport, desc_itf, max_len);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline
+bool driver_xfer_cb(uint8_t drvid, uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  return get_driver(drvid)->xfer_cb(rhport, ep_addr, result, xferred_bytes);
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // DCD Event
 //--------------------------------------------------------------------+
 
 static bool _usbd_initialized = false;
 
-// Event queue
+// Event queues, one per priority. _usbd_q holds transfer complete events and is the one
+// tud_task() waits on, events posted to the others wake it up with USBD_EVENT_WAKEUP.
 // OPT_MODE_DEVICE is used by OS NONE for mutex (disable usb isr)
+OSAL_QUEUE_DEF(OPT_MODE_DEVICE, _usbd_qdef_high, CFG_TUD_TASK_QUEUE_HIGH_SZ, dcd_event_t);
 OSAL_QUEUE_DEF(OPT_MODE_DEVICE, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
+OSAL_QUEUE_DEF(OPT_MODE_DEVICE, _usbd_qdef_low, CFG_TUD_TASK_QUEUE_LOW_SZ, dcd_event_t);
+static osal_queue_t _usbd_q_high;
 static osal_queue_t _usbd_q;
+static osal_queue_t _usbd_q_low;
+
+// USBD_EVENT_WAKEUP (from tud_task_wakeup() or for events posted to _usbd_q_high/_usbd_q_low) is in
+// _usbd_q, at most one is queued so that wake ups can't fill it and cause transfer completions to be dropped
+static volatile bool _usbd_wakeup_queued;
+
+// SOFs received since last SOF event was processed, only one SOF event is queued at a time
+static volatile uint32_t _usbd_sof_count;
+
+// SOF users: class drivers with sof()/sof_frames() callback plus one for all armed timers.
+// SOF is only queued (and enabled if DCD supports it) while there is any.
+static volatile uint8_t _usbd_sof_ref;
+
+// SOF timer wheel, armed timers are linked in slot of their expiring frame
+static usbd_timer_t* _usbd_timer_wheel[CFG_TUD_TIMER_WHEEL_SZ];
+static usbd_timer_t* _usbd_timer_expired; // expired, callback not invoked yet
+static uint16_t      _usbd_timer_count;   // armed timers
+static uint32_t      _usbd_frame;         // SOFs processed by tud_task()
+
+static tud_task_stats_t _usbd_task_stats;
 
 // Mutex for claiming endpoint, only needed when using with preempted RTOS
 #if CFG_TUSB_OS != OPT_OS_NONE
@@ -288,7 +454,16 @@ static osal_mutex_t _usbd_mutex;
 //--------------------------------------------------------------------+
 static bool process_control_request(uint8_t rhport, tusb_control_request_t const * p_request);
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num);
+static void edpt_xfer_done(uint8_t epnum, uint8_t dir);
+#if CFG_TUD_EDPT_LATENCY
+static void edpt_latency_record(dcd_event_t const * event);
+#endif
 static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const * p_request);
+static bool usbd_event_post(dcd_event_t const * event, bool in_isr);
+static bool usbd_wakeup_post(uint8_t rhport, bool in_isr);
+static void sof_ref(uint8_t rhport, bool add);
+static void timer_disarm_all(uint8_t rhport);
+static void timer_wheel_advance(uint8_t rhport, uint32_t frame_count);
 
 // from usbd_control.c
 void usbd_control_reset(void);
@@ -311,7 +486,8 @@ static char const* const _usbd_event_str[DCD_EVENT_COUNT] =
   "Resume"         ,
   "Setup Received" ,
   "Xfer Complete"  ,
-  "Func Call"
+  "Func Call"      ,
+  "Wakeup"
 };
 
 static char const* const _tusb_std_request_str[] =
@@ -349,6 +525,41 @@ void usbd_driver_print_control_complete_name(usbd_control_xfer_cb_t callback)
 
 #endif
 
+// Trace a DCD event with its payload packed as documented in tusb_trace.h
+TU_ATTR_ALWAYS_INLINE static inline void trace_dcd_event(uint8_t trace_event, dcd_event_t const * event, uint8_t driver)
+{
+#if CFG_TUSB_TRACE
+  uint8_t  ep_addr = 0;
+  uint8_t  result  = 0;
+  uint32_t len     = 0;
+
+  switch ( event->event_id )
+  {
+    case DCD_EVENT_XFER_COMPLETE:
+      ep_addr = event->xfer_complete.ep_addr;
+      result  = event->xfer_complete.result;
+      len     = event->xfer_complete.len;
+    break;
+
+    case DCD_EVENT_SETUP_RECEIVED:
+      driver  = event->setup_received.bmRequestType;
+      result  = event->setup_received.bRequest;
+      len     = tu_le16toh(event->setup_received.wValue) | ((uint32_t) tu_le16toh(event->setup_received.wIndex) << 16);
+    break;
+
+    case DCD_EVENT_BUS_RESET:
+      len     = event->bus_reset.speed;
+    break;
+
+    default: break;
+  }
+
+  tusb_trace_record((uint8_t) (trace_event + event->event_id), ep_addr, driver, result, len);
+#else
+  (void) trace_event; (void) event; (void) driver;
+#endif
+}
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -418,8 +629,11 @@ bool tud_init (uint8_t rhport)
 #endif
 
   // Init device queue & task
-  _usbd_q = osal_queue_create(&_usbd_qdef);
-  TU_ASSERT(_usbd_q);
+  _usbd_q_high = osal_queue_create(&_usbd_qdef_high);
+  _usbd_q      = osal_queue_create(&_usbd_qdef);
+  _usbd_q_low  = osal_queue_create(&_usbd_qdef_low);
+  TU_ASSERT(_usbd_q_high && _usbd_q && _usbd_q_low);
+  _usbd_wakeup_queued = false;
 
   // Get application driver if available
   if ( usbd_app_driver_get_cb )
@@ -433,10 +647,13 @@ bool tud_init (uint8_t rhport)
     usbd_class_driver_t const * driver = get_driver(i);
     TU_LOG2("%s init\r\n", driver->name);
     driver->init();
+
+    if ( driver->sof || driver->sof_frames ) _usbd_sof_ref++;
   }
 
   // Init device controller driver
   dcd_init(rhport);
+  if ( _usbd_sof_ref && dcd_sof_enable ) dcd_sof_enable(rhport, true);
   dcd_int_enable(rhport);
 
   _usbd_initialized = true;
@@ -446,14 +663,33 @@ bool tud_init (uint8_t rhport)
 
 static void configuration_reset(uint8_t rhport)
 {
+  // before drivers reset so that they can clear their timer storage
+  timer_disarm_all(rhport);
+
   for ( uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++ )
   {
-    get_driver(i)->reset(rhport);
+    driver_reset(i, rhport);
   }
 
   tu_varclr(&_usbd_dev);
+#if CFG_TUD_EDPT_XFER_CHUNK
+  tu_varclr(&_usbd_xfer);
+#endif
+#if CFG_TUD_EDPT_QUEUE_SZ
+  tu_varclr(&_usbd_edpt_q);
+#endif
+#if CFG_TUD_EDPT_ISR_CB
+  tu_varclr(&_usbd_edpt_isr_cb);
+#endif
   memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
   memset(_usbd_dev.ep2drv , DRVID_INVALID, sizeof(_usbd_dev.ep2drv )); // invalid mapping
+
+  // all endpoints are closed: completions still queued are stale
+  for ( uint8_t epnum = 1; epnum < CFG_TUD_ENDPPOINT_MAX; epnum++ )
+  {
+    _usbd_ep_gen[epnum][TUSB_DIR_OUT]++;
+    _usbd_ep_gen[epnum][TUSB_DIR_IN ]++;
+  }
 }
 
 static void usbd_reset(uint8_t rhport)
@@ -467,12 +703,49 @@ bool tud_task_event_ready(void)
   // Skip if stack is not initialized
   if ( !tusb_inited() ) return false;
 
-  return !osal_queue_empty(_usbd_q);
+  return !(osal_queue_empty(_usbd_q_high) && osal_queue_empty(_usbd_q) && osal_queue_empty(_usbd_q_low));
+}
+
+bool tud_task_wakeup(bool in_isr)
+{
+  TU_VERIFY(tusb_inited());
+
+  return usbd_wakeup_post(0, in_isr);
+}
+
+void tud_task_stats_get(tud_task_stats_t* stats)
+{
+  *stats = _usbd_task_stats;
+}
+
+void tud_task_stats_reset(void)
+{
+  tu_varclr(&_usbd_task_stats);
+}
+
+// Get next event by priority. Only wait (RTOS) on transfer queue when all queues are empty.
+static bool usbd_event_get(dcd_event_t* event, uint32_t timeout_ms, bool in_isr)
+{
+  if ( in_isr )
+  {
+    // osal_queue_empty() is not isr safe on all ports, a non-blocking receive is
+    return osal_queue_receive(_usbd_q_high, event, OSAL_TIMEOUT_NOTIMEOUT, true) ||
+           osal_queue_receive(_usbd_q     , event, OSAL_TIMEOUT_NOTIMEOUT, true) ||
+           osal_queue_receive(_usbd_q_low , event, OSAL_TIMEOUT_NOTIMEOUT, true);
+  }
+
+  if ( !osal_queue_empty(_usbd_q_high) ) return osal_queue_receive(_usbd_q_high, event, OSAL_TIMEOUT_NOTIMEOUT, false);
+  if ( !osal_queue_empty(_usbd_q)      ) return osal_queue_receive(_usbd_q, event, OSAL_TIMEOUT_NOTIMEOUT, false);
+  if ( !osal_queue_empty(_usbd_q_low)  ) return osal_queue_receive(_usbd_q_low, event, OSAL_TIMEOUT_NOTIMEOUT, false);
+
+  return osal_queue_receive(_usbd_q, event, timeout_ms, false);
 }
 
 /* USB Device Driver task
  * This top level thread manages all device controller event and delegates events to class-specific drivers.
- * This should be called periodically within the mainloop or rtos thread.
+ * This should be called periodically within the mainloop or rtos thread. With an RTOS, it waits
+ * up to timeout_ms for the first event (never if in_isr), processes all queued events then returns.
+ * in_isr only affects the event queue access, see usbd.h
  *
    @code
     int main(void)
@@ -488,7 +761,7 @@ bool tud_task_event_ready(void)
     }
     @endcode
  */
-void tud_task (void)
+void tud_task_ext(uint32_t timeout_ms, bool in_isr)
 {
   // Skip if stack is not initialized
   if ( !tusb_inited() ) return;
@@ -498,7 +771,12 @@ void tud_task (void)
   {
     dcd_event_t event;
 
-    if ( !osal_queue_receive(_usbd_q, &event) ) return;
+    if ( !usbd_event_get(&event, timeout_ms, in_isr) ) return;
+
+    // only block for the first event
+    timeout_ms = OSAL_TIMEOUT_NOTIMEOUT;
+
+    trace_dcd_event(TUSB_TRACE_USBD_QUEUE_GET, &event, TUSB_TRACE_NO_DRIVER);
 
 #if CFG_TUSB_DEBUG >= 2
     if (event.event_id == DCD_EVENT_SETUP_RECEIVED) TU_LOG2("\r\n"); // extra line for setup
@@ -554,20 +832,39 @@ void tud_task (void)
 
         TU_LOG2("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
 
-        _usbd_dev.ep_status[epnum][ep_dir].busy = false;
-        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+        // endpoint closed (configuration or alternate setting changed) since this completion was queued
+        if ( epnum && event.xfer_complete.gen != _usbd_ep_gen[epnum][ep_dir] )
+        {
+          TU_LOG2("  Stale, dropped\r\n");
+          break;
+        }
+
+#if CFG_TUD_EDPT_QUEUE_SZ && CFG_TUSB_OS != OPT_OS_NONE
+        osal_mutex_lock(_usbd_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+        edpt_xfer_done(epnum, ep_dir);
+        osal_mutex_unlock(_usbd_mutex);
+#else
+        edpt_xfer_done(epnum, ep_dir);
+#endif
+
+#if CFG_TUD_EDPT_LATENCY
+        edpt_latency_record(&event);
+#endif
 
         if ( 0 == epnum )
         {
+          TU_TRACE(TUSB_TRACE_USBD_CONTROL_XFER_CB, ep_addr, TUSB_TRACE_NO_DRIVER, event.xfer_complete.result, event.xfer_complete.len);
           usbd_control_xfer_cb(event.rhport, ep_addr, (xfer_result_t)event.xfer_complete.result, event.xfer_complete.len);
         }
         else
         {
-          usbd_class_driver_t const * driver = get_driver( _usbd_dev.ep2drv[epnum][ep_dir] );
+          uint8_t const drvid = _usbd_dev.ep2drv[epnum][ep_dir];
+          usbd_class_driver_t const * driver = get_driver(drvid);
           TU_ASSERT(driver, );
 
           TU_LOG2("  %s xfer callback\r\n", driver->name);
-          driver->xfer_cb(event.rhport, ep_addr, (xfer_result_t)event.xfer_complete.result, event.xfer_complete.len);
+          TU_TRACE(TUSB_TRACE_USBD_CLASS_XFER_CB, ep_addr, drvid, event.xfer_complete.result, event.xfer_complete.len);
+          driver_xfer_cb(drvid, event.rhport, ep_addr, (xfer_result_t)event.xfer_complete.result, event.xfer_complete.len);
         }
       }
       break;
@@ -598,12 +895,34 @@ void tud_task (void)
       break;
 
       case DCD_EVENT_SOF:
-        TU_LOG2("\r\n");
+      {
+        // take all SOFs coalesced into this event
+        dcd_int_disable(event.rhport);
+        uint32_t const frame_count = _usbd_sof_count;
+        _usbd_sof_count = 0;
+        dcd_int_enable(event.rhport);
+
+        TU_LOG2(": %lu frames\r\n", (unsigned long) frame_count);
         for ( uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++ )
         {
           usbd_class_driver_t const * driver = get_driver(i);
-          if ( driver->sof ) driver->sof(event.rhport);
+          if ( driver->sof_frames )
+          {
+            driver->sof_frames(event.rhport, frame_count);
+          }else if ( driver->sof )
+          {
+            // drivers written before SOF coalescing expect one call per frame
+            for ( uint32_t f = 0; f < frame_count; f++ ) driver->sof(event.rhport);
+          }
         }
+
+        timer_wheel_advance(event.rhport, frame_count);
+      }
+      break;
+
+      case USBD_EVENT_WAKEUP:
+        TU_LOG2("\r\n");
+        _usbd_wakeup_queued = false;
       break;
 
       case USBD_EVENT_FUNC_CALL:
@@ -884,16 +1203,91 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 
 // Process Set Configure Request
 // This function parse configuration descriptor & open drivers accordingly
+#if CFG_TUD_BIND_CACHE
+// Open drivers bound by the cached plan if it is computed from this configuration descriptor.
+// Return false without side effect if there is no matching plan. If a driver does not claim the same
+// length as before, all drivers are reset for the caller to probe again.
+static bool bind_plan_replay(uint8_t rhport, uint8_t cfg_num, tusb_desc_configuration_t const* desc_cfg)
+{
+  uint16_t const total_len = tu_le16toh(desc_cfg->wTotalLength);
+
+  TU_VERIFY(_usbd_bind_plan.cfg_num == cfg_num && _usbd_bind_plan.desc_cfg == (uint8_t const*) desc_cfg &&
+            _usbd_bind_plan.total_len == total_len);
+
+  uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
+  uint8_t const * desc_end = ((uint8_t const*) desc_cfg) + total_len;
+
+  for ( uint8_t i = 0; i < _usbd_bind_plan.func_count; i++ )
+  {
+    if ( TUSB_DESC_INTERFACE_ASSOCIATION == tu_desc_type(p_desc) ) p_desc = tu_desc_next(p_desc);
+
+    uint8_t const drv_id = _usbd_bind_plan.func[i].drv_id;
+    uint16_t const drv_len = (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) ?
+        driver_open(drv_id, rhport, (tusb_desc_interface_t const*) p_desc, (uint16_t) (desc_end-p_desc)) : 0;
+
+    if ( drv_len != _usbd_bind_plan.func[i].drv_len )
+    {
+      // descriptor content changed: start over
+      TU_LOG2("  Binding plan mismatched\r\n");
+      _usbd_bind_plan.cfg_num = 0;
+
+      dcd_edpt_close_all(rhport);
+
+      // only drop what is opened so far, bus state is kept since the same SET_CONFIGURATION goes on
+      uint8_t const speed            = _usbd_dev.speed;
+      uint8_t const connected        = _usbd_dev.connected;
+      uint8_t const addressed        = _usbd_dev.addressed;
+      uint8_t const remote_wakeup_en = _usbd_dev.remote_wakeup_en;
+      configuration_reset(rhport);
+      _usbd_dev.speed            = speed;
+      _usbd_dev.connected        = connected        ? 1 : 0;
+      _usbd_dev.addressed        = addressed        ? 1 : 0;
+      _usbd_dev.remote_wakeup_en = remote_wakeup_en ? 1 : 0;
+
+      return false;
+    }
+
+    TU_LOG2("  %s opened\r\n", get_driver(drv_id)->name);
+    TU_TRACE(TUSB_TRACE_USBD_CLASS_OPEN, ((tusb_desc_interface_t const*) p_desc)->bInterfaceNumber, drv_id, 0, drv_len);
+    p_desc += drv_len;
+  }
+
+  memcpy(_usbd_dev.itf2drv, _usbd_bind_plan.itf2drv, sizeof(_usbd_dev.itf2drv));
+  memcpy(_usbd_dev.ep2drv , _usbd_bind_plan.ep2drv , sizeof(_usbd_dev.ep2drv ));
+
+  return true;
+}
+#endif
+
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
 {
   // index is cfg_num-1
   tusb_desc_configuration_t const * desc_cfg = (tusb_desc_configuration_t const *) tud_descriptor_configuration_cb(cfg_num-1);
   TU_ASSERT(desc_cfg != NULL && desc_cfg->bDescriptorType == TUSB_DESC_CONFIGURATION);
 
+#if CFG_TUD_BIND_CACHE
+  // replay may fall back to probing after resetting the configuration: parse attributes afterwards
+  bool const replayed = bind_plan_replay(rhport, cfg_num, desc_cfg);
+  bool plan_overflow = false;
+  if ( !replayed )
+  {
+    _usbd_bind_plan.cfg_num    = 0;
+    _usbd_bind_plan.func_count = 0;
+  }
+#endif
+
   // Parse configuration descriptor
   _usbd_dev.remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1 : 0;
   _usbd_dev.self_powered          = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED ) ? 1 : 0;
 
+#if CFG_TUD_BIND_CACHE
+  if ( replayed )
+  {
+    if (tud_mount_cb) tud_mount_cb();
+    return true;
+  }
+#endif
+
   // Parse interface descriptor
   uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
   uint8_t const * desc_end = ((uint8_t const*) desc_cfg) + tu_le16toh(desc_cfg->wTotalLength);
@@ -923,13 +1317,16 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
     uint8_t drv_id;
     for (drv_id = 0; drv_id < TOTAL_DRIVER_COUNT; drv_id++)
     {
-      usbd_class_driver_t const *driver = get_driver(drv_id);
-      uint16_t const drv_len = driver->open(rhport, desc_itf, remaining_len);
+      uint16_t const drv_len = driver_open(drv_id, rhport, desc_itf, remaining_len);
 
       if ( (sizeof(tusb_desc_interface_t) <= drv_len)  && (drv_len <= remaining_len) )
       {
+        usbd_class_driver_t const *driver = get_driver(drv_id);
+        (void) driver; // only used by debug log and multiple interfaces drivers
+
         // Open successfully
         TU_LOG2("  %s opened\r\n", driver->name);
+        TU_TRACE(TUSB_TRACE_USBD_CLASS_OPEN, desc_itf->bInterfaceNumber, drv_id, 0, drv_len);
 
         // Some drivers use 2 or more interfaces but may not have IAD e.g MIDI (always) or
         // BTH (even CDC) with class in device descriptor (single interface)
@@ -961,6 +1358,19 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
         // bind all endpoints to found driver
         tu_edpt_bind_driver(_usbd_dev.ep2drv, desc_itf, drv_len, drv_id);
 
+#if CFG_TUD_BIND_CACHE
+        // plan is only a cache: if it can't hold all functions, stop recording and leave it invalid
+        if ( _usbd_bind_plan.func_count < TU_ARRAY_SIZE(_usbd_bind_plan.func) )
+        {
+          _usbd_bind_plan.func[_usbd_bind_plan.func_count].drv_id  = drv_id;
+          _usbd_bind_plan.func[_usbd_bind_plan.func_count].drv_len = drv_len;
+          _usbd_bind_plan.func_count++;
+        }else
+        {
+          plan_overflow = true;
+        }
+#endif
+
         // next Interface
         p_desc += drv_len;
 
@@ -972,6 +1382,17 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
     TU_ASSERT(drv_id < TOTAL_DRIVER_COUNT);
   }
 
+#if CFG_TUD_BIND_CACHE
+  if ( !plan_overflow )
+  {
+    _usbd_bind_plan.desc_cfg  = (uint8_t const*) desc_cfg;
+    _usbd_bind_plan.total_len = tu_le16toh(desc_cfg->wTotalLength);
+    _usbd_bind_plan.cfg_num   = cfg_num;
+    memcpy(_usbd_bind_plan.itf2drv, _usbd_dev.itf2drv, sizeof(_usbd_dev.itf2drv));
+    memcpy(_usbd_bind_plan.ep2drv , _usbd_dev.ep2drv , sizeof(_usbd_dev.ep2drv ));
+  }
+#endif
+
   // invoke callback
   if (tud_mount_cb) tud_mount_cb();
 
@@ -1087,16 +1508,305 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
-void dcd_event_handler(dcd_event_t const * event, bool in_isr)
+
+#if CFG_TUD_EDPT_XFER_CHUNK
+// Submit first chunk of a transfer to DCD, the rest is submitted by edpt_xfer_next_chunk()
+static bool edpt_xfer_start(uint8_t rhport, uint8_t ep_addr, void* buf, uint32_t total_bytes, bool is_fifo)
 {
-  switch (event->event_id)
+  usbd_xfer_t* xfer = &_usbd_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint16_t chunk = (uint16_t) total_bytes;
+
+  // chunks must end on a packet boundary, a short packet would end the transfer on the bus
+  if ( total_bytes > UINT16_MAX )
   {
-    case DCD_EVENT_UNPLUGGED:
+    TU_ASSERT(xfer->chunk_max);
+    chunk = xfer->chunk_max;
+  }
+
+  // must be set up before submitting since transfer can complete before DCD returns
+  xfer->is_fifo   = is_fifo;
+  xfer->buf       = is_fifo ? buf : ((uint8_t*) buf) + chunk;
+  xfer->remaining = total_bytes - chunk;
+  xfer->xferred   = 0;
+
+  bool const ret = is_fifo ? dcd_edpt_xfer_fifo(rhport, ep_addr, (tu_fifo_t*) buf, chunk) :
+                             dcd_edpt_xfer(rhport, ep_addr, (uint8_t*) buf, chunk);
+  if ( !ret ) xfer->remaining = 0;
+
+  return ret;
+}
+
+// Submit the next chunk if the one just completed was full. Return true if the transfer
+// continues, otherwise event is updated with the length of the whole transfer.
+static bool edpt_xfer_next_chunk(dcd_event_t* event)
+{
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  usbd_xfer_t* xfer = &_usbd_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  if ( xfer->remaining && event->xfer_complete.result == XFER_RESULT_SUCCESS &&
+       event->xfer_complete.len == xfer->chunk_max )
+  {
+    uint16_t const chunk = (uint16_t) tu_min32(xfer->remaining, xfer->chunk_max);
+    void* const buf = xfer->buf;
+
+    xfer->xferred   += xfer->chunk_max;
+    xfer->remaining -= chunk;
+    if ( !xfer->is_fifo ) xfer->buf = ((uint8_t*) buf) + chunk;
+
+    bool const ret = xfer->is_fifo ? dcd_edpt_xfer_fifo(event->rhport, ep_addr, (tu_fifo_t*) buf, chunk) :
+                                     dcd_edpt_xfer(event->rhport, ep_addr, (uint8_t*) buf, chunk);
+    if ( ret ) return true;
+
+    event->xfer_complete.result = XFER_RESULT_FAILED;
+  }
+
+  // short packet, error or last chunk: report the whole transfer
+  event->xfer_complete.len += xfer->xferred;
+  xfer->remaining = 0;
+  xfer->xferred   = 0;
+
+  return false;
+}
+#else
+static bool edpt_xfer_start(uint8_t rhport, uint8_t ep_addr, void* buf, uint32_t total_bytes, bool is_fifo)
+{
+  // transfers larger than dcd_edpt_xfer() can take need CFG_TUD_EDPT_XFER_CHUNK
+  TU_ASSERT(total_bytes <= UINT16_MAX);
+
+  return is_fifo ? dcd_edpt_xfer_fifo(rhport, ep_addr, (tu_fifo_t*) buf, (uint16_t) total_bytes) :
+                   dcd_edpt_xfer(rhport, ep_addr, (uint8_t*) buf, (uint16_t) total_bytes);
+}
+#endif
+
+// Completion is dispatched to class driver: update endpoint status as of tud_task()
+static void edpt_xfer_done(uint8_t epnum, uint8_t dir)
+{
+#if CFG_TUD_EDPT_QUEUE_SZ
+  usbd_edpt_queue_t* q = &_usbd_edpt_q[epnum][dir];
+  if ( q->count )
+  {
+    // endpoint stays busy until completion of the last queued transfer is dispatched
+    q->count--;
+    _usbd_dev.ep_status[epnum][dir].busy = (q->count != 0);
+  }else
+#endif
+  {
+    _usbd_dev.ep_status[epnum][dir].busy = false;
+  }
+  _usbd_dev.ep_status[epnum][dir].claimed = 0;
+}
+
+#if CFG_TUD_EDPT_LATENCY
+static void edpt_latency_record(dcd_event_t const * event)
+{
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  tud_edpt_latency_t* lat = &_usbd_edpt_latency[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint32_t const elapsed = tud_latency_timestamp_cb ? (tud_latency_timestamp_cb() - event->xfer_complete.stamp) : 0;
+
+  lat->count++;
+  lat->total += elapsed;
+  if ( elapsed > lat->max ) lat->max = elapsed;
+}
+
+void tud_edpt_latency_get(uint8_t ep_addr, tud_edpt_latency_t* latency)
+{
+  *latency = _usbd_edpt_latency[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+void tud_edpt_latency_reset(void)
+{
+  tu_varclr(&_usbd_edpt_latency);
+}
+#endif
+
+// Queue event by its priority
+static bool usbd_event_post(dcd_event_t const * event, bool in_isr)
+{
+  uint8_t prio;
+  osal_queue_t q;
+
+  switch ( event->event_id )
+  {
+    case DCD_EVENT_XFER_COMPLETE:
+      prio = tu_edpt_number(event->xfer_complete.ep_addr) ? TUD_EVENT_PRIO_XFER : TUD_EVENT_PRIO_HIGH;
+    break;
+
+    case DCD_EVENT_SOF:
+      prio = TUD_EVENT_PRIO_LOW;
+    break;
+
+    // bus events, setup and deferred function calls: DCDs defer work such as starting DMA with
+    // usbd_defer_func() which must not wait behind transfer completions or SOF
+    default:
+      prio = TUD_EVENT_PRIO_HIGH;
+    break;
+  }
+
+  q = (prio == TUD_EVENT_PRIO_HIGH) ? _usbd_q_high : (prio == TUD_EVENT_PRIO_XFER) ? _usbd_q : _usbd_q_low;
+
+  if ( !osal_queue_send(q, event, in_isr) )
+  {
+    _usbd_task_stats.overflow[prio]++;
+    TU_TRACE(TUSB_TRACE_USBD_QUEUE_OVERFLOW, 0, prio, event->event_id, 0);
+    return false;
+  }
+
+  trace_dcd_event(TUSB_TRACE_USBD_QUEUE_POST, event, prio);
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+  // tud_task() may be waiting on transfer queue. One pending wake up is enough since it checks all queues
+  // before waiting again. Best effort: if transfer queue is full, tud_task() is not waiting anyway.
+  if ( prio != TUD_EVENT_PRIO_XFER ) usbd_wakeup_post(event->rhport, in_isr);
+#endif
+
+  return true;
+}
+
+// Set _usbd_wakeup_queued, return false if it was already set
+TU_ATTR_ALWAYS_INLINE static inline bool wakeup_claim(uint8_t rhport, bool in_isr)
+{
+#if defined(__GCC_ATOMIC_BOOL_LOCK_FREE) && (__GCC_ATOMIC_BOOL_LOCK_FREE == 2)
+  (void) rhport; (void) in_isr;
+  return !__atomic_exchange_n(&_usbd_wakeup_queued, true, __ATOMIC_ACQ_REL);
+#else
+  // no lock-free exchange (e.g ARMv6-M): mask usb interrupt, other interrupts posting a wake up
+  // at the same time can at worst queue one extra
+  if ( !in_isr ) dcd_int_disable(rhport);
+  bool const claimed = !_usbd_wakeup_queued;
+  _usbd_wakeup_queued = true;
+  if ( !in_isr ) dcd_int_enable(rhport);
+  return claimed;
+#endif
+}
+
+// Queue USBD_EVENT_WAKEUP unless one is already pending
+static bool usbd_wakeup_post(uint8_t rhport, bool in_isr)
+{
+  if ( !wakeup_claim(rhport, in_isr) ) return true;
+
+  dcd_event_t const event = { .rhport = rhport, .event_id = USBD_EVENT_WAKEUP };
+  if ( !osal_queue_send(_usbd_q, &event, in_isr) )
+  {
+    _usbd_wakeup_queued = false;
+    _usbd_task_stats.overflow[TUD_EVENT_PRIO_XFER]++;
+    TU_TRACE(TUSB_TRACE_USBD_QUEUE_OVERFLOW, 0, TUD_EVENT_PRIO_XFER, USBD_EVENT_WAKEUP, 0);
+    return false;
+  }
+
+  trace_dcd_event(TUSB_TRACE_USBD_QUEUE_POST, &event, TUD_EVENT_PRIO_XFER);
+  return true;
+}
+
+// Hand over a transfer completion to its class driver: through the ISR hook if the endpoint has
+// one and we are in ISR, otherwise queued for tud_task()
+static void edpt_xfer_report(dcd_event_t const * event, bool in_isr)
+{
+#if CFG_TUD_EDPT_ISR_CB
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum   = tu_edpt_number(ep_addr);
+  uint8_t const dir     = tu_edpt_dir(ep_addr);
+  usbd_edpt_isr_cb_t const isr_cb = _usbd_edpt_isr_cb[epnum][dir];
+
+  if ( in_isr && isr_cb )
+  {
+    edpt_xfer_done(epnum, dir);
+  #if CFG_TUD_EDPT_LATENCY
+    edpt_latency_record(event);
+  #endif
+    TU_TRACE(TUSB_TRACE_USBD_CLASS_ISR_CB, ep_addr, _usbd_dev.ep2drv[epnum][dir], event->xfer_complete.result,
+             event->xfer_complete.len);
+    isr_cb(event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+    return;
+  }
+#endif
+
+  usbd_event_post(event, in_isr);
+}
+
+#if CFG_TUD_EDPT_QUEUE_SZ
+// Arm the next queued transfer of an endpoint right after the DCD completes the current one,
+// then forward the completion. If the DCD refuses to arm, the remaining queued transfers are
+// completed as failed so that the class driver still sees one xfer_cb() per submission.
+static void edpt_queue_xfer_complete(dcd_event_t const * event, bool in_isr)
+{
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  usbd_edpt_queue_t* q = &_usbd_edpt_q[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  bool failed = false;
+  if ( q->armed )
+  {
+    if ( q->rd == q->wr )
+    {
+      q->armed = false;
+    }else
+    {
+      uint8_t const idx = q->rd % CFG_TUD_EDPT_QUEUE_SZ;
+      if ( edpt_xfer_start(event->rhport, ep_addr, q->req[idx].buffer, q->req[idx].total_bytes, false) )
+      {
+        q->rd++;
+      }else
+      {
+        q->armed = false;
+        failed   = true;
+      }
+    }
+  }
+
+  edpt_xfer_report(event, in_isr);
+
+  if ( failed )
+  {
+    dcd_event_t event_failed = { .rhport = event->rhport, .event_id = DCD_EVENT_XFER_COMPLETE };
+    event_failed.xfer_complete.ep_addr = ep_addr;
+    event_failed.xfer_complete.result  = XFER_RESULT_FAILED;
+    event_failed.xfer_complete.gen     = event->xfer_complete.gen;
+#if CFG_TUD_EDPT_LATENCY
+    event_failed.xfer_complete.stamp   = event->xfer_complete.stamp;
+#endif
+
+    while ( q->rd != q->wr )
+    {
+      q->rd++;
+      edpt_xfer_report(&event_failed, in_isr);
+    }
+  }
+}
+#endif
+
+void dcd_event_handler(dcd_event_t const * event, bool in_isr)
+{
+  trace_dcd_event(TUSB_TRACE_DCD_EVENT, event, TUSB_TRACE_NO_DRIVER);
+
+  switch (event->event_id)
+  {
+    case DCD_EVENT_XFER_COMPLETE:
+    {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      dcd_event_t event_xfer = *event;
+      event_xfer.xfer_complete.gen = _usbd_ep_gen[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+#if CFG_TUD_EDPT_LATENCY
+      event_xfer.xfer_complete.stamp = tud_latency_timestamp_cb ? tud_latency_timestamp_cb() : 0;
+#endif
+
+#if CFG_TUD_EDPT_XFER_CHUNK
+      // large transfer continues with its next chunk, completion is reported after the last one
+      if ( edpt_xfer_next_chunk(&event_xfer) ) break;
+#endif
+
+#if CFG_TUD_EDPT_QUEUE_SZ
+      edpt_queue_xfer_complete(&event_xfer, in_isr);
+#else
+      edpt_xfer_report(&event_xfer, in_isr);
+#endif
+    }
+    break;
+
+    case DCD_EVENT_UNPLUGGED:
       _usbd_dev.connected  = 0;
       _usbd_dev.addressed  = 0;
       _usbd_dev.cfg_num    = 0;
       _usbd_dev.suspended  = 0;
-      osal_queue_send(_usbd_q, event, in_isr);
+      usbd_event_post(event, in_isr);
     break;
 
     case DCD_EVENT_SUSPEND:
@@ -1107,7 +1817,7 @@ void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       if ( _usbd_dev.connected )
       {
         _usbd_dev.suspended = 1;
-        osal_queue_send(_usbd_q, event, in_isr);
+        usbd_event_post(event, in_isr);
       }
     break;
 
@@ -1116,7 +1826,7 @@ void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       if ( _usbd_dev.connected )
       {
         _usbd_dev.suspended = 0;
-        osal_queue_send(_usbd_q, event, in_isr);
+        usbd_event_post(event, in_isr);
       }
     break;
 
@@ -1127,12 +1837,25 @@ void dcd_event_handler(dcd_event_t const * event, bool in_isr)
       {
         _usbd_dev.suspended = 0;
         dcd_event_t const event_resume = { .rhport = event->rhport, .event_id = DCD_EVENT_RESUME };
-        osal_queue_send(_usbd_q, &event_resume, in_isr);
+        usbd_event_post(&event_resume, in_isr);
+      }
+
+      // coalesce SOFs while one is still queued
+      if ( _usbd_sof_ref )
+      {
+        if ( 0 == _usbd_sof_count++ )
+        {
+          // nothing will consume the count if event is dropped
+          if ( !usbd_event_post(event, in_isr) ) _usbd_sof_count = 0;
+        }else
+        {
+          _usbd_task_stats.sof_coalesced++;
+        }
       }
     break;
 
     default:
-      osal_queue_send(_usbd_q, event, in_isr);
+      usbd_event_post(event, in_isr);
     break;
   }
 }
@@ -1175,13 +1898,18 @@ void dcd_event_xfer_complete (uint8_t rhport, uint8_t ep_addr, uint32_t xferred_
 
 // Parse consecutive endpoint descriptors (IN & OUT)
 bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in)
+{
+  return usbd_open_edpt_pair_ctx(rhport, p_desc, ep_count, xfer_type, ep_out, ep_in, NULL);
+}
+
+bool usbd_open_edpt_pair_ctx(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in, void* ctx)
 {
   for(int i=0; i<ep_count; i++)
   {
     tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_desc;
 
     TU_ASSERT(TUSB_DESC_ENDPOINT == desc_ep->bDescriptorType && xfer_type == desc_ep->bmAttributes.xfer);
-    TU_ASSERT(usbd_edpt_open(rhport, desc_ep));
+    TU_ASSERT(usbd_edpt_open_ctx(rhport, desc_ep, ctx));
 
     if ( tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN )
     {
@@ -1212,18 +1940,174 @@ void usbd_defer_func(osal_task_func_t func, void* param, bool in_isr)
   dcd_event_handler(&event, in_isr);
 }
 
+//--------------------------------------------------------------------+
+// SOF Timer
+//--------------------------------------------------------------------+
+
+static void sof_ref(uint8_t rhport, bool add)
+{
+  if ( add )
+  {
+    if ( 0 == _usbd_sof_ref++ && dcd_sof_enable ) dcd_sof_enable(rhport, true);
+  }
+  else
+  {
+    if ( 0 == --_usbd_sof_ref && dcd_sof_enable ) dcd_sof_enable(rhport, false);
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline usbd_timer_t** timer_slot(uint32_t frame)
+{
+  return &_usbd_timer_wheel[frame & (CFG_TUD_TIMER_WHEEL_SZ-1)];
+}
+
+static void timer_link(usbd_timer_t** head, usbd_timer_t* timer)
+{
+  timer->next  = *head;
+  timer->pprev = head;
+  if ( *head ) (*head)->pprev = &timer->next;
+  *head = timer;
+}
+
+static void timer_unlink(usbd_timer_t* timer)
+{
+  *timer->pprev = timer->next;
+  if ( timer->next ) timer->next->pprev = timer->pprev;
+  timer->next  = NULL;
+  timer->pprev = NULL;
+}
+
+static void timer_disarm_all(uint8_t rhport)
+{
+  if ( 0 == _usbd_timer_count ) return;
+
+  for ( uint8_t i = 0; i < CFG_TUD_TIMER_WHEEL_SZ; i++ )
+  {
+    while ( _usbd_timer_wheel[i] ) timer_unlink(_usbd_timer_wheel[i]);
+  }
+  while ( _usbd_timer_expired ) timer_unlink(_usbd_timer_expired);
+
+  _usbd_timer_count = 0;
+  sof_ref(rhport, false);
+}
+
+// Fire timers expired within frame_count SOFs, each visited slot costs O(1) plus its timers
+static void timer_wheel_advance(uint8_t rhport, uint32_t frame_count)
+{
+  uint32_t const now = _usbd_frame + frame_count;
+
+  // SOFs coalesced over more than a wheel turn visit each slot once
+  uint32_t frame = (frame_count > CFG_TUD_TIMER_WHEEL_SZ) ? (now - CFG_TUD_TIMER_WHEEL_SZ) : _usbd_frame;
+  _usbd_frame = now;
+
+  while ( _usbd_timer_count && frame != now )
+  {
+    frame++;
+
+    // move expired timers out of the wheel first, callbacks may start/stop any timer
+    usbd_timer_t* timer = *timer_slot(frame);
+    while ( timer )
+    {
+      usbd_timer_t* next = timer->next;
+      if ( (int32_t) (now - timer->expire) >= 0 )
+      {
+        timer_unlink(timer);
+        timer_link(&_usbd_timer_expired, timer);
+      }
+      timer = next;
+    }
+
+    while ( _usbd_timer_expired )
+    {
+      timer = _usbd_timer_expired;
+      timer_unlink(timer);
+
+      if ( timer->period )
+      {
+        // keep phase unless periods were missed
+        timer->expire += timer->period;
+        if ( (int32_t) (now - timer->expire) >= 0 ) timer->expire = now + timer->period;
+        timer_link(timer_slot(timer->expire), timer);
+      }
+      else if ( 0 == --_usbd_timer_count )
+      {
+        sof_ref(rhport, false);
+      }
+
+      timer->cb(rhport, timer->ctx);
+    }
+  }
+}
+
+bool usbd_timer_start(uint8_t rhport, usbd_timer_t* timer, usbd_timer_cb_t cb, void* ctx, uint16_t frames, uint16_t period)
+{
+  TU_ASSERT(timer && cb);
+
+  if ( usbd_timer_armed(timer) )
+  {
+    timer_unlink(timer);
+  }
+  else if ( 0 == _usbd_timer_count++ )
+  {
+    sof_ref(rhport, true);
+  }
+
+  timer->cb     = cb;
+  timer->ctx    = ctx;
+  timer->period = period;
+  timer->expire = _usbd_frame + tu_max16(frames, 1);
+  timer_link(timer_slot(timer->expire), timer);
+
+  return true;
+}
+
+void usbd_timer_stop(uint8_t rhport, usbd_timer_t* timer)
+{
+  if ( !usbd_timer_armed(timer) ) return;
+
+  timer_unlink(timer);
+  if ( 0 == --_usbd_timer_count ) sof_ref(rhport, false);
+}
+
 //--------------------------------------------------------------------+
 // USBD Endpoint API
 //--------------------------------------------------------------------+
 
 bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
 {
-  TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
+  return usbd_edpt_open_ctx(rhport, desc_ep, NULL);
+}
+
+bool usbd_edpt_open_ctx(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep, void* ctx)
+{
+  uint8_t const ep_addr = desc_ep->bEndpointAddress;
+
+  TU_ASSERT(tu_edpt_number(ep_addr) < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
 
+  _usbd_dev.ep_ctx[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = ctx;
+
+#if CFG_TUD_EDPT_XFER_CHUNK
+  uint16_t const packet_size = tu_edpt_packet_size(desc_ep);
+  _usbd_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].chunk_max =
+      packet_size ? (uint16_t) (UINT16_MAX - (UINT16_MAX % packet_size)) : 0;
+#endif
+
   return dcd_edpt_open(rhport, desc_ep);
 }
 
+void usbd_edpt_ctx_set(uint8_t rhport, uint8_t ep_addr, void* ctx)
+{
+  (void) rhport;
+  _usbd_dev.ep_ctx[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = ctx;
+}
+
+void* usbd_edpt_ctx(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  return _usbd_dev.ep_ctx[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
 {
   (void) rhport;
@@ -1279,7 +2163,7 @@ bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
   return ret;
 }
 
-bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
@@ -1287,7 +2171,7 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   // TODO skip ready() check for now since enumeration also use this API
   // TU_VERIFY(tud_ready());
 
-  TU_LOG2("  Queue EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
+  TU_LOG2("  Queue EP %02X with %lu bytes ...\r\n", ep_addr, (unsigned long) total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
@@ -1296,11 +2180,15 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   // could return and USBD task can preempt and clear the busy
   _usbd_dev.ep_status[epnum][dir].busy = true;
 
-  if ( dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
+  // traced before submitting since transfer can complete before dcd_edpt_xfer() returns
+  TU_TRACE(TUSB_TRACE_USBD_XFER, ep_addr, _usbd_dev.ep2drv[epnum][dir], 1, total_bytes);
+
+  if ( edpt_xfer_start(rhport, ep_addr, buffer, total_bytes, false) )
   {
     return true;
   }else
   {
+    TU_TRACE(TUSB_TRACE_USBD_XFER, ep_addr, _usbd_dev.ep2drv[epnum][dir], 0, total_bytes);
     // DCD error, mark endpoint as ready to allow next transfer
     _usbd_dev.ep_status[epnum][dir].busy = false;
     _usbd_dev.ep_status[epnum][dir].claimed = 0;
@@ -1310,16 +2198,102 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   }
 }
 
+#if CFG_TUD_EDPT_QUEUE_SZ
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  usbd_edpt_queue_t* q = &_usbd_edpt_q[epnum][dir];
+
+  // control endpoint is driven by usbd_control
+  TU_ASSERT(epnum > 0);
+
+  TU_LOG2("  Queue EP %02X with %lu bytes (%u pending) ...\r\n", ep_addr, (unsigned long) total_bytes, q->count);
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+  osal_mutex_lock(_usbd_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+#endif
+
+  bool ret   = false;
+  bool start = false;
+
+  // endpoint must be idle or busy with queued transfers only
+  if ( !_usbd_dev.ep_status[epnum][dir].stalled && (q->count || !_usbd_dev.ep_status[epnum][dir].busy) )
+  {
+    // completion interrupt pops the queue, make check & push atomic with it
+    dcd_int_disable(rhport);
+
+    if ( !q->armed && (q->rd == q->wr) )
+    {
+      // nothing in flight: arm directly
+      q->armed = true;
+      start    = true;
+      ret      = true;
+    }
+    else if ( (uint8_t) (q->wr - q->rd) < CFG_TUD_EDPT_QUEUE_SZ )
+    {
+      uint8_t const idx = q->wr % CFG_TUD_EDPT_QUEUE_SZ;
+      q->req[idx].buffer      = buffer;
+      q->req[idx].total_bytes = total_bytes;
+      q->wr++;
+      ret = true;
+    }
+
+    if ( ret )
+    {
+      q->count++;
+      _usbd_dev.ep_status[epnum][dir].busy = true;
+    }
+
+    dcd_int_enable(rhport);
+  }
+
+  TU_TRACE(TUSB_TRACE_USBD_XFER_QUEUE, ep_addr, _usbd_dev.ep2drv[epnum][dir], ret, total_bytes);
+
+  if ( start && !edpt_xfer_start(rhport, ep_addr, buffer, total_bytes, false) )
+  {
+    // DCD error, queue is still empty since armed was not cleared
+    TU_TRACE(TUSB_TRACE_USBD_XFER_QUEUE, ep_addr, _usbd_dev.ep2drv[epnum][dir], 0, total_bytes);
+    q->armed = false;
+    q->count--;
+    _usbd_dev.ep_status[epnum][dir].busy = false;
+    TU_LOG2("FAILED\r\n");
+    TU_BREAKPOINT();
+    ret = false;
+  }
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+  osal_mutex_unlock(_usbd_mutex);
+#endif
+
+  return ret;
+}
+
+uint8_t usbd_edpt_queue_count(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  return _usbd_edpt_q[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].count;
+}
+
+// Drop transfers that are not armed yet, used when the endpoint is stalled or closed
+static void edpt_queue_flush(uint8_t rhport, uint8_t epnum, uint8_t dir)
+{
+  dcd_int_disable(rhport);
+  tu_varclr(&_usbd_edpt_q[epnum][dir]);
+  dcd_int_enable(rhport);
+}
+#endif
+
 // The number of bytes has to be given explicitly to allow more flexible control of how many
 // bytes should be written and second to keep the return value free to give back a boolean
 // success message. If total_bytes is too big, the FIFO will copy only what is available
 // into the USB buffer!
-bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint32_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
-  TU_LOG2("  Queue ISO EP %02X with %u bytes ... ", ep_addr, total_bytes);
+  TU_LOG2("  Queue ISO EP %02X with %lu bytes ... ", ep_addr, (unsigned long) total_bytes);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
@@ -1328,7 +2302,7 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   // and usbd task can preempt and clear the busy
   _usbd_dev.ep_status[epnum][dir].busy = true;
 
-  if (dcd_edpt_xfer_fifo(rhport, ep_addr, ff, total_bytes))
+  if (edpt_xfer_start(rhport, ep_addr, ff, total_bytes, true))
   {
     TU_LOG2("OK\r\n");
     return true;
@@ -1343,6 +2317,23 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   }
 }
 
+#if CFG_TUD_EDPT_ISR_CB
+bool usbd_edpt_isr_cb_set(uint8_t rhport, uint8_t ep_addr, usbd_edpt_isr_cb_t cb)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  // control endpoint is driven by usbd_control
+  TU_ASSERT(epnum > 0 && epnum < CFG_TUD_ENDPPOINT_MAX);
+
+  dcd_int_disable(rhport);
+  _usbd_edpt_isr_cb[epnum][dir] = cb;
+  dcd_int_enable(rhport);
+
+  return true;
+}
+#endif
+
 bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
 {
   (void) rhport;
@@ -1364,6 +2355,13 @@ void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   {
     TU_LOG(USBD_DBG, "    Stall EP %02X\r\n", ep_addr);
     dcd_edpt_stall(rhport, ep_addr);
+#if CFG_TUD_EDPT_XFER_CHUNK
+    _usbd_xfer[epnum][dir].remaining = 0;
+    _usbd_xfer[epnum][dir].xferred   = 0;
+#endif
+#if CFG_TUD_EDPT_QUEUE_SZ
+    edpt_queue_flush(rhport, epnum, dir);
+#endif
     _usbd_dev.ep_status[epnum][dir].stalled = true;
     _usbd_dev.ep_status[epnum][dir].busy = true;
   }
@@ -1397,7 +2395,8 @@ bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr)
 /**
  * usbd_edpt_close will disable an endpoint.
  *
- * In progress transfers on this EP may be delivered after this call.
+ * Completions already queued for tud_task() are dropped, in progress transfers
+ * on this EP may still be delivered after this call.
  *
  */
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
@@ -1409,9 +2408,20 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_edpt_close(rhport, ep_addr);
+  _usbd_ep_gen[epnum][dir]++;
+#if CFG_TUD_EDPT_XFER_CHUNK
+  tu_varclr(&_usbd_xfer[epnum][dir]);
+#endif
+#if CFG_TUD_EDPT_ISR_CB
+  _usbd_edpt_isr_cb[epnum][dir] = NULL;
+#endif
+#if CFG_TUD_EDPT_QUEUE_SZ
+  edpt_queue_flush(rhport, epnum, dir);
+#endif
   _usbd_dev.ep_status[epnum][dir].stalled = false;
   _usbd_dev.ep_status[epnum][dir].busy = false;
   _usbd_dev.ep_status[epnum][dir].claimed = false;
+  _usbd_dev.ep_ctx[epnum][dir] = NULL;
 
   return;
 }
@@ -43,12 +43,51 @@ bool tud_init (uint8_t rhport);
 // Check if device stack is already initialized
 bool tud_inited(void);
 
-// Task function should be called in main/rtos loop
-void tud_task (void);
+// Task function should be called in main/rtos loop. With an RTOS it blocks up to timeout_ms
+// (UINT32_MAX for forever) until an event arrives, then processes all queued events and returns.
+// in_isr: only makes the event queue access ISR safe and non-blocking, timeout_ms is ignored.
+// Events are still dispatched to class drivers and application callbacks, which may take OSAL
+// mutexes: with an RTOS this must be called from a task, in_isr is meant for OPT_OS_NONE
+// e.g calling it from a low priority software interrupt.
+void tud_task_ext(uint32_t timeout_ms, bool in_isr);
+
+// Task function should be called in main/rtos loop. With an RTOS it waits forever for the first
+// event, processes all queued events then returns; it no longer loops forever, call it in a loop
+// e.g while(1) tud_task();
+TU_ATTR_ALWAYS_INLINE static inline
+void tud_task (void)
+{
+  tud_task_ext(UINT32_MAX, false);
+}
+
+// Wake up tud_task_ext() blocked waiting for events, it returns once all queued events are processed.
+// Return false if event queue is full.
+bool tud_task_wakeup(bool in_isr);
 
 // Check if there is pending events need proccessing by tud_task()
 bool tud_task_event_ready(void);
 
+// Event queue priorities, tud_task() processes higher priority events first
+enum
+{
+  TUD_EVENT_PRIO_HIGH = 0, // bus events, setup, control endpoint transfers and deferred function calls
+  TUD_EVENT_PRIO_XFER,     // transfer complete on non control endpoints
+  TUD_EVENT_PRIO_LOW,      // SOF
+  TUD_EVENT_PRIO_COUNT
+};
+
+typedef struct
+{
+  uint32_t overflow[TUD_EVENT_PRIO_COUNT]; // events dropped since their queue was full
+  uint32_t sof_coalesced;                  // SOFs merged into an SOF event not processed yet
+}tud_task_stats_t;
+
+// Get event queue statistics
+void tud_task_stats_get(tud_task_stats_t* stats);
+
+// Clear event queue statistics
+void tud_task_stats_reset(void);
+
 // Interrupt handler, name alias to DCD
 extern void dcd_int_handler(uint8_t rhport);
 #define tud_int_handler   dcd_int_handler
@@ -92,6 +131,22 @@ bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, vo
 // Send STATUS (zero length) packet
 bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request);
 
+#if CFG_TUD_EDPT_LATENCY
+// Latency from transfer completion interrupt to its callback, in tud_latency_timestamp_cb() ticks
+typedef struct
+{
+  uint32_t count; // number of completions measured
+  uint32_t total; // sum of latencies, average is total/count
+  uint32_t max;
+}tud_edpt_latency_t;
+
+// Get latency statistics of an endpoint
+void tud_edpt_latency_get(uint8_t ep_addr, tud_edpt_latency_t* latency);
+
+// Clear latency statistics of all endpoints
+void tud_edpt_latency_reset(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -123,6 +178,10 @@ TU_ATTR_WEAK uint8_t const* tud_descriptor_device_qualifier_cb(void);
 // Configuration descriptor in the other speed e.g if high speed then this is for full speed and vice versa
 TU_ATTR_WEAK uint8_t const* tud_descriptor_other_speed_configuration_cb(uint8_t index);
 
+// Invoked with CFG_TUD_EDPT_LATENCY to timestamp transfer completion, from both ISR and task context.
+// Application return a free running counter e.g cycle counter or a microsecond timer
+TU_ATTR_WEAK uint32_t tud_latency_timestamp_cb(void);
+
 // Invoked when device is mounted (configured)
 TU_ATTR_WEAK void tud_mount_cb(void);
 
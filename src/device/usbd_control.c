@@ -49,6 +49,7 @@ typedef struct
   uint8_t* buffer;
   uint16_t data_len;
   uint16_t total_xferred;
+  uint16_t xact_len;      // length of data stage transaction in progress
 
   usbd_control_xfer_cb_t complete_cb;
 } usbd_control_xfer_t;
@@ -81,20 +82,36 @@ bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request)
   return _status_stage_xact(rhport, request);
 }
 
+#if CFG_TUD_CONTROL_ZERO_COPY
+TU_VERIFY_STATIC( (CFG_TUD_CONTROL_ZERO_COPY_ALIGN & (CFG_TUD_CONTROL_ZERO_COPY_ALIGN-1)) == 0, "CFG_TUD_CONTROL_ZERO_COPY_ALIGN must be power of 2");
+
+// Data stage can be transferred directly from/to user buffer
+TU_ATTR_ALWAYS_INLINE static inline bool _data_stage_zero_copy(void)
+{
+  return 0 == (((uintptr_t) _ctrl_xfer.buffer) & (CFG_TUD_CONTROL_ZERO_COPY_ALIGN-1));
+}
+#endif
+
 // Queue a transaction in Data Stage
-// Each transaction has up to Endpoint0's max packet size.
+// Each transaction has up to Endpoint0's max packet size, or the rest of data stage in zero copy mode.
 // This function can also transfer an zero-length packet
 static bool _data_stage_xact(uint8_t rhport)
 {
-  uint16_t const xact_len = tu_min16(_ctrl_xfer.data_len - _ctrl_xfer.total_xferred, CFG_TUD_ENDPOINT0_SIZE);
-
-  uint8_t ep_addr = EDPT_CTRL_OUT;
+  uint16_t const remaining = _ctrl_xfer.data_len - _ctrl_xfer.total_xferred;
+  uint8_t const ep_addr = (_ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN) ? EDPT_CTRL_IN : EDPT_CTRL_OUT;
 
-  if ( _ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN )
+#if CFG_TUD_CONTROL_ZERO_COPY
+  if ( remaining && _data_stage_zero_copy() )
   {
-    ep_addr = EDPT_CTRL_IN;
-    if ( xact_len ) memcpy(_usbd_ctrl_buf, _ctrl_xfer.buffer, xact_len);
+    _ctrl_xfer.xact_len = remaining;
+    return usbd_edpt_xfer(rhport, ep_addr, _ctrl_xfer.buffer, remaining);
   }
+#endif
+
+  uint16_t const xact_len = tu_min16(remaining, CFG_TUD_ENDPOINT0_SIZE);
+  _ctrl_xfer.xact_len = xact_len;
+
+  if ( ep_addr == EDPT_CTRL_IN && xact_len ) memcpy(_usbd_ctrl_buf, _ctrl_xfer.buffer, xact_len);
 
   return usbd_edpt_xfer(rhport, ep_addr, xact_len ? _usbd_ctrl_buf : NULL, xact_len);
 }
@@ -185,8 +202,15 @@ bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t result
   if ( _ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_OUT )
   {
     TU_VERIFY(_ctrl_xfer.buffer);
-    memcpy(_ctrl_xfer.buffer, _usbd_ctrl_buf, xferred_bytes);
-    TU_LOG_MEM(2, _usbd_ctrl_buf, xferred_bytes, 2);
+
+#if CFG_TUD_CONTROL_ZERO_COPY
+    // data is already in user buffer
+    if ( !_data_stage_zero_copy() )
+#endif
+    {
+      memcpy(_ctrl_xfer.buffer, _usbd_ctrl_buf, xferred_bytes);
+    }
+    TU_LOG_MEM(2, _ctrl_xfer.buffer, xferred_bytes, 2);
   }
 
   _ctrl_xfer.total_xferred += xferred_bytes;
@@ -194,7 +218,10 @@ bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t result
 
   // Data Stage is complete when all request's length are transferred or
   // a short packet is sent including zero-length packet.
-  if ( (_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) || (xferred_bytes < CFG_TUD_ENDPOINT0_SIZE) )
+  // A zero copy transaction spans multiple packets: it is short if it ends early or with a partial packet.
+  bool const short_xact = (xferred_bytes < _ctrl_xfer.xact_len) || (xferred_bytes % CFG_TUD_ENDPOINT0_SIZE) || (0 == xferred_bytes);
+
+  if ( (_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) || short_xact )
   {
     // DATA stage is complete
     bool is_ok = true;
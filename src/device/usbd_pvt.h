@@ -48,7 +48,8 @@ typedef struct
   uint16_t (* open             ) (uint8_t rhport, tusb_desc_interface_t const * desc_intf, uint16_t max_len);
   bool     (* control_xfer_cb  ) (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
   bool     (* xfer_cb          ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
-  void     (* sof              ) (uint8_t rhport); /* optional */
+  void     (* sof              ) (uint8_t rhport); /* optional, invoked once per frame */
+  void     (* sof_frames       ) (uint8_t rhport, uint32_t frame_count); /* optional, instead of sof(), frame_count: SOFs since last call */
 } usbd_class_driver_t;
 
 // Invoked when initializing device stack to get additional class drivers.
@@ -65,14 +66,43 @@ typedef bool (*usbd_control_xfer_cb_t)(uint8_t rhport, uint8_t stage, tusb_contr
 // Open an endpoint
 bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 
+// Open an endpoint with an opaque class driver context e.g its interface instance.
+// xfer_cb() can get it back with usbd_edpt_ctx() instead of searching for the endpoint owner.
+bool usbd_edpt_open_ctx(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep, void* ctx);
+
+// Change context of an opened endpoint
+void usbd_edpt_ctx_set(uint8_t rhport, uint8_t ep_addr, void* ctx);
+
+// Get context of an endpoint, NULL if opened without context
+void* usbd_edpt_ctx(uint8_t rhport, uint8_t ep_addr);
+
 // Close an endpoint
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr);
 
-// Submit a usb transfer
-bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
+// Submit a usb transfer. With CFG_TUD_EDPT_XFER_CHUNK transfers larger than dcd_edpt_xfer() can take are split
+// in chunks by the stack, xfer_cb() is invoked once with the total length after the last chunk or a short packet.
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes);
+
+// Submit a usb transfer without waiting for the previous one on the same endpoint to complete.
+// Up to CFG_TUD_EDPT_QUEUE_SZ transfers are queued behind the one in flight, each is armed as soon
+// as the previous one completes and xfer_cb() is invoked once per transfer in submission order.
+// Return false if the queue is full, the endpoint is stalled or busy with a non queued transfer.
+bool usbd_edpt_xfer_queue(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes);
+
+// Number of transfers submitted with usbd_edpt_xfer_queue() whose xfer_cb() is not invoked yet
+uint8_t usbd_edpt_queue_count(uint8_t rhport, uint8_t ep_addr);
+
+// Completion hook invoked from the DCD interrupt, see usbd_edpt_isr_cb_set()
+typedef void (*usbd_edpt_isr_cb_t)(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+// Register (or remove with NULL) a completion hook for an opened endpoint, requires CFG_TUD_EDPT_ISR_CB.
+// When the DCD reports completion from its ISR, the hook is invoked there instead of driver's xfer_cb().
+// It must not block nor call any API that locks a mutex: re-arming with usbd_edpt_xfer() is allowed.
+// Completions reported outside of ISR still go to xfer_cb() through tud_task().
+bool usbd_edpt_isr_cb_set(uint8_t rhport, uint8_t ep_addr, usbd_edpt_isr_cb_t cb);
 
 // Submit a usb ISO transfer by use of a FIFO (ring buffer) - all bytes in FIFO get transmitted
-bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint32_t total_bytes);
 
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
@@ -100,11 +130,46 @@ bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr)
   return !usbd_edpt_busy(rhport, ep_addr) && !usbd_edpt_stalled(rhport, ep_addr);
 }
 
+//--------------------------------------------------------------------+
+// SOF Timer
+//--------------------------------------------------------------------+
+
+typedef struct usbd_timer usbd_timer_t;
+typedef void (*usbd_timer_cb_t)(uint8_t rhport, void* ctx);
+
+// Timer counting SOFs processed by tud_task(), storage is provided by the class driver.
+// Fields are private to usbd, zero-initialized timer is not armed.
+struct usbd_timer
+{
+  usbd_timer_t*   next;
+  usbd_timer_t**  pprev;  // link pointing to this timer, NULL if not armed
+  usbd_timer_cb_t cb;
+  void*           ctx;
+  uint32_t        expire; // frame number it expires at
+  uint16_t        period; // re-armed with this interval if not zero
+};
+
+// Arm (or re-arm) a timer to invoke cb(rhport, ctx) after 'frames' SOFs, then every 'period' SOFs if
+// period is not zero. SOF is enabled while any timer is armed, timers do not advance while bus is suspended.
+// Timer API must be called in task context e.g from class driver callbacks, including timer callbacks.
+bool usbd_timer_start(uint8_t rhport, usbd_timer_t* timer, usbd_timer_cb_t cb, void* ctx, uint16_t frames, uint16_t period);
+
+// Disarm a timer, all timers are also disarmed by bus reset and configuration change
+void usbd_timer_stop(uint8_t rhport, usbd_timer_t* timer);
+
+// Check if timer is armed
+TU_ATTR_ALWAYS_INLINE static inline
+bool usbd_timer_armed(usbd_timer_t const* timer)
+{
+  return timer->pprev != NULL;
+}
+
 /*------------------------------------------------------------------*/
 /* Helper
  *------------------------------------------------------------------*/
 
 bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in);
+bool usbd_open_edpt_pair_ctx(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in, void* ctx);
 void usbd_defer_func( osal_task_func_t func, void* param, bool in_isr );
 
 
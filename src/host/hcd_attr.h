@@ -93,6 +93,9 @@
 //------------- GigaDevice -------------//
 #elif TU_CHECK_MCU(OPT_MCU_GD32VF103)
 
+//------------- Simulation -------------//
+#elif TU_CHECK_MCU(OPT_MCU_SIM)
+
 #else
 //  #warning "DCD_ATTR_ENDPOINT_MAX is not defined for this MCU, default to 8"
 #endif
@@ -236,6 +236,19 @@ static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 // from usbh_control.c
 extern bool usbh_control_xfer_cb (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 
+// Trace a HCD event with its payload packed as documented in tusb_trace.h
+TU_ATTR_ALWAYS_INLINE static inline void trace_hcd_event(uint8_t trace_event, hcd_event_t const* event)
+{
+#if CFG_TUSB_TRACE
+  bool const xfer = (event->event_id == HCD_EVENT_XFER_COMPLETE);
+
+  tusb_trace_record((uint8_t) (trace_event + event->event_id), xfer ? event->xfer_complete.ep_addr : 0, event->dev_addr,
+                    xfer ? event->xfer_complete.result : 0, xfer ? event->xfer_complete.len : 0);
+#else
+  (void) trace_event; (void) event;
+#endif
+}
+
 //--------------------------------------------------------------------+
 // PUBLIC API (Parameter Verification is required)
 //--------------------------------------------------------------------+
@@ -351,7 +364,9 @@ void tuh_task(void)
   while (1)
   {
     hcd_event_t event;
-    if ( !osal_queue_receive(_usbh_q, &event) ) return;
+    if ( !osal_queue_receive(_usbh_q, &event, OSAL_TIMEOUT_WAIT_FOREVER, false) ) return;
+
+    trace_hcd_event(TUSB_TRACE_USBH_QUEUE_GET, &event);
 
     switch (event.event_id)
     {
@@ -405,6 +420,7 @@ void tuh_task(void)
             TU_ASSERT(drv_id < USBH_CLASS_DRIVER_COUNT, );
 
             TU_LOG2("%s xfer callback\r\n", usbh_class_drivers[drv_id].name);
+            TU_TRACE(TUSB_TRACE_USBH_CLASS_XFER_CB, ep_addr, drv_id, event.xfer_complete.result, event.xfer_complete.len);
             usbh_class_drivers[drv_id].xfer_cb(event.dev_addr, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
           }
         }
@@ -459,6 +475,8 @@ void hcd_devtree_get_info(uint8_t dev_addr, hcd_devtree_info_t* devtree_info)
 
 void hcd_event_handler(hcd_event_t const* event, bool in_isr)
 {
+  trace_hcd_event(TUSB_TRACE_HCD_EVENT, event);
+
   switch (event->event_id)
   {
     default:
@@ -1149,12 +1167,16 @@ bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_
   // could return and USBH task can preempt and clear the busy
   dev->ep_status[epnum][dir].busy = true;
 
+  // traced before submitting since transfer can complete before hcd_edpt_xfer() returns
+  TU_TRACE(TUSB_TRACE_USBH_XFER, ep_addr, dev_addr, 1, total_bytes);
+
   if ( hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes) )
   {
     TU_LOG2("OK\r\n");
     return true;
   }else
   {
+    TU_TRACE(TUSB_TRACE_USBH_XFER, ep_addr, dev_addr, 0, total_bytes);
     // HCD error, mark endpoint as ready to allow next transfer
     dev->ep_status[epnum][dir].busy = false;
     dev->ep_status[epnum][dir].claimed = 0;
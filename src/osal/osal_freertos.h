@@ -134,9 +134,35 @@ static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
   return xQueueCreateStatic(qdef->depth, qdef->item_sz, (uint8_t*) qdef->buf, &qdef->sq);
 }
 
-static inline bool osal_queue_receive(osal_queue_t qhdl, void* data)
+// in_isr never waits, msec is ignored
+static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec, bool in_isr)
 {
-  return xQueueReceive(qhdl, data, portMAX_DELAY);
+  if ( !in_isr )
+  {
+    TickType_t ticks = portMAX_DELAY;
+    if ( msec != OSAL_TIMEOUT_WAIT_FOREVER )
+    {
+      // pdMS_TO_TICKS() overflows for large msec, finite timeout must not become portMAX_DELAY (forever)
+      uint64_t const ticks64 = ((uint64_t) msec * configTICK_RATE_HZ) / 1000;
+      ticks = (ticks64 < portMAX_DELAY) ? (TickType_t) ticks64 : (portMAX_DELAY - 1);
+    }
+    return xQueueReceive(qhdl, data, ticks) != 0;
+  }
+  else
+  {
+    (void) msec;
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    BaseType_t res = xQueueReceiveFromISR(qhdl, data, &xHigherPriorityTaskWoken);
+
+#if CFG_TUSB_MCU == OPT_MCU_ESP32S2 || CFG_TUSB_MCU == OPT_MCU_ESP32S3
+    if ( xHigherPriorityTaskWoken ) portYIELD_FROM_ISR();
+#else
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#endif
+
+    return res != 0;
+  }
 }
 
 static inline bool osal_queue_send(osal_queue_t qhdl, void const * data, bool in_isr)
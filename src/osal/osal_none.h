@@ -164,11 +164,20 @@ static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
   return (osal_queue_t) qdef;
 }
 
-static inline bool osal_queue_receive(osal_queue_t qhdl, void* data)
+// msec is ignored, there is nothing to wait for without an RTOS
+static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec, bool in_isr)
 {
-  _osal_q_lock(qhdl);
+  (void) msec;
+
+  if (!in_isr) {
+    _osal_q_lock(qhdl);
+  }
+
   bool success = tu_fifo_read(&qhdl->ff, data);
-  _osal_q_unlock(qhdl);
+
+  if (!in_isr) {
+    _osal_q_unlock(qhdl);
+  }
 
   return success;
 }
@@ -110,8 +110,10 @@ static inline osal_queue_t osal_queue_create(osal_queue_def_t *qdef) {
     return &(qdef->sq);
 }
 
-static inline bool osal_queue_receive(osal_queue_t qhdl, void *data) {
-    return rt_mq_recv(qhdl, data, qhdl->msg_size, RT_WAITING_FOREVER) == RT_EOK;
+static inline bool osal_queue_receive(osal_queue_t qhdl, void *data, uint32_t msec, bool in_isr) {
+    // only a zero timeout is allowed in isr
+    rt_int32_t const timeout = in_isr ? 0 : rt_tick_from_millisecond(msec);
+    return rt_mq_recv(qhdl, data, qhdl->msg_size, timeout) == RT_EOK;
 }
 
 static inline bool osal_queue_send(osal_queue_t qhdl, void const *data, bool in_isr) {
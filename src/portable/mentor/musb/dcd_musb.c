@@ -225,38 +225,33 @@ static inline volatile hw_endpoint_t* edpt_regs(unsigned epnum_minus1)
 static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
 {
   volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    reg->u32 = *(uint32_t const *)addr;
-    addr += 4;
-    len  -= 4;
-  }
-  if (len >= 2) {
-    reg->u16 = *(uint16_t const *)addr;
+  uint8_t const *addr = (uint8_t const*)buf;
+
+  // FIFO supports byte lane access: full words first, then a half word and a byte for the tail
+  tu_hwfifo_write32(&reg->u32, addr, len & ~3u);
+  addr += len & ~3u;
+  if (len & 2) {
+    tu_hwfifo_write16(&reg->u16, addr, 2);
     addr += 2;
-    len  -= 2;
   }
-  if (len) {
-    reg->u8 = *(uint8_t const *)addr;
+  if (len & 1) {
+    tu_hwfifo_write8(&reg->u8, addr, 1);
   }
 }
 
 static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
 {
   volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
-  uintptr_t addr = (uintptr_t)buf;
-  while (len >= 4) {
-    *(uint32_t *)addr = reg->u32;
-    addr += 4;
-    len  -= 4;
-  }
-  if (len >= 2) {
-    *(uint16_t *)addr = reg->u16;
+  uint8_t *addr = (uint8_t*)buf;
+
+  tu_hwfifo_read32(&reg->u32, addr, len & ~3u);
+  addr += len & ~3u;
+  if (len & 2) {
+    tu_hwfifo_read16(&reg->u16, addr, 2);
     addr += 2;
-    len  -= 2;
   }
-  if (len) {
-    *(uint8_t *)addr = reg->u8;
+  if (len & 1) {
+    tu_hwfifo_read8(&reg->u8, addr, 1);
   }
 }
 
@@ -264,7 +259,7 @@ static void pipe_read_write_packet_ff(tu_fifo_t *f, volatile void *fifo, unsigne
 {
   static const struct {
     void (*tu_fifo_get_info)(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
-    void (*tu_fifo_advance)(tu_fifo_t *f, uint16_t n);
+    void (*tu_fifo_advance)(tu_fifo_t *f, tu_fifo_idx_t n);
     void (*pipe_read_write)(void *buf, volatile void *fifo, unsigned len);
   } ops[] = {
     /* OUT */ {tu_fifo_get_write_info,tu_fifo_advance_write_pointer,pipe_read_packet},
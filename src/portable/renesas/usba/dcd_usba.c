@@ -283,7 +283,7 @@ static void pipe_read_write_packet_ff(tu_fifo_t *f, volatile void *fifo, unsigne
 {
   static const struct {
     void (*tu_fifo_get_info)(tu_fifo_t *f, tu_fifo_buffer_info_t *info);
-    void (*tu_fifo_advance)(tu_fifo_t *f, uint16_t n);
+    void (*tu_fifo_advance)(tu_fifo_t *f, tu_fifo_idx_t n);
     void (*pipe_read_write)(void *buf, volatile void *fifo, unsigned len);
   } ops[] = {
     /* OUT */ {tu_fifo_get_write_info,tu_fifo_advance_write_pointer,pipe_read_packet},
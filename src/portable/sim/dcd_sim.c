@@ -0,0 +1,575 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if TUSB_OPT_DEVICE_ENABLED && CFG_TUSB_MCU == OPT_MCU_SIM
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "device/dcd.h"
+#include "dcd_sim.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+typedef struct
+{
+  uint8_t* buffer;
+  tu_fifo_t* ff;
+  uint16_t total_len;
+  uint16_t actual_len;
+  bool busy;
+} xfer_ctl_t;
+
+typedef struct
+{
+  xfer_ctl_t xfer;
+  uint16_t mps;
+  bool opened;
+  bool stalled;
+} edpt_t;
+
+typedef struct
+{
+  edpt_t edpt[DCD_ATTR_ENDPOINT_MAX][2];
+
+  bool connected;
+  bool sof_en;
+  bool remote_wakeup;
+
+  uint8_t addr;
+  uint8_t addr_new;
+  bool addr_pending; // new address is applied after status stage of SET_ADDRESS
+} dcd_sim_t;
+
+static dcd_sim_t _sim;
+
+// Interrupts are modelled by a recursive mutex: the host role (dcd_sim_* API) runs with it held
+// like an ISR, dcd_int_disable()/dcd_int_enable() from the stack take and release it.
+static pthread_mutex_t _sim_mutex;
+static pthread_once_t _sim_once = PTHREAD_ONCE_INIT;
+
+// per thread nesting, tud_init() enables interrupt without disabling it first
+static __thread uint32_t _sim_lock_depth;
+
+static void sim_mutex_init(void)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&_sim_mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+static void sim_lock(void)
+{
+  pthread_once(&_sim_once, sim_mutex_init);
+  pthread_mutex_lock(&_sim_mutex);
+  _sim_lock_depth++;
+}
+
+static void sim_unlock(void)
+{
+  if ( _sim_lock_depth == 0 ) return;
+
+  _sim_lock_depth--;
+  pthread_mutex_unlock(&_sim_mutex);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline edpt_t* get_edpt(uint8_t ep_addr)
+{
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  return (epnum < DCD_ATTR_ENDPOINT_MAX) ? &_sim.edpt[epnum][tu_edpt_dir(ep_addr)] : NULL;
+}
+
+static void edpt_reset(edpt_t* ep)
+{
+  tu_memclr(ep, sizeof(edpt_t));
+}
+
+// close all non-control endpoints, cancel control transfers
+static void edpt_reset_all(void)
+{
+  for(uint8_t n = 0; n < DCD_ATTR_ENDPOINT_MAX; n++)
+  {
+    edpt_reset(&_sim.edpt[n][TUSB_DIR_OUT]);
+    edpt_reset(&_sim.edpt[n][TUSB_DIR_IN]);
+  }
+
+  for(uint8_t dir = 0; dir < 2; dir++)
+  {
+    _sim.edpt[0][dir].opened = true;
+    _sim.edpt[0][dir].mps    = CFG_TUD_ENDPOINT0_SIZE;
+  }
+}
+
+static void edpt_xfer_complete(uint8_t rhport, uint8_t ep_addr, edpt_t* ep)
+{
+  // clear busy first, stack may queue the next transfer from the event handler
+  ep->xfer.busy = false;
+  dcd_event_xfer_complete(rhport, ep_addr, ep->xfer.actual_len, XFER_RESULT_SUCCESS, true);
+
+  // status stage of SET_ADDRESS is done
+  if ( ep_addr == 0x80 && _sim.addr_pending )
+  {
+    _sim.addr         = _sim.addr_new;
+    _sim.addr_pending = false;
+  }
+}
+
+// host side endpoint lookup, return negative code if it can not transfer
+static int32_t edpt_check(uint8_t ep_addr, edpt_t** pep)
+{
+  edpt_t* ep = get_edpt(ep_addr);
+
+  if ( !_sim.connected || !ep || !ep->opened ) return DCD_SIM_ERROR;
+  if ( ep->stalled    ) return DCD_SIM_STALL;
+  if ( !ep->xfer.busy ) return DCD_SIM_NAK;
+
+  *pep = ep;
+  return 0;
+}
+
+/*------------------------------------------------------------------*/
+/* Controller API
+ *------------------------------------------------------------------*/
+
+void dcd_init (uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  tu_memclr(&_sim, sizeof(_sim));
+  edpt_reset_all();
+  _sim.connected = true;
+  sim_unlock();
+}
+
+void dcd_int_enable (uint8_t rhport)
+{
+  (void) rhport;
+  sim_unlock();
+}
+
+void dcd_int_disable (uint8_t rhport)
+{
+  (void) rhport;
+  sim_lock();
+}
+
+void dcd_set_address (uint8_t rhport, uint8_t dev_addr)
+{
+  sim_lock();
+  _sim.addr_new     = dev_addr;
+  _sim.addr_pending = true;
+  sim_unlock();
+
+  // status stage, address is changed once host reads it
+  dcd_edpt_xfer(rhport, 0x80, NULL, 0);
+}
+
+void dcd_remote_wakeup (uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  _sim.remote_wakeup = true;
+  sim_unlock();
+}
+
+void dcd_connect (uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  _sim.connected = true;
+  sim_unlock();
+}
+
+void dcd_disconnect (uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  _sim.connected = false;
+  sim_unlock();
+}
+
+void dcd_sof_enable (uint8_t rhport, bool en)
+{
+  (void) rhport;
+
+  sim_lock();
+  _sim.sof_en = en;
+  sim_unlock();
+}
+
+/*------------------------------------------------------------------*/
+/* Endpoint API
+ *------------------------------------------------------------------*/
+
+bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(desc_ep->bEndpointAddress);
+  TU_ASSERT(ep);
+
+  sim_lock();
+  edpt_reset(ep);
+  ep->mps    = tu_edpt_packet_size(desc_ep);
+  ep->opened = true;
+  sim_unlock();
+
+  return true;
+}
+
+void dcd_edpt_close_all (uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  for(uint8_t n = 1; n < DCD_ATTR_ENDPOINT_MAX; n++)
+  {
+    edpt_reset(&_sim.edpt[n][TUSB_DIR_OUT]);
+    edpt_reset(&_sim.edpt[n][TUSB_DIR_IN]);
+  }
+  sim_unlock();
+}
+
+void dcd_edpt_close (uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  if ( !ep || tu_edpt_number(ep_addr) == 0 ) return;
+
+  sim_lock();
+  edpt_reset(ep);
+  sim_unlock();
+}
+
+bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  TU_ASSERT(ep && ep->opened);
+
+  sim_lock();
+  ep->xfer.buffer     = buffer;
+  ep->xfer.ff         = NULL;
+  ep->xfer.total_len  = total_bytes;
+  ep->xfer.actual_len = 0;
+  ep->xfer.busy       = true;
+  sim_unlock();
+
+  return true;
+}
+
+bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  TU_ASSERT(ep && ep->opened);
+
+  sim_lock();
+  ep->xfer.buffer     = NULL;
+  ep->xfer.ff         = ff;
+  ep->xfer.total_len  = total_bytes;
+  ep->xfer.actual_len = 0;
+  ep->xfer.busy       = true;
+  sim_unlock();
+
+  return true;
+}
+
+void dcd_edpt_stall (uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  if ( !ep ) return;
+
+  sim_lock();
+  ep->stalled   = true;
+  ep->xfer.busy = false;
+  sim_unlock();
+}
+
+void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  if ( !ep ) return;
+
+  sim_lock();
+  ep->stalled = false;
+  sim_unlock();
+}
+
+/*------------------------------------------------------------------*/
+/* Host role: bus
+ *------------------------------------------------------------------*/
+
+bool dcd_sim_connected(uint8_t rhport)
+{
+  (void) rhport;
+  return _sim.connected;
+}
+
+uint8_t dcd_sim_address(uint8_t rhport)
+{
+  (void) rhport;
+  return _sim.addr;
+}
+
+bool dcd_sim_remote_wakeup(uint8_t rhport)
+{
+  (void) rhport;
+
+  sim_lock();
+  bool const signalled = _sim.remote_wakeup;
+  _sim.remote_wakeup = false;
+  sim_unlock();
+
+  return signalled;
+}
+
+uint16_t dcd_sim_edpt_size(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+
+  edpt_t* ep = get_edpt(ep_addr);
+  return (ep && ep->opened) ? ep->mps : 0;
+}
+
+void dcd_sim_bus_reset(uint8_t rhport, tusb_speed_t speed)
+{
+  sim_lock();
+  edpt_reset_all();
+  _sim.addr          = 0;
+  _sim.addr_pending  = false;
+  _sim.remote_wakeup = false;
+  dcd_event_bus_reset(rhport, speed, true);
+  sim_unlock();
+}
+
+void dcd_sim_suspend(uint8_t rhport)
+{
+  sim_lock();
+  dcd_event_bus_signal(rhport, DCD_EVENT_SUSPEND, true);
+  sim_unlock();
+}
+
+void dcd_sim_resume(uint8_t rhport)
+{
+  sim_lock();
+  dcd_event_bus_signal(rhport, DCD_EVENT_RESUME, true);
+  sim_unlock();
+}
+
+void dcd_sim_unplug(uint8_t rhport)
+{
+  sim_lock();
+  edpt_reset_all();
+  _sim.addr         = 0;
+  _sim.addr_pending = false;
+  dcd_event_bus_signal(rhport, DCD_EVENT_UNPLUGGED, true);
+  sim_unlock();
+}
+
+void dcd_sim_sof(uint8_t rhport)
+{
+  sim_lock();
+  if ( _sim.sof_en ) dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+  sim_unlock();
+}
+
+/*------------------------------------------------------------------*/
+/* Host role: transfer
+ *------------------------------------------------------------------*/
+
+void dcd_sim_setup(uint8_t rhport, tusb_control_request_t const * request)
+{
+  sim_lock();
+
+  // SETUP always gets through: cancel previous control transfer and its stall
+  for(uint8_t dir = 0; dir < 2; dir++)
+  {
+    _sim.edpt[0][dir].stalled   = false;
+    _sim.edpt[0][dir].xfer.busy = false;
+  }
+
+  dcd_event_setup_received(rhport, (uint8_t const*) request, true);
+
+  sim_unlock();
+}
+
+int32_t dcd_sim_in(uint8_t rhport, uint8_t ep_addr, void* buffer, uint16_t len)
+{
+  edpt_t* ep = NULL;
+
+  sim_lock();
+
+  int32_t rc = edpt_check(ep_addr | TUSB_DIR_IN_MASK, &ep);
+  if ( rc < 0 )
+  {
+    sim_unlock();
+    return rc;
+  }
+
+  xfer_ctl_t* xfer = &ep->xfer;
+  uint16_t const count = tu_min16(len, xfer->total_len - xfer->actual_len);
+
+  if ( count )
+  {
+    if ( xfer->ff )
+    {
+      tu_fifo_read_n(xfer->ff, buffer, count);
+    }
+    else
+    {
+      memcpy(buffer, xfer->buffer + xfer->actual_len, count);
+    }
+  }
+  xfer->actual_len += count;
+
+  if ( xfer->actual_len == xfer->total_len ) edpt_xfer_complete(rhport, ep_addr | TUSB_DIR_IN_MASK, ep);
+
+  sim_unlock();
+
+  return count;
+}
+
+int32_t dcd_sim_out(uint8_t rhport, uint8_t ep_addr, void const* data, uint16_t len)
+{
+  edpt_t* ep = NULL;
+
+  sim_lock();
+
+  int32_t rc = edpt_check(tu_edpt_number(ep_addr), &ep);
+  if ( rc < 0 )
+  {
+    sim_unlock();
+    return rc;
+  }
+
+  xfer_ctl_t* xfer = &ep->xfer;
+  uint16_t const count = tu_min16(len, xfer->total_len - xfer->actual_len);
+
+  if ( count )
+  {
+    if ( xfer->ff )
+    {
+      tu_fifo_write_n(xfer->ff, data, count);
+    }
+    else
+    {
+      memcpy(xfer->buffer + xfer->actual_len, data, count);
+    }
+  }
+  xfer->actual_len += count;
+
+  // full or short packet (including ZLP)
+  if ( (xfer->actual_len == xfer->total_len) || (len % ep->mps) || (len == 0) )
+  {
+    edpt_xfer_complete(rhport, tu_edpt_number(ep_addr), ep);
+  }
+
+  sim_unlock();
+
+  return count;
+}
+
+// let device side run, false if retry limit is reached
+static bool control_wait(uint32_t* retry, void (*pump)(void))
+{
+  if ( ++(*retry) > DCD_SIM_RETRY_MAX ) return false;
+
+  if ( pump ) pump();
+  else        sched_yield();
+
+  return true;
+}
+
+int32_t dcd_sim_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, void (*pump)(void))
+{
+  uint8_t* buf = (uint8_t*) buffer;
+  bool const dir_in = (request->bmRequestType_bit.direction == TUSB_DIR_IN);
+  uint16_t const len = request->wLength;
+
+  uint16_t count = 0;
+  uint32_t retry = 0;
+  int32_t rc;
+
+  dcd_sim_setup(rhport, request);
+  if ( pump ) pump();
+
+  // data stage, one packet at a time
+  while ( count < len )
+  {
+    uint16_t const pkt_len = tu_min16(len - count, CFG_TUD_ENDPOINT0_SIZE);
+
+    rc = dir_in ? dcd_sim_in (rhport, 0x80, buf + count, pkt_len) :
+                  dcd_sim_out(rhport, 0x00, buf + count, pkt_len);
+
+    if ( rc == DCD_SIM_NAK )
+    {
+      if ( !control_wait(&retry, pump) ) return DCD_SIM_NAK;
+      continue;
+    }
+    if ( rc < 0 ) return rc;
+
+    retry  = 0;
+    count += (uint16_t) rc;
+    if ( pump ) pump();
+
+    // short packet ends IN data stage
+    if ( dir_in && rc < pkt_len ) break;
+  }
+
+  // status stage in opposite direction of data stage
+  while ( 1 )
+  {
+    rc = (dir_in && len) ? dcd_sim_out(rhport, 0x00, NULL, 0) : dcd_sim_in(rhport, 0x80, NULL, 0);
+
+    if ( rc != DCD_SIM_NAK ) break;
+    if ( !control_wait(&retry, pump) ) return DCD_SIM_NAK;
+  }
+  if ( rc < 0 ) return rc;
+
+  if ( pump ) pump();
+
+  return count;
+}
+
+#endif
@@ -0,0 +1,108 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/** \ingroup group_dcd
+ *  \defgroup group_dcd_sim Simulated Controller
+ *  In-process device controller for running the device stack on a PC (OPT_MCU_SIM).
+ *  Endpoints are plain memory, the host role is played by the dcd_sim_*() API below
+ *  from the same thread as tud_task() or from another one.
+ *  @{ */
+
+#ifndef _TUSB_DCD_SIM_H_
+#define _TUSB_DCD_SIM_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Number of NAKs dcd_sim_control_xfer() tolerates per stage before giving up
+#ifndef DCD_SIM_RETRY_MAX
+  #define DCD_SIM_RETRY_MAX   100000
+#endif
+
+// Negative return of the transfer API, a non-negative value is the number of bytes transferred
+enum
+{
+  DCD_SIM_NAK   = -1, ///< endpoint has no transfer queued, try again later
+  DCD_SIM_STALL = -2, ///< endpoint is stalled
+  DCD_SIM_ERROR = -3, ///< endpoint is not opened or device is not connected
+};
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+// Device pull-up state, set by dcd_init()/dcd_connect() and cleared by dcd_disconnect()
+bool dcd_sim_connected(uint8_t rhport);
+
+// Address assigned by SET_ADDRESS, applied once its status stage is read
+uint8_t dcd_sim_address(uint8_t rhport);
+
+// Return and clear remote wakeup signalled by the device
+bool dcd_sim_remote_wakeup(uint8_t rhport);
+
+// Max packet size of an opened endpoint, 0 if it is not opened
+uint16_t dcd_sim_edpt_size(uint8_t rhport, uint8_t ep_addr);
+
+// Reset the bus: address 0, all non-control endpoints closed
+void dcd_sim_bus_reset(uint8_t rhport, tusb_speed_t speed);
+
+void dcd_sim_suspend(uint8_t rhport);
+void dcd_sim_resume(uint8_t rhport);
+void dcd_sim_unplug(uint8_t rhport);
+
+// Start of frame, only reported to the stack when enabled by dcd_sof_enable()
+void dcd_sim_sof(uint8_t rhport);
+
+//--------------------------------------------------------------------+
+// Transfer
+//--------------------------------------------------------------------+
+
+// Send a SETUP packet, cancels any transfer pending on control endpoint and clears its stall
+void dcd_sim_setup(uint8_t rhport, tusb_control_request_t const * request);
+
+// IN token(s): read up to len bytes from the transfer queued on ep_addr, the device transfer
+// completes once all its bytes are read. Reading less than len means a short packet.
+int32_t dcd_sim_in(uint8_t rhport, uint8_t ep_addr, void* buffer, uint16_t len);
+
+// OUT token(s): write len bytes to the transfer queued on ep_addr, len = 0 sends a ZLP.
+// The device transfer completes when full or when len is not a multiple of max packet size.
+int32_t dcd_sim_out(uint8_t rhport, uint8_t ep_addr, void const* data, uint16_t len);
+
+// Run a whole control transfer: setup, data and status stage. pump() is invoked after
+// each packet to let the device side run, e.g tud_task() when both run on the same thread;
+// NULL when tud_task() runs on its own thread. Return data stage length or a negative code.
+int32_t dcd_sim_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, void (*pump)(void));
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_DCD_SIM_H_ */
+
+/// @}
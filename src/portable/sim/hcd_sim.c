@@ -0,0 +1,806 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if TUSB_OPT_HOST_ENABLED && CFG_TUSB_MCU == OPT_MCU_SIM
+
+#include "host/hcd.h"
+#include "device/usbd.h" // descriptor templates
+#include "hcd_sim.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+enum
+{
+  CTRL_STAGE_IDLE,
+  CTRL_STAGE_DATA,
+  CTRL_STAGE_STATUS
+};
+
+typedef struct
+{
+  hcd_sim_model_t* root[2];
+  hcd_sim_model_t* models[HCD_SIM_MODEL_MAX]; // attached models, hubs and their children included
+
+  uint32_t frame;
+  uint32_t nak_count;
+} hcd_sim_t;
+
+static hcd_sim_t _sim;
+
+//--------------------------------------------------------------------+
+// Model helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t halt_bit(uint8_t ep_addr)
+{
+  return TU_BIT(tu_edpt_number(ep_addr) + (tu_edpt_dir(ep_addr) ? 16 : 0));
+}
+
+static void model_cancel_all(hcd_sim_model_t* model)
+{
+  for(uint8_t epnum = 0; epnum < 16; epnum++)
+  {
+    model->xfer[epnum][0].busy = model->xfer[epnum][1].busy = false;
+  }
+}
+
+// Bus reset: back to default state, address 0 and not configured
+static void model_reset(hcd_sim_model_t* model)
+{
+  model_cancel_all(model);
+
+  model->addr        = 0;
+  model->cfg_num     = 0;
+  model->ctrl_stage  = CTRL_STAGE_IDLE;
+  model->halted      = 0;
+  model->reset_frame = _sim.frame;
+
+  if (model->driver->reset) model->driver->reset(model);
+}
+
+static bool model_register(hcd_sim_model_t* model)
+{
+  for(uint8_t i = 0; i < HCD_SIM_MODEL_MAX; i++)
+  {
+    if ( _sim.models[i] == NULL )
+    {
+      _sim.models[i]  = model;
+      model->attached = true;
+      model->enabled  = false;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void model_unregister(hcd_sim_model_t* model);
+
+// Device answering to dev_addr, several devices can be at address 0:
+// only the one reset last is being enumerated
+static hcd_sim_model_t* model_find(uint8_t rhport, uint8_t dev_addr)
+{
+  hcd_sim_model_t* found = NULL;
+
+  for(uint8_t i = 0; i < HCD_SIM_MODEL_MAX; i++)
+  {
+    hcd_sim_model_t* model = _sim.models[i];
+
+    if ( model && model->enabled && model->rhport == rhport && model->addr == dev_addr )
+    {
+      if ( !found || (int32_t) (model->reset_frame - found->reset_frame) >= 0 ) found = model;
+    }
+  }
+
+  return found;
+}
+
+//--------------------------------------------------------------------+
+// Hub model
+//--------------------------------------------------------------------+
+
+enum { HUB_EP_STATUS = 0x81 };
+
+static tusb_desc_device_t const _hub_desc_device =
+{
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = TUSB_CLASS_HUB,
+  .bDeviceSubClass    = 0,
+  .bDeviceProtocol    = 0,
+  .bMaxPacketSize0    = 64,
+
+  .idVendor           = 0xCafe,
+  .idProduct          = 0x4100,
+  .bcdDevice          = 0x0100,
+
+  .iManufacturer      = 0x00,
+  .iProduct           = 0x00,
+  .iSerialNumber      = 0x00,
+
+  .bNumConfigurations = 0x01
+};
+
+static uint8_t const _hub_desc_config[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + 9 + 7, TUSB_DESC_CONFIG_ATT_SELF_POWERED, 100),
+
+  // Interface with a single status change endpoint
+  9, TUSB_DESC_INTERFACE, 0, 0, 1, TUSB_CLASS_HUB, 0, 0, 0,
+  7, TUSB_DESC_ENDPOINT, HUB_EP_STATUS, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(1), 12
+};
+
+static void hub_port_connect(hcd_sim_hub_t* hub, uint8_t hub_port)
+{
+  hcd_sim_model_t* child = hub->child[hub_port-1];
+  hub_port_status_response_t* port_status = &hub->port_status[hub_port-1];
+
+  port_status->status.connection = 1;
+  port_status->status.low_speed  = (child->speed == TUSB_SPEED_LOW ) ? 1 : 0;
+  port_status->status.high_speed = (child->speed == TUSB_SPEED_HIGH) ? 1 : 0;
+  port_status->change.connection = 1;
+}
+
+// Bus reset or SET_CONFIGURATION: ports are powered off until the host powers them
+static void hub_reset(hcd_sim_model_t* model)
+{
+  hcd_sim_hub_t* hub = (hcd_sim_hub_t*) model;
+
+  for(uint8_t i = 0; i < hub->port_count; i++)
+  {
+    hub->port_status[i].status.value = 0;
+    hub->port_status[i].change.value = 0;
+
+    if ( hub->child[i] )
+    {
+      model_cancel_all(hub->child[i]);
+      hub->child[i]->enabled = false;
+    }
+  }
+}
+
+static int32_t hub_control(hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer)
+{
+  hcd_sim_hub_t* hub = (hcd_sim_hub_t*) model;
+
+  TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS, HCD_SIM_STALL);
+
+  //------------- Hub -------------//
+  if ( request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE )
+  {
+    switch ( request->bRequest )
+    {
+      case HUB_REQUEST_GET_DESCRIPTOR:
+      {
+        descriptor_hub_desc_t const desc_hub =
+        {
+          .bLength             = sizeof(descriptor_hub_desc_t),
+          .bDescriptorType     = 0x29,
+          .bNbrPorts           = hub->port_count,
+          .wHubCharacteristics = 0x0009, // individual power switching and over-current protection
+          .bPwrOn2PwrGood      = 50,
+          .bHubContrCurrent    = 100,
+          .DeviceRemovable     = 0,
+          .PortPwrCtrlMask     = 0xff
+        };
+
+        memcpy(buffer, &desc_hub, sizeof(desc_hub));
+        return sizeof(desc_hub);
+      }
+
+      case HUB_REQUEST_GET_STATUS:
+        tu_memclr(buffer, sizeof(hub_status_response_t));
+      return sizeof(hub_status_response_t);
+
+      case HUB_REQUEST_SET_FEATURE:
+      case HUB_REQUEST_CLEAR_FEATURE:
+      return 0;
+
+      default: return HCD_SIM_STALL;
+    }
+  }
+
+  //------------- Port -------------//
+  uint8_t const hub_port = (uint8_t) request->wIndex;
+
+  TU_VERIFY(request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_OTHER &&
+            1 <= hub_port && hub_port <= hub->port_count, HCD_SIM_STALL);
+
+  hcd_sim_model_t* child = hub->child[hub_port-1];
+  hub_port_status_response_t* port_status = &hub->port_status[hub_port-1];
+
+  switch ( request->bRequest )
+  {
+    case HUB_REQUEST_GET_STATUS:
+      memcpy(buffer, port_status, sizeof(hub_port_status_response_t));
+    return sizeof(hub_port_status_response_t);
+
+    case HUB_REQUEST_SET_FEATURE:
+      switch ( request->wValue )
+      {
+        case HUB_FEATURE_PORT_POWER:
+          port_status->status.port_power = 1;
+          if ( child && !port_status->status.connection ) hub_port_connect(hub, hub_port);
+        break;
+
+        case HUB_FEATURE_PORT_RESET:
+          // reset completes at once, the host sees it on the next GET_STATUS
+          if ( child && port_status->status.connection )
+          {
+            model_reset(child);
+            child->enabled = true;
+
+            port_status->status.port_enable = 1;
+            port_status->change.reset       = 1;
+          }
+        break;
+
+        case HUB_FEATURE_PORT_SUSPEND:
+          port_status->status.suspend = 1;
+        break;
+
+        default: break;
+      }
+    return 0;
+
+    case HUB_REQUEST_CLEAR_FEATURE:
+      switch ( request->wValue )
+      {
+        case HUB_FEATURE_PORT_ENABLE:
+          port_status->status.port_enable = 0;
+          if ( child ) child->enabled = false;
+        break;
+
+        case HUB_FEATURE_PORT_POWER:
+          port_status->status.value = 0;
+          if ( child ) child->enabled = false;
+        break;
+
+        case HUB_FEATURE_PORT_SUSPEND:
+          port_status->status.suspend = 0;
+        break;
+
+        case HUB_FEATURE_PORT_CONNECTION_CHANGE:
+        case HUB_FEATURE_PORT_ENABLE_CHANGE:
+        case HUB_FEATURE_PORT_SUSPEND_CHANGE:
+        case HUB_FEATURE_PORT_OVER_CURRENT_CHANGE:
+        case HUB_FEATURE_PORT_RESET_CHANGE:
+          port_status->change.value &= (uint16_t) ~TU_BIT(request->wValue - HUB_FEATURE_PORT_CONNECTION_CHANGE);
+        break;
+
+        default: break;
+      }
+    return 0;
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+// Status change endpoint: bit n set when port n has any change, NAK while there is none
+static int32_t hub_xfer(hcd_sim_model_t* model, uint8_t ep_addr, uint8_t* buffer, uint16_t len)
+{
+  hcd_sim_hub_t* hub = (hcd_sim_hub_t*) model;
+
+  TU_VERIFY(ep_addr == HUB_EP_STATUS && len, HCD_SIM_STALL);
+
+  uint8_t bitmap = 0;
+  for(uint8_t i = 0; i < hub->port_count; i++)
+  {
+    if ( hub->port_status[i].change.value ) bitmap |= (uint8_t) TU_BIT(i+1);
+  }
+
+  if ( !bitmap ) return HCD_SIM_NAK;
+
+  buffer[0] = bitmap;
+  return 1;
+}
+
+static hcd_sim_driver_t const _hub_driver =
+{
+  .name    = "HUB",
+  .reset   = hub_reset,
+  .control = hub_control,
+  .xfer    = hub_xfer
+};
+
+void hcd_sim_hub_init(hcd_sim_hub_t* hub, uint8_t port_count)
+{
+  tu_memclr(hub, sizeof(hcd_sim_hub_t));
+
+  hub->model.driver      = &_hub_driver;
+  hub->model.desc_device = (uint8_t const*) &_hub_desc_device;
+  hub->model.desc_config = _hub_desc_config;
+  hub->model.speed       = TUSB_SPEED_FULL;
+  hub->port_count        = tu_min8(port_count, HCD_SIM_HUB_PORT_MAX);
+}
+
+bool hcd_sim_hub_attach(hcd_sim_hub_t* hub, uint8_t hub_port, hcd_sim_model_t* model)
+{
+  TU_VERIFY(1 <= hub_port && hub_port <= hub->port_count && !hub->child[hub_port-1] && !model->attached);
+  TU_VERIFY(model_register(model));
+
+  model->hub      = &hub->model;
+  model->rhport   = hub->model.rhport;
+  model->hub_port = hub_port;
+
+  hub->child[hub_port-1] = model;
+
+  // seen by the host once the port is powered
+  if ( hub->port_status[hub_port-1].status.port_power ) hub_port_connect(hub, hub_port);
+
+  return true;
+}
+
+void hcd_sim_hub_detach(hcd_sim_hub_t* hub, uint8_t hub_port)
+{
+  TU_VERIFY(1 <= hub_port && hub_port <= hub->port_count && hub->child[hub_port-1], );
+
+  model_unregister(hub->child[hub_port-1]);
+  hub->child[hub_port-1] = NULL;
+
+  hub_port_status_response_t* port_status = &hub->port_status[hub_port-1];
+  if ( port_status->status.connection )
+  {
+    port_status->status.connection  = 0;
+    port_status->status.port_enable = 0;
+    port_status->status.low_speed   = 0;
+    port_status->status.high_speed  = 0;
+    port_status->change.connection  = 1;
+  }
+}
+
+static void model_unregister(hcd_sim_model_t* model)
+{
+  // children are unplugged along with their hub
+  if ( model->driver == &_hub_driver )
+  {
+    hcd_sim_hub_t* hub = (hcd_sim_hub_t*) model;
+
+    for(uint8_t i = 0; i < hub->port_count; i++)
+    {
+      if ( hub->child[i] )
+      {
+        model_unregister(hub->child[i]);
+        hub->child[i] = NULL;
+      }
+
+      hub->port_status[i].status.value = 0;
+      hub->port_status[i].change.value = 0;
+    }
+  }
+
+  model_cancel_all(model);
+  model->attached = false;
+  model->enabled  = false;
+  model->hub      = NULL;
+
+  for(uint8_t i = 0; i < HCD_SIM_MODEL_MAX; i++)
+  {
+    if ( _sim.models[i] == model ) _sim.models[i] = NULL;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Transfer processing
+//--------------------------------------------------------------------+
+
+static void xfer_complete(hcd_sim_xfer_t* xfer, uint8_t ep_addr, uint32_t len, xfer_result_t result)
+{
+  xfer->busy = false;
+  hcd_event_xfer_complete(xfer->dev_addr, ep_addr, len, result, true);
+}
+
+static void xfer_queue(hcd_sim_model_t* model, hcd_sim_xfer_t* xfer, uint8_t dev_addr, uint8_t* buffer, uint16_t len)
+{
+  xfer->buffer   = buffer;
+  xfer->len      = len;
+  xfer->dev_addr = dev_addr;
+  xfer->due      = _sim.frame + model->latency;
+  xfer->nak_left = model->nak;
+  xfer->setup    = false;
+  xfer->busy     = true;
+}
+
+// Standard requests are answered here from the model descriptors, the rest goes to the model
+static int32_t control_request(hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer)
+{
+  if ( request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD )
+  {
+    if ( request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE )
+    {
+      switch ( request->bRequest )
+      {
+        case TUSB_REQ_SET_ADDRESS:
+          // applied after the status stage
+        return 0;
+
+        case TUSB_REQ_SET_CONFIGURATION:
+          model->cfg_num = (uint8_t) request->wValue;
+          model->halted  = 0;
+          if (model->driver->reset) model->driver->reset(model);
+        return 0;
+
+        case TUSB_REQ_GET_CONFIGURATION:
+          buffer[0] = model->cfg_num;
+        return 1;
+
+        case TUSB_REQ_GET_STATUS:
+          buffer[0] = buffer[1] = 0;
+        return 2;
+
+        case TUSB_REQ_GET_DESCRIPTOR:
+          if ( tu_u16_high(request->wValue) == TUSB_DESC_DEVICE )
+          {
+            memcpy(buffer, model->desc_device, sizeof(tusb_desc_device_t));
+            return sizeof(tusb_desc_device_t);
+          }
+
+          if ( tu_u16_high(request->wValue) == TUSB_DESC_CONFIGURATION )
+          {
+            uint16_t total_len = tu_le16toh( tu_unaligned_read16(model->desc_config + offsetof(tusb_desc_configuration_t, wTotalLength)) );
+            total_len = tu_min16(total_len, HCD_SIM_CTRL_BUFSIZE);
+
+            memcpy(buffer, model->desc_config, total_len);
+            return total_len;
+          }
+        break; // string and other descriptors are up to the model
+
+        default: break;
+      }
+    }
+    else if ( request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_ENDPOINT )
+    {
+      uint32_t const bit = halt_bit(tu_u16_low(request->wIndex));
+
+      switch ( request->bRequest )
+      {
+        case TUSB_REQ_CLEAR_FEATURE:
+          if ( request->wValue == TUSB_REQ_FEATURE_EDPT_HALT ) model->halted &= ~bit;
+        return 0;
+
+        case TUSB_REQ_SET_FEATURE:
+          if ( request->wValue == TUSB_REQ_FEATURE_EDPT_HALT ) model->halted |= bit;
+        return 0;
+
+        case TUSB_REQ_GET_STATUS:
+          buffer[0] = (model->halted & bit) ? 1 : 0;
+          buffer[1] = 0;
+        return 2;
+
+        default: break;
+      }
+    }
+  }
+
+  return model->driver->control ? model->driver->control(model, request, buffer) : HCD_SIM_STALL;
+}
+
+static void control_xfer(hcd_sim_model_t* model, uint8_t dir)
+{
+  hcd_sim_xfer_t* xfer = &model->xfer[0][dir];
+  tusb_control_request_t const* request = &model->request;
+  uint8_t const ep_addr = tu_edpt_addr(0, dir);
+
+  //------------- Setup stage -------------//
+  if ( xfer->setup )
+  {
+    model->ctrl_stage = request->wLength ? CTRL_STAGE_DATA : CTRL_STAGE_STATUS;
+    model->ctrl_len   = 0;
+
+    if ( request->wLength > HCD_SIM_CTRL_BUFSIZE )
+    {
+      model->ctrl_len = HCD_SIM_STALL;
+    }
+    else if ( request->bmRequestType_bit.direction == TUSB_DIR_IN || request->wLength == 0 )
+    {
+      // OUT data is handed to the model once its data stage is received
+      model->ctrl_len = control_request(model, request, model->ctrl_buf);
+      if ( model->ctrl_len > request->wLength ) model->ctrl_len = request->wLength;
+    }
+
+    xfer_complete(xfer, ep_addr, sizeof(tusb_control_request_t), XFER_RESULT_SUCCESS);
+    return;
+  }
+
+  // a stalled request fails its data stage or else its status stage
+  if ( model->ctrl_len < 0 )
+  {
+    model->ctrl_stage = CTRL_STAGE_IDLE;
+    xfer_complete(xfer, ep_addr, 0, XFER_RESULT_STALLED);
+    return;
+  }
+
+  //------------- Data stage -------------//
+  if ( model->ctrl_stage == CTRL_STAGE_DATA && dir == request->bmRequestType_bit.direction )
+  {
+    uint16_t len;
+
+    if ( dir == TUSB_DIR_IN )
+    {
+      len = tu_min16(xfer->len, (uint16_t) model->ctrl_len);
+      memcpy(xfer->buffer, model->ctrl_buf, len);
+    }
+    else
+    {
+      len = tu_min16(xfer->len, request->wLength);
+      memcpy(model->ctrl_buf, xfer->buffer, len);
+      model->ctrl_len = control_request(model, request, model->ctrl_buf);
+    }
+
+    model->ctrl_stage = CTRL_STAGE_STATUS;
+    xfer_complete(xfer, ep_addr, len, XFER_RESULT_SUCCESS);
+    return;
+  }
+
+  //------------- Status stage -------------//
+  if ( request->bmRequestType_bit.type      == TUSB_REQ_TYPE_STANDARD &&
+       request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_DEVICE   &&
+       request->bRequest                    == TUSB_REQ_SET_ADDRESS )
+  {
+    model->addr = (uint8_t) request->wValue;
+  }
+
+  model->ctrl_stage = CTRL_STAGE_IDLE;
+  xfer_complete(xfer, ep_addr, 0, XFER_RESULT_SUCCESS);
+}
+
+static void edpt_xfer(hcd_sim_model_t* model, uint8_t epnum, uint8_t dir)
+{
+  hcd_sim_xfer_t* xfer = &model->xfer[epnum][dir];
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+
+  // SETUP is always acknowledged
+  if ( !xfer->setup && xfer->nak_left )
+  {
+    xfer->nak_left--;
+    _sim.nak_count++;
+    return;
+  }
+
+  if ( epnum == 0 )
+  {
+    control_xfer(model, dir);
+    return;
+  }
+
+  int32_t ret = HCD_SIM_STALL;
+  if ( !(model->halted & halt_bit(ep_addr)) && model->driver->xfer )
+  {
+    ret = model->driver->xfer(model, ep_addr, xfer->buffer, xfer->len);
+  }
+
+  if ( ret == HCD_SIM_NAK )
+  {
+    _sim.nak_count++;
+  }
+  else if ( ret < 0 )
+  {
+    model->halted |= halt_bit(ep_addr);
+    xfer_complete(xfer, ep_addr, 0, XFER_RESULT_STALLED);
+  }
+  else
+  {
+    xfer_complete(xfer, ep_addr, (uint32_t) ret, XFER_RESULT_SUCCESS);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Bus API
+//--------------------------------------------------------------------+
+
+uint32_t hcd_sim_task(void)
+{
+  _sim.frame++;
+
+  for(uint8_t i = 0; i < HCD_SIM_MODEL_MAX; i++)
+  {
+    hcd_sim_model_t* model = _sim.models[i];
+
+    for(uint8_t epnum = 0; epnum < 16 && model && model->enabled; epnum++)
+    {
+      for(uint8_t dir = 0; dir < 2; dir++)
+      {
+        hcd_sim_xfer_t const* xfer = &model->xfer[epnum][dir];
+
+        if ( xfer->busy && (int32_t) (_sim.frame - xfer->due) >= 0 ) edpt_xfer(model, epnum, dir);
+      }
+    }
+  }
+
+  return _sim.frame;
+}
+
+uint32_t hcd_sim_nak_count(void)
+{
+  return _sim.nak_count;
+}
+
+bool hcd_sim_attach(uint8_t rhport, hcd_sim_model_t* model)
+{
+  TU_VERIFY(rhport < TU_ARRAY_SIZE(_sim.root) && !_sim.root[rhport] && !model->attached);
+  TU_VERIFY(model_register(model));
+
+  model->hub      = NULL;
+  model->rhport   = rhport;
+  model->hub_port = 0;
+
+  if ( model->driver == &_hub_driver )
+  {
+    hcd_sim_hub_t* hub = (hcd_sim_hub_t*) model;
+    for(uint8_t i = 0; i < hub->port_count; i++)
+    {
+      if ( hub->child[i] ) hub->child[i]->rhport = rhport;
+    }
+  }
+
+  _sim.root[rhport] = model;
+
+  // device on a root port answers right away, the stack resets it after the first descriptor
+  model_reset(model);
+  model->enabled = true;
+
+  hcd_event_device_attach(rhport, true);
+  return true;
+}
+
+void hcd_sim_detach(uint8_t rhport)
+{
+  TU_VERIFY(rhport < TU_ARRAY_SIZE(_sim.root) && _sim.root[rhport], );
+
+  model_unregister(_sim.root[rhport]);
+  _sim.root[rhport] = NULL;
+
+  hcd_event_device_remove(rhport, true);
+}
+
+void hcd_sim_halt(hcd_sim_model_t* model, uint8_t ep_addr)
+{
+  if ( tu_edpt_number(ep_addr) ) model->halted |= halt_bit(ep_addr);
+}
+
+//--------------------------------------------------------------------+
+// Controller API
+//--------------------------------------------------------------------+
+
+bool hcd_init(uint8_t rhport)
+{
+  (void) rhport;
+  return true;
+}
+
+// Nothing runs concurrently with tuh_task(), there is no interrupt to mask
+void hcd_int_enable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+void hcd_int_disable(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+// Time only passes when the clock is read: osal_task_delay() keeps the bus running without sleeping
+uint32_t hcd_frame_number(uint8_t rhport)
+{
+  (void) rhport;
+  return hcd_sim_task();
+}
+
+//--------------------------------------------------------------------+
+// Port API
+//--------------------------------------------------------------------+
+
+bool hcd_port_connect_status(uint8_t rhport)
+{
+  return (rhport < TU_ARRAY_SIZE(_sim.root)) && (_sim.root[rhport] != NULL);
+}
+
+void hcd_port_reset(uint8_t rhport)
+{
+  TU_VERIFY(hcd_port_connect_status(rhport), );
+
+  model_reset(_sim.root[rhport]);
+  _sim.root[rhport]->enabled = true;
+}
+
+void hcd_port_reset_end(uint8_t rhport)
+{
+  (void) rhport;
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport)
+{
+  return hcd_port_connect_status(rhport) ? _sim.root[rhport]->speed : TUSB_SPEED_INVALID;
+}
+
+// Abort transfers still queued with this address
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
+{
+  for(uint8_t i = 0; i < HCD_SIM_MODEL_MAX; i++)
+  {
+    hcd_sim_model_t* model = _sim.models[i];
+    if ( !model || model->rhport != rhport ) continue;
+
+    for(uint8_t epnum = 0; epnum < 16; epnum++)
+    {
+      for(uint8_t dir = 0; dir < 2; dir++)
+      {
+        hcd_sim_xfer_t* xfer = &model->xfer[epnum][dir];
+        if ( xfer->dev_addr == dev_addr ) xfer->busy = false;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Endpoints API
+//--------------------------------------------------------------------+
+
+bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet[8])
+{
+  hcd_sim_model_t* model = model_find(rhport, dev_addr);
+  TU_VERIFY(model);
+
+  // SETUP aborts whatever is pending on the control endpoint
+  model->xfer[0][TUSB_DIR_IN].busy = false;
+  memcpy(&model->request, setup_packet, sizeof(tusb_control_request_t));
+
+  hcd_sim_xfer_t* xfer = &model->xfer[0][TUSB_DIR_OUT];
+  xfer_queue(model, xfer, dev_addr, NULL, sizeof(tusb_control_request_t));
+  xfer->setup = true;
+
+  return true;
+}
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc)
+{
+  (void) rhport; (void) dev_addr; (void) ep_desc;
+  return true;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
+{
+  hcd_sim_model_t* model = model_find(rhport, dev_addr);
+  TU_VERIFY(model);
+
+  xfer_queue(model, &model->xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)], dev_addr, buffer, buflen);
+  return true;
+}
+
+// Only resets the host side data toggle: the device halt is cleared by CLEAR_FEATURE(ENDPOINT_HALT)
+bool hcd_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr)
+{
+  (void) dev_addr; (void) ep_addr;
+  return true;
+}
+
+#endif
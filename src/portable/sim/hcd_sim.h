@@ -0,0 +1,173 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/** \ingroup group_hcd
+ *  \defgroup group_hcd_sim Simulated Controller
+ *  In-process host controller for running the host stack on a PC (OPT_MCU_SIM).
+ *  Transfers are routed to device models written in C, see hcd_sim_model.h for the
+ *  stock ones. Everything runs on the tuh_task() thread, nothing here is thread safe.
+ *
+ *  The bus advances one frame per hcd_sim_task() or hcd_frame_number() call, so
+ *  the blocking delays of the enumeration keep the bus running and take no wall time.
+ *  @{ */
+
+#ifndef _TUSB_HCD_SIM_H_
+#define _TUSB_HCD_SIM_H_
+
+#include "common/tusb_common.h"
+#include "host/usbh.h"
+#include "host/hub.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Max number of models attached at once, hubs and their children included
+#ifndef HCD_SIM_MODEL_MAX
+  #define HCD_SIM_MODEL_MAX     16
+#endif
+
+// Control data stage buffer of a model, longer requests are stalled
+#ifndef HCD_SIM_CTRL_BUFSIZE
+  #define HCD_SIM_CTRL_BUFSIZE  256
+#endif
+
+#define HCD_SIM_HUB_PORT_MAX    7
+
+// Negative return of the model callbacks, a non-negative value is the number of bytes transferred
+enum
+{
+  HCD_SIM_NAK   = -1, ///< not ready, the transfer is retried next frame
+  HCD_SIM_STALL = -2, ///< handshake with STALL, non-control endpoints stay halted until CLEAR_FEATURE
+};
+
+typedef struct hcd_sim_model hcd_sim_model_t;
+
+typedef struct
+{
+  char const* name;
+
+  // Bus reset and SET_CONFIGURATION, optional
+  void (* reset) (hcd_sim_model_t* model);
+
+  // Requests not handled by hcd_sim: everything but standard device requests and
+  // endpoint halt. buffer holds the data stage of an OUT request or receives the
+  // response of an IN one (up to HCD_SIM_CTRL_BUFSIZE). Return its length or HCD_SIM_STALL.
+  int32_t (* control) (hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer);
+
+  // Serve a whole transfer on a non-control endpoint: return bytes consumed (OUT) or
+  // produced (IN, less than len is a short packet), HCD_SIM_NAK or HCD_SIM_STALL
+  int32_t (* xfer) (hcd_sim_model_t* model, uint8_t ep_addr, uint8_t* buffer, uint16_t len);
+} hcd_sim_driver_t;
+
+typedef struct
+{
+  uint8_t* buffer;
+  uint32_t due;      // frame of the first attempt
+  uint16_t len;
+  uint16_t nak_left;
+  uint8_t  dev_addr; // address the transfer is queued with
+  bool     busy;
+  bool     setup;
+} hcd_sim_xfer_t;
+
+struct hcd_sim_model
+{
+  hcd_sim_driver_t const* driver;
+  uint8_t const* desc_device;
+  uint8_t const* desc_config;
+  tusb_speed_t speed;
+
+  //------------- Fault injection, can be changed at any time -------------//
+  uint16_t latency;  // frames between queuing a transfer and its first attempt
+  uint16_t nak;      // NAKs answered to each transfer before it is served, SETUP excluded
+
+  //------------- Internal, managed by hcd_sim -------------//
+  hcd_sim_model_t* hub; // upstream hub, NULL if attached to a root port
+  uint8_t rhport;
+  uint8_t hub_port;
+
+  bool    attached;
+  bool    enabled;      // answers transactions, set by a port reset (by attach on a root port)
+  uint8_t addr;         // SET_ADDRESS is applied after its status stage
+  uint8_t cfg_num;
+  uint8_t ctrl_stage;
+  int32_t ctrl_len;     // data stage length or HCD_SIM_STALL
+  uint32_t reset_frame;
+  uint32_t halted;      // bit n: OUT endpoint n, bit 16+n: IN endpoint n
+
+  tusb_control_request_t request;
+  uint8_t ctrl_buf[HCD_SIM_CTRL_BUFSIZE];
+
+  hcd_sim_xfer_t xfer[16][2];
+};
+
+// Hub with up to HCD_SIM_HUB_PORT_MAX ports, its children are enabled by a port reset
+typedef struct
+{
+  hcd_sim_model_t model;
+  uint8_t port_count;
+
+  hcd_sim_model_t* child[HCD_SIM_HUB_PORT_MAX];
+  hub_port_status_response_t port_status[HCD_SIM_HUB_PORT_MAX];
+} hcd_sim_hub_t;
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+
+// Run one frame: serve queued transfers whose latency has elapsed, return the new frame number
+uint32_t hcd_sim_task(void);
+
+// Number of NAKs answered so far
+uint32_t hcd_sim_nak_count(void);
+
+// Plug a model into a root port, false if the port is taken or too many models are attached
+bool hcd_sim_attach(uint8_t rhport, hcd_sim_model_t* model);
+
+// Unplug whatever is attached to a root port, children of a hub included
+void hcd_sim_detach(uint8_t rhport);
+
+// Halt a non-control endpoint: its transfers are answered with STALL until it is cleared
+void hcd_sim_halt(hcd_sim_model_t* model, uint8_t ep_addr);
+
+//--------------------------------------------------------------------+
+// Hub
+//--------------------------------------------------------------------+
+
+void hcd_sim_hub_init(hcd_sim_hub_t* hub, uint8_t port_count);
+
+// Plug/unplug a model on a downstream port (1-based), reported through the hub status pipe
+bool hcd_sim_hub_attach(hcd_sim_hub_t* hub, uint8_t hub_port, hcd_sim_model_t* model);
+void hcd_sim_hub_detach(hcd_sim_hub_t* hub, uint8_t hub_port);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_HCD_SIM_H_ */
+
+/// @}
@@ -0,0 +1,540 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if TUSB_OPT_HOST_ENABLED && CFG_TUSB_MCU == OPT_MCU_SIM
+
+#include "device/usbd.h"          // descriptor templates
+#include "class/hid/hid_device.h" // report descriptor template
+#include "hcd_sim_model.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+enum
+{
+  MSC_EP_OUT   = 0x01,
+  MSC_EP_IN    = 0x81,
+
+  HID_EP_IN    = 0x81,
+
+  CDC_EP_NOTIF = 0x81,
+  CDC_EP_OUT   = 0x02,
+  CDC_EP_IN    = 0x82,
+};
+
+enum
+{
+  MSC_STAGE_CMD,
+  MSC_STAGE_DATA,
+  MSC_STAGE_STATUS
+};
+
+#define SIM_DESC_DEVICE(_class, _subclass, _protocol, _pid) \
+  { \
+    .bLength            = sizeof(tusb_desc_device_t), \
+    .bDescriptorType    = TUSB_DESC_DEVICE, \
+    .bcdUSB             = 0x0200, \
+    .bDeviceClass       = _class, \
+    .bDeviceSubClass    = _subclass, \
+    .bDeviceProtocol    = _protocol, \
+    .bMaxPacketSize0    = 64, \
+    .idVendor           = 0xCafe, \
+    .idProduct          = _pid, \
+    .bcdDevice          = 0x0100, \
+    .iManufacturer      = 0x00, \
+    .iProduct           = 0x00, \
+    .iSerialNumber      = 0x00, \
+    .bNumConfigurations = 0x01 \
+  }
+
+//--------------------------------------------------------------------+
+// Mass Storage
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _msc_desc_device = SIM_DESC_DEVICE(0x00, 0x00, 0x00, 0x4101);
+
+static uint8_t const _msc_desc_config[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN, 0x00, 100),
+
+  // Interface number, string index, EP Out & EP In address, EP size
+  TUD_MSC_DESCRIPTOR(0, 0, MSC_EP_OUT, MSC_EP_IN, 64),
+};
+
+static void msc_fail(hcd_sim_msc_t* msc, uint8_t sense_key, uint8_t asc, uint8_t ascq)
+{
+  msc->csw.status = MSC_CSW_STATUS_FAILED;
+
+  tu_memclr(&msc->sense, sizeof(msc->sense));
+  msc->sense.response_code       = 0x70;
+  msc->sense.valid               = 1;
+  msc->sense.sense_key           = sense_key;
+  msc->sense.add_sense_len       = sizeof(scsi_sense_fixed_resp_t) - 8;
+  msc->sense.add_sense_code      = asc;
+  msc->sense.add_sense_qualifier = ascq;
+}
+
+// Execute the SCSI command of a CBW: fill in the CSW and point data to the data stage
+static void msc_command(hcd_sim_msc_t* msc)
+{
+  msc_cbw_t const* cbw = &msc->cbw;
+
+  msc->csw.signature    = MSC_CSW_SIGNATURE;
+  msc->csw.tag          = cbw->tag;
+  msc->csw.data_residue = 0;
+  msc->csw.status       = MSC_CSW_STATUS_PASSED;
+
+  msc->data     = msc->resp;
+  msc->data_len = 0;
+  msc->xferred  = 0;
+
+  switch ( cbw->command[0] )
+  {
+    case SCSI_CMD_TEST_UNIT_READY:
+      if ( msc->not_ready )
+      {
+        msc->not_ready--;
+        msc_fail(msc, SCSI_SENSE_NOT_READY, 0x04, 0x01); // becoming ready
+      }
+    break;
+
+    case SCSI_CMD_INQUIRY:
+    {
+      scsi_inquiry_resp_t* resp = (scsi_inquiry_resp_t*) msc->resp;
+
+      tu_memclr(resp, sizeof(scsi_inquiry_resp_t));
+      resp->is_removable         = 1;
+      resp->version              = 2;
+      resp->response_data_format = 2;
+      resp->additional_length    = sizeof(scsi_inquiry_resp_t) - 5;
+      memcpy(resp->vendor_id  , "TinyUSB ", 8);
+      memcpy(resp->product_id , "Sim RAM Disk    ", 16);
+      memcpy(resp->product_rev, "1.0 ", 4);
+
+      msc->data_len = sizeof(scsi_inquiry_resp_t);
+    }
+    break;
+
+    case SCSI_CMD_READ_CAPACITY_10:
+    {
+      scsi_read_capacity10_resp_t const resp =
+      {
+        .last_lba   = tu_htonl(msc->block_count - 1),
+        .block_size = tu_htonl((uint32_t) msc->block_size)
+      };
+
+      memcpy(msc->resp, &resp, sizeof(resp));
+      msc->data_len = sizeof(resp);
+    }
+    break;
+
+    case SCSI_CMD_REQUEST_SENSE:
+      memcpy(msc->resp, &msc->sense, sizeof(scsi_sense_fixed_resp_t));
+      msc->data_len = sizeof(scsi_sense_fixed_resp_t);
+
+      tu_memclr(&msc->sense, sizeof(msc->sense));
+      msc->sense.response_code = 0x70;
+    break;
+
+    case SCSI_CMD_MODE_SENSE_6:
+      // header only: not write protected, no block descriptor
+      tu_memclr(msc->resp, 4);
+      msc->resp[0]  = 3;
+      msc->data_len = 4;
+    break;
+
+    case SCSI_CMD_START_STOP_UNIT:
+    case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+    break;
+
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_WRITE_10:
+    {
+      scsi_read10_t const* cmd_rw = (scsi_read10_t const*) cbw->command;
+      uint32_t const lba   = tu_ntohl(cmd_rw->lba);
+      uint16_t const count = tu_ntohs(cmd_rw->block_count);
+
+      if ( lba >= msc->block_count || count > msc->block_count - lba )
+      {
+        msc_fail(msc, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA out of range
+        break;
+      }
+
+      msc->data     = msc->disk + lba*msc->block_size;
+      msc->data_len = (uint32_t) count*msc->block_size;
+    }
+    break;
+
+    default:
+      msc_fail(msc, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00); // invalid command
+    break;
+  }
+}
+
+static void msc_reset(hcd_sim_model_t* model)
+{
+  hcd_sim_msc_t* msc = (hcd_sim_msc_t*) model;
+  msc->stage = MSC_STAGE_CMD;
+}
+
+static int32_t msc_control(hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer)
+{
+  TU_VERIFY(request->bmRequestType_bit.type      == TUSB_REQ_TYPE_CLASS &&
+            request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE, HCD_SIM_STALL);
+
+  switch ( request->bRequest )
+  {
+    case MSC_REQ_GET_MAX_LUN:
+      buffer[0] = 0;
+    return 1;
+
+    case MSC_REQ_RESET:
+      msc_reset(model);
+    return 0;
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+static int32_t msc_xfer(hcd_sim_model_t* model, uint8_t ep_addr, uint8_t* buffer, uint16_t len)
+{
+  hcd_sim_msc_t* msc = (hcd_sim_msc_t*) model;
+  msc_cbw_t const* cbw = &msc->cbw;
+
+  switch ( msc->stage )
+  {
+    case MSC_STAGE_CMD:
+      // nothing to send before a command
+      if ( ep_addr != MSC_EP_OUT ) return HCD_SIM_NAK;
+
+      TU_VERIFY(len == sizeof(msc_cbw_t), HCD_SIM_STALL);
+      memcpy(&msc->cbw, buffer, sizeof(msc_cbw_t));
+      TU_VERIFY(cbw->signature == MSC_CBW_SIGNATURE, HCD_SIM_STALL);
+
+      msc_command(msc);
+      msc->stage = cbw->total_bytes ? MSC_STAGE_DATA : MSC_STAGE_STATUS;
+    return len;
+
+    case MSC_STAGE_DATA:
+    {
+      bool const dir_in = tu_edpt_dir(cbw->dir) == TUSB_DIR_IN;
+      if ( ep_addr != (dir_in ? MSC_EP_IN : MSC_EP_OUT) ) return HCD_SIM_NAK;
+
+      uint32_t const remaining = cbw->total_bytes - msc->xferred;
+      uint32_t xferred;
+
+      if ( dir_in )
+      {
+        // a command with less data than asked ends with a short packet
+        xferred = tu_min32(tu_min32(len, remaining), msc->data_len);
+        memcpy(buffer, msc->data, xferred);
+      }
+      else
+      {
+        // excess data is dropped
+        xferred = tu_min32(len, remaining);
+        memcpy(msc->data, buffer, tu_min32(xferred, msc->data_len));
+      }
+
+      uint32_t const consumed = tu_min32(xferred, msc->data_len);
+      msc->data     += consumed;
+      msc->data_len -= consumed;
+      msc->xferred  += xferred;
+
+      if ( msc->xferred == cbw->total_bytes || (dir_in && xferred < len) )
+      {
+        msc->csw.data_residue = cbw->total_bytes - msc->xferred;
+        msc->stage = MSC_STAGE_STATUS;
+      }
+
+      return (int32_t) xferred;
+    }
+
+    case MSC_STAGE_STATUS:
+      if ( ep_addr != MSC_EP_IN ) return HCD_SIM_NAK;
+      TU_VERIFY(len >= sizeof(msc_csw_t), HCD_SIM_STALL);
+
+      memcpy(buffer, &msc->csw, sizeof(msc_csw_t));
+      msc->stage = MSC_STAGE_CMD;
+    return sizeof(msc_csw_t);
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+static hcd_sim_driver_t const _msc_driver =
+{
+  .name    = "MSC",
+  .reset   = msc_reset,
+  .control = msc_control,
+  .xfer    = msc_xfer
+};
+
+void hcd_sim_msc_init(hcd_sim_msc_t* msc, void* disk, uint32_t block_count, uint16_t block_size)
+{
+  tu_memclr(msc, sizeof(hcd_sim_msc_t));
+
+  msc->model.driver      = &_msc_driver;
+  msc->model.desc_device = (uint8_t const*) &_msc_desc_device;
+  msc->model.desc_config = _msc_desc_config;
+  msc->model.speed       = TUSB_SPEED_FULL;
+
+  msc->disk        = (uint8_t*) disk;
+  msc->block_count = block_count;
+  msc->block_size  = block_size;
+
+  msc->sense.response_code = 0x70;
+}
+
+//--------------------------------------------------------------------+
+// HID gamepad
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _hid_desc_device = SIM_DESC_DEVICE(0x00, 0x00, 0x00, 0x4102);
+
+static uint8_t const _hid_desc_report[] =
+{
+  TUD_HID_REPORT_DESC_GAMEPAD()
+};
+
+static uint8_t const _hid_desc_config[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN, 0x00, 100),
+
+  // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval
+  TUD_HID_DESCRIPTOR(0, 0, HID_ITF_PROTOCOL_NONE, sizeof(_hid_desc_report), HID_EP_IN, 16, 1),
+};
+
+static void hid_reset(hcd_sim_model_t* model)
+{
+  hcd_sim_hid_t* hid = (hcd_sim_hid_t*) model;
+
+  hid->pending   = false;
+  hid->protocol  = HID_PROTOCOL_REPORT;
+  hid->idle_rate = 0;
+}
+
+static int32_t hid_control(hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer)
+{
+  hcd_sim_hid_t* hid = (hcd_sim_hid_t*) model;
+
+  TU_VERIFY(request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE, HCD_SIM_STALL);
+
+  if ( request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD )
+  {
+    TU_VERIFY(request->bRequest == TUSB_REQ_GET_DESCRIPTOR &&
+              tu_u16_high(request->wValue) == HID_DESC_TYPE_REPORT, HCD_SIM_STALL);
+
+    memcpy(buffer, _hid_desc_report, sizeof(_hid_desc_report));
+    return sizeof(_hid_desc_report);
+  }
+
+  TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS, HCD_SIM_STALL);
+
+  switch ( request->bRequest )
+  {
+    case HID_REQ_CONTROL_GET_REPORT:
+      memcpy(buffer, &hid->report, sizeof(hid_gamepad_report_t));
+    return sizeof(hid_gamepad_report_t);
+
+    case HID_REQ_CONTROL_SET_REPORT:
+    return request->wLength;
+
+    case HID_REQ_CONTROL_GET_IDLE:
+      buffer[0] = hid->idle_rate;
+    return 1;
+
+    case HID_REQ_CONTROL_SET_IDLE:
+      hid->idle_rate = tu_u16_high(request->wValue);
+    return 0;
+
+    case HID_REQ_CONTROL_GET_PROTOCOL:
+      buffer[0] = hid->protocol;
+    return 1;
+
+    case HID_REQ_CONTROL_SET_PROTOCOL:
+      hid->protocol = (uint8_t) request->wValue;
+    return 0;
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+static int32_t hid_xfer(hcd_sim_model_t* model, uint8_t ep_addr, uint8_t* buffer, uint16_t len)
+{
+  hcd_sim_hid_t* hid = (hcd_sim_hid_t*) model;
+
+  TU_VERIFY(ep_addr == HID_EP_IN, HCD_SIM_STALL);
+
+  if ( hid->stream )
+  {
+    hid->report.x++;
+  }
+  else if ( hid->pending )
+  {
+    hid->pending = false;
+  }
+  else
+  {
+    return HCD_SIM_NAK;
+  }
+
+  uint16_t const xferred = tu_min16(len, sizeof(hid_gamepad_report_t));
+  memcpy(buffer, &hid->report, xferred);
+  hid->report_count++;
+
+  return xferred;
+}
+
+static hcd_sim_driver_t const _hid_driver =
+{
+  .name    = "HID",
+  .reset   = hid_reset,
+  .control = hid_control,
+  .xfer    = hid_xfer
+};
+
+void hcd_sim_hid_init(hcd_sim_hid_t* hid)
+{
+  tu_memclr(hid, sizeof(hcd_sim_hid_t));
+
+  hid->model.driver      = &_hid_driver;
+  hid->model.desc_device = (uint8_t const*) &_hid_desc_device;
+  hid->model.desc_config = _hid_desc_config;
+  hid->model.speed       = TUSB_SPEED_FULL;
+}
+
+void hcd_sim_hid_report(hcd_sim_hid_t* hid, hid_gamepad_report_t const* report)
+{
+  hid->report  = *report;
+  hid->pending = true;
+}
+
+//--------------------------------------------------------------------+
+// CDC echo
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _cdc_desc_device = SIM_DESC_DEVICE(TUSB_CLASS_MISC, MISC_SUBCLASS_COMMON, MISC_PROTOCOL_IAD, 0x4103);
+
+static uint8_t const _cdc_desc_config[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 2, 0, TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN, 0x00, 100),
+
+  // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
+  TUD_CDC_DESCRIPTOR(0, 0, CDC_EP_NOTIF, 8, CDC_EP_OUT, CDC_EP_IN, 64),
+};
+
+static void cdc_reset(hcd_sim_model_t* model)
+{
+  hcd_sim_cdc_t* cdc = (hcd_sim_cdc_t*) model;
+
+  cdc->line_state = 0;
+  tu_fifo_clear(&cdc->ff);
+}
+
+static int32_t cdc_control(hcd_sim_model_t* model, tusb_control_request_t const* request, uint8_t* buffer)
+{
+  hcd_sim_cdc_t* cdc = (hcd_sim_cdc_t*) model;
+
+  TU_VERIFY(request->bmRequestType_bit.type      == TUSB_REQ_TYPE_CLASS &&
+            request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE, HCD_SIM_STALL);
+
+  switch ( request->bRequest )
+  {
+    case CDC_REQUEST_SET_LINE_CODING:
+      TU_VERIFY(request->wLength == sizeof(cdc_line_coding_t), HCD_SIM_STALL);
+      memcpy(&cdc->line_coding, buffer, sizeof(cdc_line_coding_t));
+    return sizeof(cdc_line_coding_t);
+
+    case CDC_REQUEST_GET_LINE_CODING:
+      memcpy(buffer, &cdc->line_coding, sizeof(cdc_line_coding_t));
+    return sizeof(cdc_line_coding_t);
+
+    case CDC_REQUEST_SET_CONTROL_LINE_STATE:
+      cdc->line_state = request->wValue;
+    return 0;
+
+    case CDC_REQUEST_SEND_BREAK:
+    return 0;
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+static int32_t cdc_xfer(hcd_sim_model_t* model, uint8_t ep_addr, uint8_t* buffer, uint16_t len)
+{
+  hcd_sim_cdc_t* cdc = (hcd_sim_cdc_t*) model;
+
+  switch ( ep_addr )
+  {
+    case CDC_EP_OUT:
+      if ( len > tu_fifo_remaining(&cdc->ff) ) return HCD_SIM_NAK;
+    return tu_fifo_write_n(&cdc->ff, buffer, len);
+
+    case CDC_EP_IN:
+      if ( tu_fifo_empty(&cdc->ff) ) return HCD_SIM_NAK;
+    return tu_fifo_read_n(&cdc->ff, buffer, len);
+
+    // no serial state to notify
+    case CDC_EP_NOTIF:
+    return HCD_SIM_NAK;
+
+    default: return HCD_SIM_STALL;
+  }
+}
+
+static hcd_sim_driver_t const _cdc_driver =
+{
+  .name    = "CDC",
+  .reset   = cdc_reset,
+  .control = cdc_control,
+  .xfer    = cdc_xfer
+};
+
+void hcd_sim_cdc_init(hcd_sim_cdc_t* cdc)
+{
+  tu_memclr(cdc, sizeof(hcd_sim_cdc_t));
+
+  cdc->model.driver      = &_cdc_driver;
+  cdc->model.desc_device = (uint8_t const*) &_cdc_desc_device;
+  cdc->model.desc_config = _cdc_desc_config;
+  cdc->model.speed       = TUSB_SPEED_FULL;
+
+  cdc->line_coding.bit_rate  = 115200;
+  cdc->line_coding.stop_bits = 0;
+  cdc->line_coding.parity    = 0;
+  cdc->line_coding.data_bits = 8;
+
+  TU_ASSERT(tu_fifo_config(&cdc->ff, cdc->ff_buf, HCD_SIM_CDC_BUFSIZE, 1, false), );
+}
+
+#endif
@@ -0,0 +1,127 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/** \ingroup group_hcd_sim
+ *  \defgroup group_hcd_sim_model Device Models
+ *  Stock devices for the simulated host controller: RAM disk, gamepad and CDC echo.
+ *  Each one embeds hcd_sim_model_t as its first member, plug it with
+ *  hcd_sim_attach(rhport, &dev.model) or hcd_sim_hub_attach(hub, port, &dev.model).
+ *  @{ */
+
+#ifndef _TUSB_HCD_SIM_MODEL_H_
+#define _TUSB_HCD_SIM_MODEL_H_
+
+#include "common/tusb_common.h"
+#include "common/tusb_fifo.h"
+#include "class/msc/msc.h"
+#include "class/hid/hid.h"
+#include "class/cdc/cdc.h"
+#include "hcd_sim.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#ifndef HCD_SIM_CDC_BUFSIZE
+  #define HCD_SIM_CDC_BUFSIZE   1024
+#endif
+
+//--------------------------------------------------------------------+
+// Mass Storage: Bulk-Only RAM disk with a single LUN
+//--------------------------------------------------------------------+
+typedef struct
+{
+  hcd_sim_model_t model;
+
+  uint8_t* disk;
+  uint32_t block_count;
+  uint16_t block_size;
+
+  // TEST UNIT READY fails this many times with NOT READY before the unit comes up
+  uint8_t not_ready;
+
+  //------------- Internal -------------//
+  uint8_t  stage;
+  msc_cbw_t cbw;
+  msc_csw_t csw;
+  uint8_t* data;     // data stage buffer: the disk for READ10/WRITE10, resp otherwise
+  uint32_t data_len; // bytes left in data
+  uint32_t xferred;  // bytes moved in the data stage so far
+  scsi_sense_fixed_resp_t sense;
+  uint8_t  resp[36];
+} hcd_sim_msc_t;
+
+void hcd_sim_msc_init(hcd_sim_msc_t* msc, void* disk, uint32_t block_count, uint16_t block_size);
+
+//--------------------------------------------------------------------+
+// HID gamepad, one report per interrupt IN transfer
+//--------------------------------------------------------------------+
+typedef struct
+{
+  hcd_sim_model_t model;
+
+  // true: a new report is ready on every poll (x counts up), false: only those queued
+  // with hcd_sim_hid_report(), polls are NAKed in between
+  bool stream;
+
+  //------------- Internal -------------//
+  hid_gamepad_report_t report;
+  bool     pending;
+  uint8_t  protocol;
+  uint8_t  idle_rate;
+  uint32_t report_count;
+} hcd_sim_hid_t;
+
+void hcd_sim_hid_init(hcd_sim_hid_t* hid);
+
+// Queue a report for the next poll, replaces a report that has not been read yet
+void hcd_sim_hid_report(hcd_sim_hid_t* hid, hid_gamepad_report_t const* report);
+
+//--------------------------------------------------------------------+
+// CDC ACM echo: data written to bulk OUT comes back on bulk IN
+//--------------------------------------------------------------------+
+typedef struct
+{
+  hcd_sim_model_t model;
+
+  //------------- Internal -------------//
+  cdc_line_coding_t line_coding;
+  uint16_t line_state;
+
+  // OUT transfers are NAKed while they do not fit, IN ones while it is empty
+  tu_fifo_t ff;
+  uint8_t ff_buf[HCD_SIM_CDC_BUFSIZE];
+} hcd_sim_cdc_t;
+
+void hcd_sim_cdc_init(hcd_sim_cdc_t* cdc);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_HCD_SIM_MODEL_H_ */
+
+/// @}
@@ -0,0 +1,821 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if TUSB_OPT_DEVICE_ENABLED && CFG_TUSB_MCU == OPT_MCU_SIM
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "dcd_sim.h"
+#include "usbip_sim.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+TU_VERIFY_STATIC(USBIP_SIM_URB_BUFSIZE <= UINT16_MAX, "dcd_sim transfer is limited to 16-bit length");
+
+enum
+{
+  USBIP_VERSION    = 0x0111,
+
+  OP_REQ_DEVLIST   = 0x8005,
+  OP_REP_DEVLIST   = 0x0005,
+  OP_REQ_IMPORT    = 0x8003,
+  OP_REP_IMPORT    = 0x0003,
+
+  USBIP_CMD_SUBMIT = 1,
+  USBIP_CMD_UNLINK = 2,
+  USBIP_RET_SUBMIT = 3,
+  USBIP_RET_UNLINK = 4,
+
+  USBIP_DIR_OUT    = 0,
+  USBIP_DIR_IN     = 1,
+
+  URB_ZERO_PACKET  = 0x0040,
+};
+
+enum
+{
+  USBIP_DEV_ADDR = 1,  // address assigned when device is attached
+  USBIP_ITF_MAX  = 32, // interfaces reported in device list
+};
+
+// Protocol structures, multi-byte fields are big endian on the wire except for setup packet
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t version;
+  uint16_t code;
+  uint32_t status;
+} usbip_op_header_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  char     path[256];
+  char     busid[32];
+  uint32_t busnum;
+  uint32_t devnum;
+  uint32_t speed;
+  uint16_t idVendor;
+  uint16_t idProduct;
+  uint16_t bcdDevice;
+  uint8_t  bDeviceClass;
+  uint8_t  bDeviceSubClass;
+  uint8_t  bDeviceProtocol;
+  uint8_t  bConfigurationValue;
+  uint8_t  bNumConfigurations;
+  uint8_t  bNumInterfaces;
+} usbip_usb_device_t;
+
+TU_VERIFY_STATIC(sizeof(usbip_usb_device_t) == 312, "size is not correct");
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t command;
+  uint32_t seqnum;
+  uint32_t devid;
+  uint32_t direction;
+  uint32_t ep;
+
+  union
+  {
+    struct TU_ATTR_PACKED
+    {
+      uint32_t transfer_flags;
+      uint32_t transfer_buffer_length;
+      uint32_t start_frame;
+      uint32_t number_of_packets;
+      uint32_t interval;
+      uint8_t  setup[8];
+    } cmd_submit;
+
+    struct TU_ATTR_PACKED
+    {
+      uint32_t status;
+      uint32_t actual_length;
+      uint32_t start_frame;
+      uint32_t number_of_packets;
+      uint32_t error_count;
+      uint8_t  padding[8];
+    } ret_submit;
+
+    struct TU_ATTR_PACKED
+    {
+      uint32_t unlink_seqnum;
+      uint8_t  padding[24];
+    } cmd_unlink;
+
+    struct TU_ATTR_PACKED
+    {
+      uint32_t status;
+      uint8_t  padding[24];
+    } ret_unlink;
+  };
+} usbip_header_t;
+
+TU_VERIFY_STATIC(sizeof(usbip_header_t) == 48, "size is not correct");
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t offset;
+  uint32_t length;
+  uint32_t actual_length;
+  uint32_t status;
+} usbip_iso_desc_t;
+
+typedef struct
+{
+  uint32_t seqnum;
+  uint32_t stamp;       // arrival order, URBs of an endpoint are completed in this order
+  uint8_t  ep_addr;
+  bool     active;
+  bool     zlp;         // OUT transfer multiple of packet size is terminated by ZLP
+
+  uint32_t length;
+  uint32_t actual;
+
+  uint32_t start_frame;
+  uint16_t iso_count;   // 0 if not isochronous
+  uint16_t iso_next;
+  uint32_t error_count;
+  usbip_iso_desc_t iso[USBIP_SIM_ISO_MAX]; // host byte order
+
+  uint8_t  buffer[USBIP_SIM_URB_BUFSIZE];
+} usbip_urb_t;
+
+typedef struct
+{
+  uint8_t rhport;
+  tusb_speed_t speed;
+  void (*pump)(void);
+
+  int listen_fd;
+  int client_fd;
+  uint16_t port;
+  bool imported;
+
+  uint32_t stamp;
+  uint8_t urb_count;
+
+  // reported by device list and import
+  tusb_desc_device_t desc_device;
+  uint8_t itf_count;
+  uint8_t itf_class[USBIP_ITF_MAX][3];
+} usbip_sim_t;
+
+static usbip_sim_t _usbip = { .listen_fd = -1, .client_fd = -1 };
+static usbip_urb_t _usbip_urb[USBIP_SIM_URB_MAX];
+
+// scratch buffer for descriptors read when attaching device
+static uint8_t _usbip_desc[USBIP_SIM_URB_BUFSIZE];
+
+//--------------------------------------------------------------------+
+// Socket
+//--------------------------------------------------------------------+
+
+static bool sock_recv(void* buffer, size_t len)
+{
+  uint8_t* p = (uint8_t*) buffer;
+
+  while ( len )
+  {
+    ssize_t const count = recv(_usbip.client_fd, p, len, 0);
+    if ( count < 0 && errno == EINTR ) continue;
+    if ( count <= 0 ) return false;
+
+    p   += count;
+    len -= (size_t) count;
+  }
+
+  return true;
+}
+
+static bool sock_send(void const* buffer, size_t len)
+{
+  uint8_t const* p = (uint8_t const*) buffer;
+
+  while ( len )
+  {
+    ssize_t const count = send(_usbip.client_fd, p, len, MSG_NOSIGNAL);
+    if ( count < 0 && errno == EINTR ) continue;
+    if ( count <= 0 ) return false;
+
+    p   += count;
+    len -= (size_t) count;
+  }
+
+  return true;
+}
+
+// skip payload of a submission that can not be accepted
+static bool sock_discard(size_t len)
+{
+  uint8_t scratch[256];
+
+  while ( len )
+  {
+    size_t const count = tu_min32((uint32_t) len, sizeof(scratch));
+    TU_VERIFY( sock_recv(scratch, count) );
+    len -= count;
+  }
+
+  return true;
+}
+
+static void client_close(void)
+{
+  if ( _usbip.client_fd >= 0 ) close(_usbip.client_fd);
+
+  _usbip.client_fd = -1;
+  _usbip.imported  = false;
+  _usbip.urb_count = 0;
+
+  for(uint8_t i = 0; i < USBIP_SIM_URB_MAX; i++) _usbip_urb[i].active = false;
+}
+
+//--------------------------------------------------------------------+
+// Device
+//--------------------------------------------------------------------+
+
+static int32_t control_xfer(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wLength, void* buffer)
+{
+  tusb_control_request_t const request =
+  {
+    .bmRequestType = bmRequestType,
+    .bRequest      = bRequest,
+    .wValue        = tu_htole16(wValue),
+    .wIndex        = 0,
+    .wLength       = tu_htole16(wLength)
+  };
+
+  return dcd_sim_control_xfer(_usbip.rhport, &request, buffer, _usbip.pump);
+}
+
+// Reset and address device, then read descriptors reported by device list and import
+static bool device_attach(void)
+{
+  dcd_sim_bus_reset(_usbip.rhport, _usbip.speed);
+  if ( _usbip.pump ) _usbip.pump();
+
+  TU_ASSERT( control_xfer(0x00, TUSB_REQ_SET_ADDRESS, USBIP_DEV_ADDR, 0, NULL) == 0 );
+  TU_ASSERT( control_xfer(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, sizeof(tusb_desc_device_t),
+                          &_usbip.desc_device) == sizeof(tusb_desc_device_t) );
+
+  // configuration header for total length, then whole configuration
+  TU_ASSERT( control_xfer(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, sizeof(tusb_desc_configuration_t),
+                          _usbip_desc) == sizeof(tusb_desc_configuration_t) );
+
+  tusb_desc_configuration_t const* desc_cfg = (tusb_desc_configuration_t const*) _usbip_desc;
+  uint16_t const total_len = (uint16_t) tu_min32(tu_le16toh(desc_cfg->wTotalLength), sizeof(_usbip_desc));
+
+  TU_ASSERT( control_xfer(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_CONFIGURATION << 8, total_len,
+                          _usbip_desc) == total_len );
+
+  // class triple of each interface (default alternate)
+  _usbip.itf_count = 0;
+
+  uint8_t const* p_desc   = _usbip_desc;
+  uint8_t const* desc_end = _usbip_desc + total_len;
+
+  while ( (p_desc < desc_end) && tu_desc_len(p_desc) && (_usbip.itf_count < USBIP_ITF_MAX) )
+  {
+    tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+
+    if ( (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE) && (desc_itf->bAlternateSetting == 0) )
+    {
+      uint8_t* itf_class = _usbip.itf_class[_usbip.itf_count++];
+      itf_class[0] = desc_itf->bInterfaceClass;
+      itf_class[1] = desc_itf->bInterfaceSubClass;
+      itf_class[2] = desc_itf->bInterfaceProtocol;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return true;
+}
+
+static void device_info(usbip_usb_device_t* info)
+{
+  // Linux usb_device_speed
+  uint32_t const speed = (_usbip.speed == TUSB_SPEED_LOW) ? 1 : (_usbip.speed == TUSB_SPEED_HIGH) ? 3 : 2;
+
+  tu_memclr(info, sizeof(usbip_usb_device_t));
+
+  strncpy(info->path, "/sys/devices/platform/tinyusb-sim/usb1/" USBIP_SIM_BUSID, sizeof(info->path) - 1);
+  strncpy(info->busid, USBIP_SIM_BUSID, sizeof(info->busid) - 1);
+
+  info->busnum              = htonl(1);
+  info->devnum              = htonl(USBIP_DEV_ADDR);
+  info->speed               = htonl(speed);
+  info->idVendor            = htons(tu_le16toh(_usbip.desc_device.idVendor));
+  info->idProduct           = htons(tu_le16toh(_usbip.desc_device.idProduct));
+  info->bcdDevice           = htons(tu_le16toh(_usbip.desc_device.bcdDevice));
+  info->bDeviceClass        = _usbip.desc_device.bDeviceClass;
+  info->bDeviceSubClass     = _usbip.desc_device.bDeviceSubClass;
+  info->bDeviceProtocol     = _usbip.desc_device.bDeviceProtocol;
+  info->bConfigurationValue = 0; // client selects configuration
+  info->bNumConfigurations  = _usbip.desc_device.bNumConfigurations;
+  info->bNumInterfaces      = _usbip.itf_count;
+}
+
+//--------------------------------------------------------------------+
+// Operations (before import)
+//--------------------------------------------------------------------+
+
+static bool op_reply(uint16_t code, uint32_t status)
+{
+  usbip_op_header_t const hdr =
+  {
+    .version = htons(USBIP_VERSION),
+    .code    = htons(code),
+    .status  = htonl(status)
+  };
+
+  return sock_send(&hdr, sizeof(hdr));
+}
+
+// return false to close connection
+static bool op_process(void)
+{
+  usbip_op_header_t hdr;
+  TU_VERIFY( sock_recv(&hdr, sizeof(hdr)) );
+
+  switch ( ntohs(hdr.code) )
+  {
+    case OP_REQ_DEVLIST:
+    {
+      bool const attached = device_attach();
+      uint32_t const ndev = htonl(attached ? 1 : 0);
+
+      TU_VERIFY( op_reply(OP_REP_DEVLIST, 0) && sock_send(&ndev, sizeof(ndev)) );
+
+      if ( attached )
+      {
+        usbip_usb_device_t info;
+        device_info(&info);
+        TU_VERIFY( sock_send(&info, sizeof(info)) );
+
+        for(uint8_t i = 0; i < _usbip.itf_count; i++)
+        {
+          uint8_t const itf[4] = { _usbip.itf_class[i][0], _usbip.itf_class[i][1], _usbip.itf_class[i][2], 0 };
+          TU_VERIFY( sock_send(itf, sizeof(itf)) );
+        }
+      }
+
+      // client disconnects after listing
+      return false;
+    }
+
+    case OP_REQ_IMPORT:
+    {
+      char busid[32];
+      TU_VERIFY( sock_recv(busid, sizeof(busid)) );
+
+      bool const found = (strncmp(busid, USBIP_SIM_BUSID, sizeof(busid)) == 0) && device_attach();
+      TU_VERIFY( op_reply(OP_REP_IMPORT, found ? 0 : 1) );
+      TU_VERIFY( found );
+
+      usbip_usb_device_t info;
+      device_info(&info);
+      TU_VERIFY( sock_send(&info, sizeof(info)) );
+
+      _usbip.imported = true;
+      return true;
+    }
+
+    default: return false;
+  }
+}
+
+//--------------------------------------------------------------------+
+// URB
+//--------------------------------------------------------------------+
+
+static usbip_urb_t* urb_alloc(void)
+{
+  for(uint8_t i = 0; i < USBIP_SIM_URB_MAX; i++)
+  {
+    usbip_urb_t* urb = &_usbip_urb[i];
+    if ( !urb->active )
+    {
+      urb->active = true;
+      _usbip.urb_count++;
+      return urb;
+    }
+  }
+
+  return NULL;
+}
+
+static void urb_free(usbip_urb_t* urb)
+{
+  urb->active = false;
+  _usbip.urb_count--;
+}
+
+// errno reported to client for dcd_sim result
+static int32_t urb_status(int32_t rc)
+{
+  switch ( rc )
+  {
+    case DCD_SIM_STALL: return -EPIPE;
+    case DCD_SIM_NAK  : return -ETIMEDOUT;
+    case DCD_SIM_ERROR: return -ENODEV;
+    default           : return 0;
+  }
+}
+
+static bool ret_submit_send(uint32_t seqnum, int32_t status, uint32_t actual_len, uint32_t start_frame,
+                            uint16_t iso_count, uint32_t error_count)
+{
+  usbip_header_t ret;
+  tu_memclr(&ret, sizeof(ret));
+
+  ret.command                      = htonl(USBIP_RET_SUBMIT);
+  ret.seqnum                       = htonl(seqnum);
+  ret.ret_submit.status            = htonl((uint32_t) status);
+  ret.ret_submit.actual_length     = htonl(actual_len);
+  ret.ret_submit.start_frame       = htonl(start_frame);
+  ret.ret_submit.number_of_packets = htonl(iso_count);
+  ret.ret_submit.error_count       = htonl(error_count);
+
+  return sock_send(&ret, sizeof(ret));
+}
+
+// Send RET_SUBMIT with IN data and release URB
+static bool urb_complete(usbip_urb_t* urb, int32_t status)
+{
+  bool const dir_in = (tu_edpt_dir(urb->ep_addr) == TUSB_DIR_IN);
+  uint32_t actual_len = urb->actual;
+
+  if ( urb->iso_count )
+  {
+    actual_len = 0;
+    for(uint16_t i = 0; i < urb->iso_count; i++) actual_len += urb->iso[i].actual_length;
+  }
+
+  bool ok = ret_submit_send(urb->seqnum, status, actual_len, urb->start_frame, urb->iso_count, urb->error_count);
+
+  if ( dir_in && !urb->iso_count )
+  {
+    ok = ok && sock_send(urb->buffer, actual_len);
+  }
+
+  // isochronous IN data is sent back to back without the gaps between packets
+  for(uint16_t i = 0; i < urb->iso_count; i++)
+  {
+    usbip_iso_desc_t* iso = &urb->iso[i];
+
+    if ( dir_in ) ok = ok && sock_send(urb->buffer + iso->offset, iso->actual_length);
+  }
+
+  for(uint16_t i = 0; i < urb->iso_count; i++)
+  {
+    usbip_iso_desc_t const iso =
+    {
+      .offset        = htonl(urb->iso[i].offset),
+      .length        = htonl(urb->iso[i].length),
+      .actual_length = htonl(urb->iso[i].actual_length),
+      .status        = htonl(urb->iso[i].status)
+    };
+
+    ok = ok && sock_send(&iso, sizeof(iso));
+  }
+
+  urb_free(urb);
+
+  return ok;
+}
+
+// Move URB data through its endpoint, return true when URB is complete with status
+static bool urb_service(usbip_urb_t* urb, int32_t* status)
+{
+  uint8_t const rhport = _usbip.rhport;
+  uint8_t const ep_addr = urb->ep_addr;
+  uint16_t const mps = dcd_sim_edpt_size(rhport, ep_addr);
+  bool const dir_in = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN);
+  int32_t rc;
+
+  *status = 0;
+
+  // isochronous: one packet per call, there is no handshake so packet is lost if device is not ready
+  if ( urb->iso_count )
+  {
+    usbip_iso_desc_t* iso = &urb->iso[urb->iso_next];
+    uint8_t* buf = urb->buffer + iso->offset;
+
+    rc = dir_in ? dcd_sim_in (rhport, ep_addr, buf, (uint16_t) iso->length) :
+                  dcd_sim_out(rhport, ep_addr, buf, (uint16_t) iso->length);
+
+    iso->actual_length = (rc > 0) ? (uint32_t) rc : 0;
+    iso->status        = (uint32_t) urb_status( (rc == DCD_SIM_NAK) ? 0 : rc );
+    if ( iso->status ) urb->error_count++;
+
+    return ++urb->iso_next == urb->iso_count;
+  }
+
+  if ( dir_in )
+  {
+    while ( urb->actual < urb->length )
+    {
+      rc = dcd_sim_in(rhport, ep_addr, urb->buffer + urb->actual, (uint16_t) (urb->length - urb->actual));
+      if ( rc == DCD_SIM_NAK ) return false;
+
+      *status = urb_status(rc);
+      if ( rc < 0 ) return true;
+
+      urb->actual += (uint32_t) rc;
+
+      // short packet
+      if ( (rc == 0) || (rc % mps) ) return true;
+    }
+  }
+  else
+  {
+    while ( urb->actual < urb->length )
+    {
+      rc = dcd_sim_out(rhport, ep_addr, urb->buffer + urb->actual, (uint16_t) (urb->length - urb->actual));
+      if ( rc == DCD_SIM_NAK ) return false;
+
+      *status = urb_status(rc);
+      if ( rc < 0 ) return true;
+
+      urb->actual += (uint32_t) rc;
+    }
+
+    // zero length URB, or ZLP requested after full packets
+    if ( (urb->length == 0) || (urb->zlp && (urb->length % mps) == 0) )
+    {
+      rc = dcd_sim_out(rhport, ep_addr, NULL, 0);
+      if ( rc == DCD_SIM_NAK ) return false;
+
+      *status = urb_status(rc);
+    }
+  }
+
+  return true;
+}
+
+// Service oldest URB of each endpoint
+static bool urb_service_all(void)
+{
+  usbip_urb_t* head[16][2] = { { NULL } };
+
+  for(uint8_t i = 0; i < USBIP_SIM_URB_MAX; i++)
+  {
+    usbip_urb_t* urb = &_usbip_urb[i];
+    if ( !urb->active ) continue;
+
+    usbip_urb_t** p_head = &head[tu_edpt_number(urb->ep_addr)][tu_edpt_dir(urb->ep_addr)];
+    if ( !(*p_head) || ((int32_t) (urb->stamp - (*p_head)->stamp) < 0) ) *p_head = urb;
+  }
+
+  for(uint8_t epnum = 1; epnum < 16; epnum++)
+  {
+    for(uint8_t dir = 0; dir < 2; dir++)
+    {
+      usbip_urb_t* urb = head[epnum][dir];
+      int32_t status;
+
+      if ( urb && urb_service(urb, &status) ) TU_VERIFY( urb_complete(urb, status) );
+    }
+  }
+
+  return true;
+}
+
+static bool cmd_submit(usbip_header_t const* hdr)
+{
+  uint32_t const seqnum    = ntohl(hdr->seqnum);
+  uint8_t  const epnum     = (uint8_t) (ntohl(hdr->ep) & 0x0f);
+  bool     const dir_in    = (ntohl(hdr->direction) == USBIP_DIR_IN);
+  uint32_t const length    = ntohl(hdr->cmd_submit.transfer_buffer_length);
+  int32_t  const npackets  = (int32_t) ntohl(hdr->cmd_submit.number_of_packets);
+  uint32_t const iso_count = (npackets > 0) ? (uint32_t) npackets : 0;
+
+  size_t const payload_len = (dir_in ? 0 : length) + iso_count * sizeof(usbip_iso_desc_t);
+
+  usbip_urb_t* urb = urb_alloc();
+
+  if ( !urb || (length > USBIP_SIM_URB_BUFSIZE) || (iso_count > USBIP_SIM_ISO_MAX) )
+  {
+    if ( urb ) urb_free(urb);
+    TU_VERIFY( sock_discard(payload_len) );
+    return ret_submit_send(seqnum, urb ? -EOVERFLOW : -ENOMEM, 0, 0, 0, 0);
+  }
+
+  urb->seqnum      = seqnum;
+  urb->stamp       = _usbip.stamp++;
+  urb->ep_addr     = (uint8_t) (epnum | (dir_in ? TUSB_DIR_IN_MASK : 0));
+  urb->zlp         = !dir_in && (ntohl(hdr->cmd_submit.transfer_flags) & URB_ZERO_PACKET);
+  urb->length      = length;
+  urb->actual      = 0;
+  urb->start_frame = ntohl(hdr->cmd_submit.start_frame);
+  urb->iso_count   = (uint16_t) iso_count;
+  urb->iso_next    = 0;
+  urb->error_count = 0;
+
+  if ( !dir_in ) TU_VERIFY( sock_recv(urb->buffer, length) );
+
+  for(uint16_t i = 0; i < urb->iso_count; i++)
+  {
+    usbip_iso_desc_t* iso = &urb->iso[i];
+    TU_VERIFY( sock_recv(iso, sizeof(usbip_iso_desc_t)) );
+
+    iso->offset        = ntohl(iso->offset);
+    iso->length        = ntohl(iso->length);
+    iso->actual_length = 0;
+    iso->status        = 0;
+
+    // keep packet inside transfer buffer
+    if ( (iso->offset > length) || (iso->length > length - iso->offset) ) iso->length = 0;
+  }
+
+  // control transfer is run to completion with all its stages
+  if ( epnum == 0 )
+  {
+    tusb_control_request_t request;
+    memcpy(&request, hdr->cmd_submit.setup, sizeof(request));
+
+    if ( tu_le16toh(request.wLength) > length ) request.wLength = tu_htole16((uint16_t) length);
+
+    int32_t const rc = dcd_sim_control_xfer(_usbip.rhport, &request, urb->buffer, _usbip.pump);
+    urb->actual = (rc > 0) ? (uint32_t) rc : 0;
+
+    return urb_complete(urb, urb_status(rc));
+  }
+
+  return true;
+}
+
+static bool cmd_unlink(usbip_header_t const* hdr)
+{
+  uint32_t const unlink_seqnum = ntohl(hdr->cmd_unlink.unlink_seqnum);
+  int32_t status = 0; // URB already completed
+
+  for(uint8_t i = 0; i < USBIP_SIM_URB_MAX; i++)
+  {
+    usbip_urb_t* urb = &_usbip_urb[i];
+
+    if ( urb->active && (urb->seqnum == unlink_seqnum) )
+    {
+      urb_free(urb);
+      status = -ECONNRESET;
+      break;
+    }
+  }
+
+  usbip_header_t ret;
+  tu_memclr(&ret, sizeof(ret));
+
+  ret.command           = htonl(USBIP_RET_UNLINK);
+  ret.seqnum            = hdr->seqnum;
+  ret.ret_unlink.status = htonl((uint32_t) status);
+
+  return sock_send(&ret, sizeof(ret));
+}
+
+// return false to close connection
+static bool cmd_process(void)
+{
+  usbip_header_t hdr;
+  TU_VERIFY( sock_recv(&hdr, sizeof(hdr)) );
+
+  switch ( ntohl(hdr.command) )
+  {
+    case USBIP_CMD_SUBMIT: return cmd_submit(&hdr);
+    case USBIP_CMD_UNLINK: return cmd_unlink(&hdr);
+    default              : return false;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Public API
+//--------------------------------------------------------------------+
+
+bool usbip_sim_init(uint8_t rhport, tusb_speed_t speed, char const* bind_addr, uint16_t port, void (*pump)(void))
+{
+  usbip_sim_deinit();
+
+  _usbip.rhport = rhport;
+  _usbip.speed  = speed;
+  _usbip.pump   = pump;
+
+  struct sockaddr_in addr =
+  {
+    .sin_family = AF_INET,
+    .sin_port   = htons(port)
+  };
+  socklen_t addr_len = sizeof(addr);
+
+  TU_ASSERT( inet_pton(AF_INET, bind_addr ? bind_addr : "127.0.0.1", &addr.sin_addr) == 1 );
+
+  int const fd = socket(AF_INET, SOCK_STREAM, 0);
+  TU_ASSERT( fd >= 0 );
+
+  int const one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  if ( (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) || (listen(fd, 1) < 0) ||
+       (getsockname(fd, (struct sockaddr*) &addr, &addr_len) < 0) )
+  {
+    TU_LOG1("USBIP: listen on port %u failed: %s\r\n", port, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  _usbip.listen_fd = fd;
+  _usbip.port      = ntohs(addr.sin_port);
+
+  return true;
+}
+
+void usbip_sim_deinit(void)
+{
+  client_close();
+
+  if ( _usbip.listen_fd >= 0 ) close(_usbip.listen_fd);
+  _usbip.listen_fd = -1;
+}
+
+uint16_t usbip_sim_port(void)
+{
+  return _usbip.port;
+}
+
+bool usbip_sim_attached(void)
+{
+  return _usbip.imported;
+}
+
+void usbip_sim_task(uint32_t timeout_ms)
+{
+  if ( _usbip.listen_fd < 0 ) return;
+
+  int const timeout = (timeout_ms > INT32_MAX) ? -1 : (int) timeout_ms;
+
+  if ( _usbip.client_fd < 0 )
+  {
+    struct pollfd pfd = { .fd = _usbip.listen_fd, .events = POLLIN };
+    if ( poll(&pfd, 1, timeout) <= 0 ) return;
+
+    int const fd = accept(_usbip.listen_fd, NULL, NULL);
+    if ( fd < 0 ) return;
+
+    // URBs are small and latency bound
+    int const one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    _usbip.client_fd = fd;
+  }
+
+  bool ok = urb_service_all();
+
+  // Read commands while there is room for their URBs, leaving the rest in socket buffer
+  // as back pressure. Don't wait if URBs are outstanding: device side must run first.
+  struct pollfd pfd = { .fd = _usbip.client_fd, .events = POLLIN };
+  int wait = _usbip.urb_count ? 0 : timeout;
+
+  for(uint8_t n = 0; ok && (n < USBIP_SIM_URB_MAX) && (_usbip.urb_count < USBIP_SIM_URB_MAX); n++)
+  {
+    if ( poll(&pfd, 1, wait) <= 0 ) break;
+
+    ok   = _usbip.imported ? cmd_process() : op_process();
+    wait = 0;
+  }
+
+  if ( !ok ) client_close();
+}
+
+#endif
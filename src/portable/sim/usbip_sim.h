@@ -0,0 +1,88 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/** \ingroup group_dcd_sim
+ *  \defgroup group_usbip_sim USB/IP Server
+ *  Export the device stack running on the simulated controller over USB/IP, so that it can be
+ *  attached to a real host stack e.g. Linux vhci-hcd with 'usbip attach -r <host> -b 1-1'.
+ *  The server plays the host role of dcd_sim: each CMD_SUBMIT becomes SETUP/IN/OUT tokens,
+ *  several URBs can be outstanding per endpoint and are completed in order.
+ *  @{ */
+
+#ifndef _TUSB_USBIP_SIM_H_
+#define _TUSB_USBIP_SIM_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Bus ID of the exported device
+#define USBIP_SIM_BUSID           "1-1"
+
+// TCP port of usbipd
+#define USBIP_SIM_PORT_DEFAULT    3240
+
+// Outstanding URBs shared by all endpoints
+#ifndef USBIP_SIM_URB_MAX
+  #define USBIP_SIM_URB_MAX       32
+#endif
+
+// Largest transfer buffer of an URB, bigger submissions are completed with -EOVERFLOW
+#ifndef USBIP_SIM_URB_BUFSIZE
+  #define USBIP_SIM_URB_BUFSIZE   16384
+#endif
+
+// Largest number of packets of an isochronous URB
+#ifndef USBIP_SIM_ISO_MAX
+  #define USBIP_SIM_ISO_MAX       64
+#endif
+
+// Start listening on bind_addr (NULL for loopback only) and port (0 for any free port).
+// pump() lets the device side run during control transfers, NULL if tud_task() has its own thread
+bool usbip_sim_init(uint8_t rhport, tusb_speed_t speed, char const* bind_addr, uint16_t port, void (*pump)(void));
+
+// Close client connection and listening socket, outstanding URBs are dropped
+void usbip_sim_deinit(void);
+
+// Port the server is listening on
+uint16_t usbip_sim_port(void);
+
+// True if a client has imported the device
+bool usbip_sim_attached(void);
+
+// Accept a client, process its commands and complete URBs. Waits up to timeout_ms for client
+// activity, but not when URBs are outstanding since device side must run to complete them.
+void usbip_sim_task(uint32_t timeout_ms);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_USBIP_SIM_H_ */
+
+/// @}
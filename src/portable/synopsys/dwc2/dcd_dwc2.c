@@ -97,6 +97,8 @@ static uint16_t ep0_pending[2];                   // Index determines direction
 // TX FIFO RAM allocation so far in words - RX FIFO size is readily available from dwc2->grxfsiz
 static uint16_t _allocated_fifo_words_tx;         // TX FIFO size in words (IN EPs)
 static bool     _out_ep_closed;                   // Flag to check if RX FIFO size needs an update (reduce its size)
+static bool     _sof_en;                          // SOF interrupt requested by stack
+static volatile bool _sof_wakeup;                 // SOF interrupt enabled by remote wakeup to detect bus resume
 
 // Calculate the RX FIFO size according to recommendations from reference manual
 static inline uint16_t calc_rx_ff_size(uint16_t ep_size)
@@ -570,6 +572,7 @@ void dcd_remote_wakeup(uint8_t rhport)
   dwc2->dctl |= DCTL_RWUSIG;
 
   // enable SOF to detect bus resume
+  _sof_wakeup = true;
   dwc2->gintsts = GINTSTS_SOF;
   dwc2->gintmsk |= GINTMSK_SOFM;
 
@@ -579,6 +582,22 @@ void dcd_remote_wakeup(uint8_t rhport)
   dwc2->dctl &= ~DCTL_RWUSIG;
 }
 
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+  dwc2_regs_t * dwc2 = DWC2_REG(rhport);
+
+  _sof_en = en;
+
+  if (en)
+  {
+    dwc2->gintsts = GINTSTS_SOF;
+    dwc2->gintmsk |= GINTMSK_SOFM;
+  }else if ( !_sof_wakeup ) // otherwise SOF interrupt disables itself once bus resume is detected
+  {
+    dwc2->gintmsk &= ~GINTMSK_SOFM;
+  }
+}
+
 void dcd_connect(uint8_t rhport)
 {
   (void) rhport;
@@ -899,25 +918,7 @@ static void read_fifo_packet(uint8_t rhport, uint8_t * dst, uint16_t len)
   (void) rhport;
 
   dwc2_regs_t * dwc2 = DWC2_REG(rhport);
-  volatile const uint32_t * rx_fifo = dwc2->fifo[0];
-
-  // Reading full available 32 bit words from fifo
-  uint16_t full_words = len >> 2;
-  while(full_words--)
-  {
-    tu_unaligned_write32(dst, *rx_fifo);
-    dst += 4;
-  }
-
-  // Read the remaining 1-3 bytes from fifo
-  uint8_t const bytes_rem = len & 0x03;
-  if ( bytes_rem != 0 )
-  {
-    uint32_t const tmp = *rx_fifo;
-    dst[0] = tu_u32_byte0(tmp);
-    if ( bytes_rem > 1 ) dst[1] = tu_u32_byte1(tmp);
-    if ( bytes_rem > 2 ) dst[2] = tu_u32_byte2(tmp);
-  }
+  tu_hwfifo_read32(dwc2->fifo[0], dst, len);
 }
 
 // Write a single data packet to EPIN FIFO
@@ -926,26 +927,7 @@ static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const *
   (void) rhport;
 
   dwc2_regs_t * dwc2 = DWC2_REG(rhport);
-  volatile uint32_t * tx_fifo = dwc2->fifo[fifo_num];
-
-  // Pushing full available 32 bit words to fifo
-  uint16_t full_words = len >> 2;
-  while(full_words--)
-  {
-    *tx_fifo = tu_unaligned_read32(src);
-    src += 4;
-  }
-
-  // Write the remaining 1-3 bytes into fifo
-  uint8_t const bytes_rem = len & 0x03;
-  if ( bytes_rem )
-  {
-    uint32_t tmp_word = src[0];
-    if ( bytes_rem > 1 ) tmp_word |= (src[1] << 8);
-    if ( bytes_rem > 2 ) tmp_word |= (src[2] << 16);
-
-    *tx_fifo = tmp_word;
-  }
+  tu_hwfifo_write32(dwc2->fifo[fifo_num], src, len);
 }
 
 static void handle_rxflvl_irq(uint8_t rhport)
@@ -1256,8 +1238,9 @@ void dcd_int_handler(uint8_t rhport)
   {
     dwc2->gotgint = GINTSTS_SOF;
 
-    // Disable SOF interrupt since currently only used for remote wakeup detection
-    dwc2->gintmsk &= ~GINTMSK_SOFM;
+    // Disable SOF interrupt if only enabled for remote wakeup detection
+    _sof_wakeup = false;
+    if ( !_sof_en ) dwc2->gintmsk &= ~GINTMSK_SOFM;
 
     dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
   }
@@ -63,6 +63,23 @@ bool tusb_inited(void)
   return ret;
 }
 
+//--------------------------------------------------------------------+
+// Trace
+//--------------------------------------------------------------------+
+#if CFG_TUSB_TRACE
+
+// initialized statically so that a dump taken at any time can be decoded
+tusb_trace_t _tusb_trace =
+{
+  .magic    = TUSB_TRACE_MAGIC,
+  .version  = TUSB_TRACE_VERSION,
+  .rec_size = sizeof(tusb_trace_rec_t),
+  .depth    = CFG_TUSB_TRACE_DEPTH,
+  .wr_idx   = 0
+};
+
+#endif
+
 //--------------------------------------------------------------------+
 // Internal Helper for both Host and Device stack
 //--------------------------------------------------------------------+
@@ -240,6 +257,126 @@ void tu_print_mem(void const *buf, uint32_t count, uint8_t indent)
   dump_str_line(buf8-nback, nback);
 }
 
+//--------------------------------------------------------------------+
+// Deferred Log
+//--------------------------------------------------------------------+
+#if CFG_TUSB_DEBUG_DEFERRED
+
+#if !defined(__GNUC__)
+  #error "CFG_TUSB_DEBUG_DEFERRED requires GCC compatible __atomic builtins"
+#endif
+
+// log_claim() uses 32 bit compare-and-swap, a library call that is not interrupt safe on cores
+// without exclusive access (e.g ARMv6-M)
+#if !defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4)
+  #error "CFG_TUSB_DEBUG_DEFERRED requires lock-free 32 bit atomics, not available on this target (e.g ARMv6-M)"
+#endif
+
+TU_VERIFY_STATIC((CFG_TUSB_DEBUG_DEFERRED_DEPTH & (CFG_TUSB_DEBUG_DEFERRED_DEPTH-1)) == 0,
+                 "CFG_TUSB_DEBUG_DEFERRED_DEPTH must be a power of two");
+
+#define LOG_IDX_MASK    (CFG_TUSB_DEBUG_DEFERRED_DEPTH-1)
+
+char const tu_log_fmt_base[] TU_ATTR_SECTION(.tu_log_fmt) = "";
+
+// initialized statically so that a dump taken at any time can be decoded
+tu_log_ring_t _tu_log =
+{
+  .magic   = TU_LOG_MAGIC,
+  .version = TU_LOG_VERSION,
+  .depth   = CFG_TUSB_DEBUG_DEFERRED_DEPTH,
+};
+
+// Claim count words for a record. Free space is checked against the reader's index
+// so that unread records are never overwritten, a record not fitting is dropped.
+static bool log_claim(uint32_t count, uint32_t* idx)
+{
+  uint32_t wr = __atomic_load_n(&_tu_log.wr_idx, __ATOMIC_RELAXED);
+
+  do
+  {
+    // acquire: words released by reader are cleared before we write them
+    uint32_t const rd = __atomic_load_n(&_tu_log.rd_idx, __ATOMIC_ACQUIRE);
+    if ( (wr - rd) + count > CFG_TUSB_DEBUG_DEFERRED_DEPTH )
+    {
+      __atomic_fetch_add(&_tu_log.dropped, 1, __ATOMIC_RELAXED);
+      return false;
+    }
+  } while ( !__atomic_compare_exchange_n(&_tu_log.wr_idx, &wr, wr + count, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) );
+
+  *idx = wr;
+  return true;
+}
+
+// Header is written last, reader stops at a claimed record until its header shows up
+static inline void log_publish(uint32_t idx, uint32_t header)
+{
+  __atomic_store_n(&_tu_log.buf[idx & LOG_IDX_MASK], TU_LOG_REC_MARK | header, __ATOMIC_RELEASE);
+}
+
+void tu_log_push(char const* fmt, uint8_t nargs, uint32_t const* args)
+{
+  uint32_t idx;
+  if ( !log_claim(2u + nargs, &idx) ) return;
+
+  _tu_log.buf[(idx+1) & LOG_IDX_MASK] = (uint32_t) ((uintptr_t) fmt - (uintptr_t) tu_log_fmt_base);
+  for(uint8_t i=0; i<nargs; i++) _tu_log.buf[(idx+2+i) & LOG_IDX_MASK] = args[i];
+
+  log_publish(idx, ((uint32_t) TU_LOG_REC_PRINTF << 16) | nargs);
+}
+
+void tu_log_push_mem(uint8_t type, void const* buf, uint32_t count)
+{
+  uint8_t const* buf8 = (uint8_t const*) buf;
+  uint32_t const len  = buf ? tu_min32(count, TU_LOG_MEM_MAX) : 0;
+
+  uint32_t idx;
+  if ( !log_claim(2u + (len+3)/4, &idx) ) return;
+
+  _tu_log.buf[(idx+1) & LOG_IDX_MASK] = count;
+  for(uint32_t i=0; i<len; i+=4)
+  {
+    uint32_t word = 0;
+    memcpy(&word, buf8+i, tu_min32(4, len-i));
+    _tu_log.buf[(idx+2+i/4) & LOG_IDX_MASK] = word;
+  }
+
+  log_publish(idx, ((uint32_t) type << 16) | len);
+}
+
+uint32_t tu_log_read(void* buffer, uint32_t bufsize)
+{
+  uint8_t* buf8  = (uint8_t*) buffer;
+  uint32_t total = 0;
+  uint32_t rd    = _tu_log.rd_idx;
+
+  while ( rd != __atomic_load_n(&_tu_log.wr_idx, __ATOMIC_ACQUIRE) )
+  {
+    uint32_t const header = __atomic_load_n(&_tu_log.buf[rd & LOG_IDX_MASK], __ATOMIC_ACQUIRE);
+    if ( (header & TU_LOG_REC_MARK_MASK) != TU_LOG_REC_MARK ) break;
+
+    uint32_t const count = header & 0xffffu;
+    uint32_t const words = 2u + ((((header >> 16) & 0xffu) == TU_LOG_REC_PRINTF) ? count : (count+3)/4);
+    if ( total + 4*words > bufsize ) break;
+
+    // clear consumed words so that a stale header is never taken for a record being written
+    for(uint32_t i=0; i<words; i++)
+    {
+      uint32_t* word = &_tu_log.buf[(rd+i) & LOG_IDX_MASK];
+      memcpy(buf8 + total, word, 4);
+      total += 4;
+      *word = 0;
+    }
+
+    rd += words;
+    __atomic_store_n(&_tu_log.rd_idx, rd, __ATOMIC_RELEASE);
+  }
+
+  return total;
+}
+
+#endif
+
 #endif
 
 #endif // host or device enabled
@@ -145,6 +145,9 @@
 #define OPT_MCU_FT90X            2000 ///< BridgeTek FT90x
 #define OPT_MCU_FT93X            2001 ///< BridgeTek FT93x
 
+// Simulation
+#define OPT_MCU_SIM              2100 ///< In-process controller on a PC, see portable/sim
+
 // Helper to check if configured MCU is one of listed
 // Apply _TU_CHECK_MCU with || as separator to list of input
 #define _TU_CHECK_MCU(_m)   (CFG_TUSB_MCU == _m)
@@ -222,6 +225,17 @@
   #define CFG_TUSB_DEBUG 0
 #endif
 
+// Log messages of CFG_TUSB_DEBUG in binary form to a ring of CFG_TUSB_DEBUG_DEFERRED_DEPTH words instead
+// of printf(), text is reconstructed on the host. See common/tusb_log.h and tools/log_decode.py.
+// Requires lock-free 32 bit atomics, not available on ARMv6-M
+#ifndef CFG_TUSB_DEBUG_DEFERRED
+  #define CFG_TUSB_DEBUG_DEFERRED 0
+#endif
+
+#ifndef CFG_TUSB_DEBUG_DEFERRED_DEPTH
+  #define CFG_TUSB_DEBUG_DEFERRED_DEPTH 1024
+#endif
+
 // place data in accessible RAM for usb controller
 #ifndef CFG_TUSB_MEM_SECTION
   #define CFG_TUSB_MEM_SECTION
@@ -241,6 +255,49 @@
   #define CFG_TUSB_OS_INC_PATH
 #endif
 
+// Only power-of-two FIFO depths are used: tu_fifo index arithmetic is compiled down
+// to plain masking and tu_fifo_config() rejects any other depth, class drivers assert on it
+#ifndef CFG_TUSB_FIFO_POW2_ONLY
+  #define CFG_TUSB_FIFO_POW2_ONLY 0
+#endif
+
+// Every tu_fifo has at most one writer and one reader context: no OSAL mutex is used, write and
+// read side synchronize lock-free on the indices with acquire/release ordering
+#ifndef CFG_TUSB_FIFO_SPSC
+  #define CFG_TUSB_FIFO_SPSC      0
+#endif
+
+// Provide tu_fifo_config_mpsc(): a FIFO configured with it may have several writer contexts (tasks
+// and ISRs) and one reader context. Its writers claim space with compare-and-swap on the write index
+// and never take an OSAL mutex, all other FIFOs are unaffected. Requires lock-free 32 bit atomics,
+// not available on ARMv6-M
+#ifndef CFG_TUSB_FIFO_MPSC
+  #define CFG_TUSB_FIFO_MPSC      0
+#endif
+
+// Use 32 bit tu_fifo indices and counts, lifting the maximum depth from 2^15 to 2^31 items
+// at the cost of a larger tu_fifo_t
+#ifndef CFG_TUSB_FIFO_WIDE_INDEX
+  #define CFG_TUSB_FIFO_WIDE_INDEX 0
+#endif
+
+// Keep per FIFO statistics (high-water mark, overflows, underruns, bytes through), see
+// tu_fifo_get_stats(). Useful to size class buffers from field data.
+#ifndef CFG_TUSB_FIFO_STATS
+  #define CFG_TUSB_FIFO_STATS     0
+#endif
+
+// Record stack events (DCD/HCD events, queue operations, transfers and class callbacks) into a binary
+// ring of CFG_TUSB_TRACE_DEPTH records, see common/tusb_trace.h and tools/trace_decode.py.
+// Requires lock-free 32 bit atomics, not available on ARMv6-M
+#ifndef CFG_TUSB_TRACE
+  #define CFG_TUSB_TRACE          0
+#endif
+
+#ifndef CFG_TUSB_TRACE_DEPTH
+  #define CFG_TUSB_TRACE_DEPTH    256
+#endif
+
 //--------------------------------------------------------------------
 // DEVICE OPTIONS
 //--------------------------------------------------------------------
@@ -249,6 +306,61 @@
   #define CFG_TUD_ENDPOINT0_SIZE  64
 #endif
 
+// Transfer control data stage with a single dcd_edpt_xfer() directly from/to the buffer passed to
+// tud_control_xfer() instead of packet by packet through an endpoint0 sized bounce buffer.
+// Only enable if the port can do multi-packet transfers on endpoint0 and its DMA can access any memory
+// control buffers live in (including descriptors in flash). Buffers not aligned to
+// CFG_TUD_CONTROL_ZERO_COPY_ALIGN still go through the bounce buffer.
+#ifndef CFG_TUD_CONTROL_ZERO_COPY
+  #define CFG_TUD_CONTROL_ZERO_COPY   0
+#endif
+
+#ifndef CFG_TUD_CONTROL_ZERO_COPY_ALIGN
+  #define CFG_TUD_CONTROL_ZERO_COPY_ALIGN 4
+#endif
+
+// Number of transfers that can be queued per endpoint with usbd_edpt_xfer_queue() on top of the
+// one in flight. The next queued transfer is armed from the transfer complete interrupt, therefore
+// the port's dcd_edpt_xfer() must be callable from its own ISR. 0 disables the queue.
+#ifndef CFG_TUD_EDPT_QUEUE_SZ
+  #define CFG_TUD_EDPT_QUEUE_SZ   0
+#endif
+
+// Let usbd_edpt_xfer() and usbd_edpt_xfer_fifo() take transfers larger than the 16-bit length of
+// dcd_edpt_xfer(). They are split in chunks of whole packets and the next chunk is submitted from the
+// transfer complete interrupt, like the endpoint queue. Costs 16 bytes of RAM per endpoint direction,
+// larger transfers are refused when disabled.
+#ifndef CFG_TUD_EDPT_XFER_CHUNK
+  #define CFG_TUD_EDPT_XFER_CHUNK 0
+#endif
+
+// Allow class drivers to register a per endpoint completion hook with usbd_edpt_isr_cb_set()
+// that is invoked directly from the DCD interrupt instead of going through tud_task()
+#ifndef CFG_TUD_EDPT_ISR_CB
+  #define CFG_TUD_EDPT_ISR_CB     0
+#endif
+
+// Measure per endpoint latency from transfer completion interrupt to xfer_cb() or ISR hook,
+// see tud_edpt_latency_get(). Timestamps come from application's tud_latency_timestamp_cb().
+#ifndef CFG_TUD_EDPT_LATENCY
+  #define CFG_TUD_EDPT_LATENCY    0
+#endif
+
+// Cache interface/endpoint to driver binding of the last SET_CONFIGURATION. When the host sets the same
+// configuration descriptor again (e.g after bus reset), only the bound drivers are opened instead of
+// probing all of them for each interface. Descriptors whose content changes at the same address are
+// detected as long as the bound drivers then claim a different length.
+#ifndef CFG_TUD_BIND_CACHE
+  #define CFG_TUD_BIND_CACHE      0
+#endif
+
+// Dispatch open(), reset() and xfer_cb() of built-in class drivers with a switch over the enabled classes
+// instead of function pointers, so that the compiler can inline them into the device task.
+// Application drivers from usbd_app_driver_get_cb() still go through their table.
+#ifndef CFG_TUD_DRIVER_STATIC_DISPATCH
+  #define CFG_TUD_DRIVER_STATIC_DISPATCH 0
+#endif
+
 #ifndef CFG_TUD_CDC
   #define CFG_TUD_CDC             0
 #endif
@@ -0,0 +1,92 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Audio class interleave kernels: encoding of the support FIFO contents into one
+// interleaved isochronous packet and decoding back, for all supported sample
+// widths. The driver source is included to reach its static helpers.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "class/audio/audio_device.c"
+
+#define AUDIO_PACKET_SIZE   384   // 48 samples of 4 channels x 2 bytes at 48 kHz, divides 1..4 byte samples
+
+typedef struct
+{
+  uint8_t n_bytes;    // bytes copied per sample slot
+  uint8_t n_ff;       // number of support FIFOs interleaved
+  bool    encode;
+} audio_case_t;
+
+static uint8_t ff_data[4][AUDIO_PACKET_SIZE];
+static uint8_t packet[AUDIO_PACKET_SIZE];
+
+static void audio_op(void* arg, uint32_t count)
+{
+  audio_case_t const* ac = (audio_case_t const*) arg;
+  uint16_t const ff_len = AUDIO_PACKET_SIZE / ac->n_ff;
+
+  while (count--)
+  {
+    for(uint8_t i=0; i<ac->n_ff; i++)
+    {
+      if (ac->encode)
+      {
+        audiod_interleaved_copy_bytes_fast_encode(ac->n_bytes, ff_data[i], ff_data[i] + ff_len, packet + i*ac->n_bytes, ac->n_ff);
+      }
+      else
+      {
+        audiod_interleaved_copy_bytes_fast_decode(ac->n_bytes, ff_data[i], ff_data[i] + ff_len, packet + i*ac->n_bytes, ac->n_ff);
+      }
+    }
+  }
+
+  bench_sink(packet[0] + ff_data[0][0]);
+}
+
+void audio_bench(void)
+{
+  static const uint8_t n_ffs[] = { 1, 2, 4 };
+
+  for(size_t i=0; i<sizeof(ff_data); i++) ((uint8_t*) ff_data)[i] = (uint8_t) i;
+
+  for(uint8_t encode=0; encode<2; encode++)
+  {
+    for(uint8_t n_bytes=1; n_bytes<=4; n_bytes++)
+    {
+      for(size_t f=0; f<TU_ARRAY_SIZE(n_ffs); f++)
+      {
+        audio_case_t ac = { .n_bytes = n_bytes, .n_ff = n_ffs[f], .encode = encode };
+        char name[64];
+
+        snprintf(name, sizeof(name), "%s/b%u/ff%u", encode ? "encode" : "decode", n_bytes, ac.n_ff);
+        bench_run("audio", name, AUDIO_PACKET_SIZE, audio_op, &ac);
+      }
+    }
+  }
+}
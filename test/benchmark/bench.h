@@ -0,0 +1,52 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// One benchmark operation, run count times back to back
+typedef void (*bench_op_t)(void* arg, uint32_t count);
+
+// Time op and report ns/byte and ops/s for it under suite/name. Each op processes
+// bytes_per_op bytes. The number of repetitions is calibrated automatically and the
+// best of several runs is reported to filter out scheduler noise.
+void bench_run(char const* suite, char const* name, uint32_t bytes_per_op, bench_op_t op, void* arg);
+
+// Keep a value alive so the compiler does not optimize the benchmarked code away
+void bench_sink(uint32_t value);
+
+// Suites
+void fifo_bench(void);
+void hwfifo_bench(void);
+void audio_bench(void);
+void midi_bench(void);
+void hid_bench(void);
+void usbd_bench(void);
+
+#endif /* _BENCH_H_ */
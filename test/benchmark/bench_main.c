@@ -0,0 +1,141 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Host micro-benchmark runner for the common layer and class encoders/decoders.
+//
+//   tusb_bench [-c] [suite ...]
+//
+// Runs all suites, or only the given ones. Results are printed as a table, or with
+// -c as CSV (suite,case,bytes_per_op,ns_per_op,ns_per_byte,ops_per_s) for scripts
+// comparing runs.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+#define BENCH_REPEAT      5         // best of n runs is reported
+#define BENCH_MIN_NS      10000000  // minimum duration of one run
+
+static bool _csv = false;
+static volatile uint32_t _sink;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void bench_sink(uint32_t value)
+{
+  _sink += value;
+}
+
+static uint64_t run_once(bench_op_t op, void* arg, uint32_t count)
+{
+  uint64_t const start = now_ns();
+  op(arg, count);
+  return now_ns() - start;
+}
+
+void bench_run(char const* suite, char const* name, uint32_t bytes_per_op, bench_op_t op, void* arg)
+{
+  // calibrate number of ops per run
+  uint32_t count = 1;
+  while ( (run_once(op, arg, count) < BENCH_MIN_NS) && (count < (UINT32_MAX >> 1)) ) count <<= 1;
+
+  uint64_t best = UINT64_MAX;
+  for(uint8_t i=0; i<BENCH_REPEAT; i++)
+  {
+    uint64_t const ns = run_once(op, arg, count);
+    if (ns < best) best = ns;
+  }
+
+  double const ns_per_op   = (double) best / count;
+  double const ns_per_byte = bytes_per_op ? ns_per_op / bytes_per_op : 0;
+  double const ops_per_s   = 1e9 / ns_per_op;
+
+  if (_csv)
+  {
+    printf("%s,%s,%lu,%.3f,%.4f,%.0f\n", suite, name, (unsigned long) bytes_per_op, ns_per_op, ns_per_byte, ops_per_s);
+  }
+  else
+  {
+    printf("%-8s %-36s %8lu %12.3f %12.4f %14.0f\n", suite, name, (unsigned long) bytes_per_op, ns_per_op, ns_per_byte, ops_per_s);
+  }
+}
+
+typedef struct
+{
+  char const* name;
+  void (*func)(void);
+} bench_suite_t;
+
+static bench_suite_t const _suites[] =
+{
+#ifdef BENCH_USBD
+  // separate binary linking the real device stack instead of bench_stubs.c
+  { "usbd"  , usbd_bench   },
+#else
+  { "fifo"  , fifo_bench   },
+  { "hwfifo", hwfifo_bench },
+  { "audio" , audio_bench  },
+  { "midi"  , midi_bench   },
+  { "hid"   , hid_bench    },
+#endif
+};
+
+static bool suite_selected(char const* name, int argc, char* argv[])
+{
+  bool any = false;
+  for(int i=1; i<argc; i++)
+  {
+    if (argv[i][0] == '-') continue;
+    any = true;
+    if ( 0 == strcmp(argv[i], name) ) return true;
+  }
+  return !any;
+}
+
+int main(int argc, char* argv[])
+{
+  for(int i=1; i<argc; i++)
+  {
+    if ( 0 == strcmp(argv[i], "-c") ) _csv = true;
+  }
+
+  if (_csv) printf("suite,case,bytes_per_op,ns_per_op,ns_per_byte,ops_per_s\n");
+  else      printf("%-8s %-36s %8s %12s %12s %14s\n", "suite", "case", "bytes", "ns/op", "ns/byte", "ops/s");
+
+  for(size_t i=0; i<sizeof(_suites)/sizeof(_suites[0]); i++)
+  {
+    if ( suite_selected(_suites[i].name, argc, argv) ) _suites[i].func();
+  }
+
+  return 0;
+}
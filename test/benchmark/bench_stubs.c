@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Stand-ins for the device and host stack functions used by the class drivers built
+// into the benchmark. Transfers are accepted and dropped, endpoints are never busy.
+
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "host/usbh_classdriver.h"
+
+//--------------------------------------------------------------------+
+// Device
+//--------------------------------------------------------------------+
+static void* _ep_ctx[16][2];
+
+bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep)
+{
+  return usbd_edpt_open_ctx(rhport, desc_ep, NULL);
+}
+
+bool usbd_edpt_open_ctx(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep, void* ctx)
+{
+  (void) rhport;
+  _ep_ctx[tu_edpt_number(desc_ep->bEndpointAddress)][tu_edpt_dir(desc_ep->bEndpointAddress)] = ctx;
+  return true;
+}
+
+void* usbd_edpt_ctx(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport;
+  return _ep_ctx[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes)
+{
+  (void) rhport; (void) ep_addr; (void) buffer; (void) total_bytes;
+  return true;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+  return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+  return true;
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+  return false;
+}
+
+void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+}
+
+bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len)
+{
+  (void) rhport; (void) request; (void) buffer; (void) len;
+  return true;
+}
+
+bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request)
+{
+  (void) rhport; (void) request;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+static uint8_t _enum_buf[CFG_TUH_ENUMERATION_BUFSIZE];
+
+uint8_t* usbh_get_enum_buf(void)
+{
+  return _enum_buf;
+}
+
+void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num)
+{
+  (void) dev_addr; (void) itf_num;
+}
+
+bool usbh_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const * desc_ep)
+{
+  (void) rhport; (void) dev_addr; (void) desc_ep;
+  return true;
+}
+
+bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+{
+  (void) dev_addr; (void) ep_addr; (void) buffer; (void) total_bytes;
+  return true;
+}
+
+bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr)
+{
+  (void) dev_addr; (void) ep_addr;
+  return true;
+}
+
+bool tuh_control_xfer (uint8_t dev_addr, tusb_control_request_t const* request, void* buffer, tuh_control_complete_cb_t complete_cb)
+{
+  (void) dev_addr; (void) request; (void) buffer; (void) complete_cb;
+  return true;
+}
+
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report_desc, uint16_t desc_len)
+{
+  (void) dev_addr; (void) instance; (void) report_desc; (void) desc_len;
+}
+
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  (void) dev_addr; (void) instance; (void) report; (void) len;
+}
@@ -0,0 +1,164 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// tu_fifo throughput for different depths, item sizes and chunk sizes. A chunk is
+// written and read back per op, so with a chunk size not dividing the depth most
+// copies are split at the wrap. Power-of-two depths also run through the generic
+// index path ("gen") for comparison with the masked fast path.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tusb_fifo.h"
+#include "bench.h"
+
+#define ITEM_MAX   4
+#define CHUNK_MAX  200
+#define DEPTH_MAX  512
+
+typedef enum
+{
+  FIFO_OP_SINGLE,   // tu_fifo_write()/tu_fifo_read()
+  FIFO_OP_N,        // tu_fifo_write_n()/tu_fifo_read_n()
+  FIFO_OP_ZC,       // reserve/commit and acquire/release with memcpy
+  FIFO_OP_IOV,      // tu_fifo_write_iov() with header + payload, tu_fifo_read_n()
+} fifo_op_t;
+
+typedef struct
+{
+  tu_fifo_t ff;
+  fifo_op_t op;
+  uint16_t chunk;
+} fifo_case_t;
+
+static uint8_t ff_buf[DEPTH_MAX*ITEM_MAX];
+static uint8_t src[CHUNK_MAX*ITEM_MAX];
+static uint8_t dst[CHUNK_MAX*ITEM_MAX];
+
+static void fifo_op(void* arg, uint32_t count)
+{
+  fifo_case_t* fc = (fifo_case_t*) arg;
+  tu_fifo_t* ff = &fc->ff;
+  uint16_t const chunk = fc->chunk;
+  uint16_t const item_size = ff->item_size;
+  uint32_t check = 0;
+
+  while (count--)
+  {
+    switch (fc->op)
+    {
+      case FIFO_OP_SINGLE:
+        tu_fifo_write(ff, src);
+        tu_fifo_read(ff, dst);
+      break;
+
+      case FIFO_OP_N:
+        tu_fifo_write_n(ff, src, chunk);
+        tu_fifo_read_n(ff, dst, chunk);
+      break;
+
+      case FIFO_OP_ZC:
+      {
+        tu_fifo_buffer_info_t info;
+
+        tu_fifo_idx_t n = tu_fifo_write_reserve(ff, &info, chunk);
+        memcpy(info.ptr_lin, src, info.len_lin*item_size);
+        if (info.len_wrap) memcpy(info.ptr_wrap, src + info.len_lin*item_size, info.len_wrap*item_size);
+        tu_fifo_write_commit(ff, n);
+
+        n = tu_fifo_read_acquire(ff, &info, chunk);
+        memcpy(dst, info.ptr_lin, info.len_lin*item_size);
+        if (info.len_wrap) memcpy(dst + info.len_lin*item_size, info.ptr_wrap, info.len_wrap*item_size);
+        tu_fifo_read_release(ff, n);
+      }
+      break;
+
+      case FIFO_OP_IOV:
+      {
+        tu_fifo_iovec_const_t const iov[2] = { { src, 1 }, { src + item_size, (tu_fifo_idx_t) (chunk - 1) } };
+        tu_fifo_write_iov(ff, iov, 2);
+        tu_fifo_read_n(ff, dst, chunk);
+      }
+      break;
+    }
+
+    check += dst[0];
+  }
+
+  bench_sink(check);
+}
+
+static void fifo_case(char const* op_name, fifo_op_t op, uint16_t depth, uint16_t item_size, uint16_t chunk, bool force_generic)
+{
+  static fifo_case_t fc;
+  char name[64];
+
+  memset(&fc, 0, sizeof(fc));
+  if ( !tu_fifo_config(&fc.ff, ff_buf, depth, item_size, false) ) return;
+
+  // emulate the behavior before the power-of-two fast path
+  if (force_generic)
+  {
+    if (CFG_TUSB_FIFO_POW2_ONLY || !fc.ff.pow2) return;
+    fc.ff.pow2 = false;
+  }
+
+  fc.op    = op;
+  fc.chunk = (op == FIFO_OP_SINGLE) ? 1 : chunk;
+
+  snprintf(name, sizeof(name), "%s/d%u%s/i%u/c%u", op_name, depth, force_generic ? "gen" : "", item_size, fc.chunk);
+  bench_run("fifo", name, (uint32_t) fc.chunk*item_size, fifo_op, &fc);
+}
+
+void fifo_bench(void)
+{
+  static const uint16_t depths[] = { 64, 100, 500, 512 };
+  static const uint16_t chunks[] = { 3, 16, 64, 200 };
+
+  for(size_t d=0; d<TU_ARRAY_SIZE(depths); d++)
+  {
+    uint16_t const depth = depths[d];
+
+    for(uint16_t item_size=1; item_size<=ITEM_MAX; item_size*=4)
+    {
+      fifo_case("single", FIFO_OP_SINGLE, depth, item_size, 1, false);
+      fifo_case("single", FIFO_OP_SINGLE, depth, item_size, 1, true);
+
+      for(size_t c=0; c<TU_ARRAY_SIZE(chunks); c++)
+      {
+        if (chunks[c] > depth) continue;
+        fifo_case("n", FIFO_OP_N, depth, item_size, chunks[c], false);
+        fifo_case("n", FIFO_OP_N, depth, item_size, chunks[c], true);
+      }
+    }
+  }
+
+  // zero-copy and scatter/gather access on a buffer of typical endpoint size
+  fifo_case("zc" , FIFO_OP_ZC , 100, 1, 64, false);
+  fifo_case("zc" , FIFO_OP_ZC , 512, 1, 64, false);
+  fifo_case("iov", FIFO_OP_IOV, 100, 1, 64, false);
+  fifo_case("iov", FIFO_OP_IOV, 512, 1, 64, false);
+}
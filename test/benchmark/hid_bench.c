@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// HID host report descriptor parser on the descriptors of common devices
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tusb.h"
+#include "class/hid/hid_device.h"   // report descriptor templates
+#include "bench.h"
+
+typedef struct
+{
+  uint8_t const* desc;
+  uint16_t len;
+} hid_case_t;
+
+static uint8_t const _desc_keyboard[] =
+{
+  TUD_HID_REPORT_DESC_KEYBOARD()
+};
+
+static uint8_t const _desc_composite[] =
+{
+  TUD_HID_REPORT_DESC_KEYBOARD( HID_REPORT_ID(1) ),
+  TUD_HID_REPORT_DESC_MOUSE   ( HID_REPORT_ID(2) ),
+  TUD_HID_REPORT_DESC_CONSUMER( HID_REPORT_ID(3) ),
+  TUD_HID_REPORT_DESC_GAMEPAD ( HID_REPORT_ID(4) )
+};
+
+static void hid_op(void* arg, uint32_t count)
+{
+  hid_case_t const* hc = (hid_case_t const*) arg;
+  tuh_hid_report_info_t info[4];
+  uint32_t sum = 0;
+
+  while (count--) sum += tuh_hid_parse_report_descriptor(info, TU_ARRAY_SIZE(info), hc->desc, hc->len);
+
+  bench_sink(sum);
+}
+
+void hid_bench(void)
+{
+  hid_case_t keyboard  = { .desc = _desc_keyboard , .len = sizeof(_desc_keyboard)  };
+  hid_case_t composite = { .desc = _desc_composite, .len = sizeof(_desc_composite) };
+
+  bench_run("hid", "parse/keyboard" , keyboard.len , hid_op, &keyboard);
+  bench_run("hid", "parse/composite", composite.len, hid_op, &composite);
+}
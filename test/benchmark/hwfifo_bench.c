@@ -0,0 +1,148 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Host micro-benchmark for the tu_hwfifo copy kernels.
+// A volatile variable stands in for the peripheral data register. Each kernel is
+// compared against the byte-shuffling loop the DCDs used before, on an aligned
+// buffer and on a buffer offset by one byte.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tusb_fifo.h"
+#include "bench.h"
+
+#define PACKET_SIZE   512
+
+static volatile uint32_t fifo_reg;
+static uint32_t buf_words[PACKET_SIZE/4 + 1];
+
+//--------------------------------------------------------------------+
+// Reference loops, as found in the DCDs before the shared kernels
+//--------------------------------------------------------------------+
+static void ref_write32(volatile uint32_t * reg, void const * src, uint32_t len)
+{
+  uint8_t const * s = (uint8_t const *) src;
+
+  for(uint32_t i = 0; i < len/4; i++)
+  {
+    *reg = ((uint32_t) s[3] << 24) | ((uint32_t) s[2] << 16) | ((uint32_t) s[1] << 8) | s[0];
+    s += 4;
+  }
+
+  uint8_t const bytes_rem = len & 0x03;
+  if ( bytes_rem )
+  {
+    uint32_t tmp = s[0];
+    if ( bytes_rem > 1 ) tmp |= ((uint32_t) s[1] << 8);
+    if ( bytes_rem > 2 ) tmp |= ((uint32_t) s[2] << 16);
+    *reg = tmp;
+  }
+}
+
+static void ref_read32(volatile const uint32_t * reg, void * dst, uint32_t len)
+{
+  uint8_t * d = (uint8_t *) dst;
+
+  for(uint32_t i = 0; i < len/4; i++)
+  {
+    uint32_t const tmp = *reg;
+    d[0] = tu_u32_byte0(tmp);
+    d[1] = tu_u32_byte1(tmp);
+    d[2] = tu_u32_byte2(tmp);
+    d[3] = tu_u32_byte3(tmp);
+    d += 4;
+  }
+
+  uint8_t const bytes_rem = len & 0x03;
+  if ( bytes_rem )
+  {
+    uint32_t const tmp = *reg;
+    d[0] = tu_u32_byte0(tmp);
+    if ( bytes_rem > 1 ) d[1] = tu_u32_byte1(tmp);
+    if ( bytes_rem > 2 ) d[2] = tu_u32_byte2(tmp);
+  }
+}
+
+static void kernel_write32(volatile uint32_t * reg, void const * src, uint32_t len)
+{
+  tu_hwfifo_write32(reg, src, len);
+}
+
+static void kernel_read32(volatile const uint32_t * reg, void * dst, uint32_t len)
+{
+  tu_hwfifo_read32(reg, dst, len);
+}
+
+typedef void (*write_fn_t)(volatile uint32_t * reg, void const * src, uint32_t len);
+typedef void (*read_fn_t)(volatile const uint32_t * reg, void * dst, uint32_t len);
+
+typedef struct
+{
+  write_fn_t wr;
+  read_fn_t  rd;
+  uint8_t* buf;
+  uint32_t len;
+} hwfifo_case_t;
+
+static void hwfifo_op(void* arg, uint32_t count)
+{
+  hwfifo_case_t* hc = (hwfifo_case_t*) arg;
+
+  while (count--)
+  {
+    if (hc->wr) hc->wr(&fifo_reg, hc->buf, hc->len);
+    else        hc->rd(&fifo_reg, hc->buf, hc->len);
+  }
+}
+
+static void hwfifo_case(char const* fn_name, write_fn_t wr, read_fn_t rd, uint8_t offset, uint32_t len)
+{
+  hwfifo_case_t hc = { .wr = wr, .rd = rd, .buf = ((uint8_t *) buf_words) + offset, .len = len };
+  char name[64];
+
+  snprintf(name, sizeof(name), "%s/%s/l%lu", fn_name, offset ? "unaligned" : "aligned", (unsigned long) len);
+  bench_run("hwfifo", name, len, hwfifo_op, &hc);
+}
+
+void hwfifo_bench(void)
+{
+  static const uint32_t lens[] = { 8, 64, 511, 512 };
+
+  memset(buf_words, 0x5A, sizeof(buf_words));
+  fifo_reg = 0x12345678;
+
+  for(size_t i=0; i<TU_ARRAY_SIZE(lens); i++)
+  {
+    for(uint8_t offset=0; offset<2; offset++)
+    {
+      hwfifo_case("ref_write32", ref_write32, NULL, offset, lens[i]);
+      hwfifo_case("write32"    , kernel_write32, NULL, offset, lens[i]);
+      hwfifo_case("ref_read32" , NULL, ref_read32, offset, lens[i]);
+      hwfifo_case("read32"     , NULL, kernel_read32, offset, lens[i]);
+    }
+  }
+}
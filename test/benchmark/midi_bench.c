@@ -0,0 +1,105 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// MIDI class stream encoder (bytes to 4 byte event packets) and decoder (event
+// packets to bytes) for typical traffic. The driver source is included to mount
+// an interface without enumeration, transfers go to the stubs in bench_stubs.c.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "class/midi/midi_device.c"
+
+typedef struct
+{
+  uint8_t const* data;
+  uint32_t len;
+} midi_case_t;
+
+// 12 note on/off messages
+static uint8_t const _notes[] =
+{
+  0x90, 60, 100,  0x90, 64, 100,  0x90, 67, 100,  0x91, 36, 90,  0xB0, 7, 127,  0xE0, 0x00, 0x40,
+  0x80, 60, 0,    0x80, 64, 0,    0x80, 67, 0,    0x81, 36, 0,   0xC0, 5,       0xD0, 64
+};
+
+// SysEx identity reply
+static uint8_t const _sysex[] =
+{
+  0xF0, 0x7E, 0x7F, 0x06, 0x02, 0x00, 0x20, 0x29, 0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x02, 0xF7
+};
+
+static void midi_write_op(void* arg, uint32_t count)
+{
+  midi_case_t const* mc = (midi_case_t const*) arg;
+  uint32_t sum = 0;
+
+  while (count--) sum += tud_midi_n_stream_write(0, 0, mc->data, mc->len);
+
+  bench_sink(sum);
+}
+
+static void midi_read_op(void* arg, uint32_t count)
+{
+  midi_case_t const* mc = (midi_case_t const*) arg;
+  midid_interface_t* midi = &_midid_itf[0];
+  uint8_t buf[64];
+  uint32_t sum = 0;
+
+  // encode the stream once into the packets the host would send, every packet has a non-zero CIN
+  uint8_t packets[CFG_TUD_MIDI_EP_BUFSIZE];
+  uint16_t packets_len = 0;
+
+  tu_memclr(midi->epin_buf, sizeof(midi->epin_buf));
+  tud_midi_n_stream_write(0, 0, mc->data, mc->len);
+  memcpy(packets, midi->epin_buf, sizeof(packets));
+  while ( (packets_len < sizeof(packets)) && packets[packets_len] ) packets_len += 4;
+
+  while (count--)
+  {
+    tu_fifo_write_n(&midi->rx_ff, packets, packets_len);
+    sum += tud_midi_n_stream_read(0, 0, buf, sizeof(buf));
+    tu_fifo_clear(&midi->rx_ff);
+  }
+
+  bench_sink(sum);
+}
+
+void midi_bench(void)
+{
+  midid_init();
+  _midid_itf[0].ep_in  = 0x81;
+  _midid_itf[0].ep_out = 0x01;
+
+  midi_case_t notes = { .data = _notes, .len = sizeof(_notes) };
+  midi_case_t sysex = { .data = _sysex, .len = sizeof(_sysex) };
+
+  bench_run("midi", "stream_write/notes", notes.len, midi_write_op, &notes);
+  bench_run("midi", "stream_write/sysex", sysex.len, midi_write_op, &sysex);
+  bench_run("midi", "stream_read/notes" , notes.len, midi_read_op , &notes);
+  bench_run("midi", "stream_read/sysex" , sysex.len, midi_read_op , &sysex);
+}
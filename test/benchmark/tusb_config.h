@@ -0,0 +1,121 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------
+// COMMON CONFIGURATION
+//--------------------------------------------------------------------
+
+// Host-side benchmark: no real MCU, pick any that does not pull in vendor headers
+#ifndef CFG_TUSB_MCU
+  #define CFG_TUSB_MCU           OPT_MCU_NONE
+#endif
+
+#ifndef CFG_TUSB_RHPORT0_MODE
+  #define CFG_TUSB_RHPORT0_MODE  OPT_MODE_DEVICE
+#endif
+
+#ifndef CFG_TUSB_OS
+  #define CFG_TUSB_OS            OPT_OS_NONE
+#endif
+
+#ifndef CFG_TUSB_DEBUG
+  #define CFG_TUSB_DEBUG         0
+#endif
+
+// Host stack for the HID report descriptor parser, not linked into the usbd benchmark
+#if !defined(CFG_TUSB_RHPORT1_MODE) && !defined(BENCH_USBD)
+  #define CFG_TUSB_RHPORT1_MODE  OPT_MODE_HOST
+#endif
+
+//--------------------------------------------------------------------
+// DEVICE CONFIGURATION
+//--------------------------------------------------------------------
+
+#define CFG_TUD_ENDPOINT0_SIZE   64
+
+#define CFG_TUD_MIDI             1
+#define CFG_TUD_AUDIO            1
+
+#define CFG_TUD_MIDI_RX_BUFSIZE  64
+#define CFG_TUD_MIDI_TX_BUFSIZE  64
+
+// usbd benchmark: more built-in drivers to dispatch between, vendor is probed last
+#ifdef BENCH_USBD
+#define CFG_TUD_CDC              1
+#define CFG_TUD_HID              1
+#define CFG_TUD_VENDOR           1
+
+#define CFG_TUD_CDC_RX_BUFSIZE   64
+#define CFG_TUD_CDC_TX_BUFSIZE   64
+#define CFG_TUD_HID_EP_BUFSIZE   64
+#define CFG_TUD_VENDOR_RX_BUFSIZE 64
+#define CFG_TUD_VENDOR_TX_BUFSIZE 64
+#endif
+
+// Audio function with encoding and decoding enabled, 4 channels in 2 support FIFOs per direction
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN                  0
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT                  1
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ               64
+
+#define CFG_TUD_AUDIO_ENABLE_EP_IN                     1
+#define CFG_TUD_AUDIO_ENABLE_EP_OUT                    1
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX              392
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ           392
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX             392
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ          392
+
+#define CFG_TUD_AUDIO_ENABLE_ENCODING                  1
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING           1
+#define CFG_TUD_AUDIO_FUNC_1_CHANNEL_PER_FIFO_TX       2
+#define CFG_TUD_AUDIO_FUNC_1_N_TX_SUPP_SW_FIFO         2
+#define CFG_TUD_AUDIO_FUNC_1_TX_SUPP_SW_FIFO_SZ        196
+
+#define CFG_TUD_AUDIO_ENABLE_DECODING                  1
+#define CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING           1
+#define CFG_TUD_AUDIO_FUNC_1_CHANNEL_PER_FIFO_RX       2
+#define CFG_TUD_AUDIO_FUNC_1_N_RX_SUPP_SW_FIFO         2
+#define CFG_TUD_AUDIO_FUNC_1_RX_SUPP_SW_FIFO_SZ        196
+
+//--------------------------------------------------------------------
+// HOST CONFIGURATION
+//--------------------------------------------------------------------
+
+#define CFG_TUH_ENUMERATION_BUFSIZE 256
+#define CFG_TUH_DEVICE_MAX          1
+#define CFG_TUH_HID                 1
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_CONFIG_H_ */
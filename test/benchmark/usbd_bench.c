@@ -0,0 +1,291 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Device stack running on the simulated controller (portable/sim): transfer complete events delivered
+// to a class driver by tud_task(), re-enumeration with bus reset + SET_CONFIGURATION probing built-in
+// drivers, and vendor bulk throughput through the whole stack. Built once with function pointer
+// dispatch, once with CFG_TUD_DRIVER_STATIC_DISPATCH and once with CFG_TUSB_TRACE, see Makefile run-usbd.
+// The trace build also dumps the events of one enumeration and vendor transfer to _build/usbd_trace.bin
+// for tools/trace_decode.py.
+// Debug log cost is measured with CFG_TUSB_DEBUG=2 built once with printf formatting into a buffer and
+// once with CFG_TUSB_DEBUG_DEFERRED, the latter writes its log to _build/usbd_log.bin for tools/log_decode.py.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "device/dcd.h"
+#include "portable/sim/dcd_sim.h"
+#include "bench.h"
+
+#if CFG_TUD_DRIVER_STATIC_DISPATCH
+  #define DISPATCH_NAME   "switch"
+#elif CFG_TUSB_TRACE
+  #define DISPATCH_NAME   "table+trace"
+#elif CFG_TUSB_DEBUG_DEFERRED
+  #define DISPATCH_NAME   "table+log_deferred"
+#elif CFG_TUSB_DEBUG
+  #define DISPATCH_NAME   "table+log_printf"
+#else
+  #define DISPATCH_NAME   "table"
+#endif
+
+enum
+{
+  EDPT_VENDOR_OUT = 0x01,
+  EDPT_VENDOR_IN  = 0x81,
+};
+
+//--------------------------------------------------------------------+
+// Descriptors
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _desc_device =
+{
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = 0x00,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor           = 0xCafe,
+  .idProduct          = 0x0001,
+  .bcdDevice          = 0x0100,
+  .iManufacturer      = 0x00,
+  .iProduct           = 0x00,
+  .iSerialNumber      = 0x00,
+  .bNumConfigurations = 0x01
+};
+
+static uint8_t const _desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN, 0, 100),
+
+  // Interface number, string index, EP Out & IN address, EP size
+  TUD_VENDOR_DESCRIPTOR(0, 0, EDPT_VENDOR_OUT, EDPT_VENDOR_IN, 64),
+};
+
+static tusb_control_request_t const _req_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0x0000,
+  .wLength       = 0
+};
+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return (uint8_t const *) &_desc_device;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  (void) index;
+  return _desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) index; (void) langid;
+  return NULL;
+}
+
+uint8_t const * tud_hid_descriptor_report_cb(uint8_t instance)
+{
+  (void) instance;
+  return NULL;
+}
+
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen)
+{
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) reqlen;
+  return 0;
+}
+
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize)
+{
+  (void) instance; (void) report_id; (void) report_type; (void) buffer; (void) bufsize;
+}
+
+#if CFG_TUSB_TRACE
+// nanoseconds, wraps every 4.3 s which the decoder handles for deltas
+uint32_t tusb_trace_timestamp_cb(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec);
+}
+#endif
+
+#if CFG_TUSB_DEBUG && !CFG_TUSB_DEBUG_DEFERRED
+// CFG_TUSB_DEBUG_PRINTF: format as a UART logger would, without the output itself
+int bench_printf(const char* format, ...)
+{
+  static char line[256];
+
+  va_list ap;
+  va_start(ap, format);
+  int const len = vsnprintf(line, sizeof(line), format, ap);
+  va_end(ap);
+
+  bench_sink((uint32_t) line[0]);
+  return len;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Benchmarks
+//--------------------------------------------------------------------+
+
+static uint8_t _vendor_buf[64];
+
+// Drain deferred log as the transport to the host would do
+static void log_drain(void)
+{
+#if CFG_TUSB_DEBUG_DEFERRED
+  static uint8_t chunk[256];
+  while ( tu_log_read(chunk, sizeof(chunk)) ) {}
+#endif
+}
+
+static void set_config(void)
+{
+  dcd_sim_bus_reset(0, TUSB_SPEED_FULL);
+  dcd_sim_control_xfer(0, &_req_set_configuration, NULL, tud_task);
+}
+
+static void xfer_complete_op(void* arg, uint32_t count)
+{
+  (void) arg;
+
+  for(uint32_t i=0; i<count; i++)
+  {
+    dcd_event_xfer_complete(0, EDPT_VENDOR_IN, 64, XFER_RESULT_SUCCESS, false);
+    tud_task();
+    log_drain();
+  }
+}
+
+static void set_config_op(void* arg, uint32_t count)
+{
+  (void) arg;
+
+  for(uint32_t i=0; i<count; i++)
+  {
+    set_config();
+    log_drain();
+  }
+}
+
+// host writes one packet, application reads it back
+static void vendor_out_op(void* arg, uint32_t count)
+{
+  (void) arg;
+
+  for(uint32_t i=0; i<count; i++)
+  {
+    dcd_sim_out(0, EDPT_VENDOR_OUT, _vendor_buf, sizeof(_vendor_buf));
+    tud_task();
+    bench_sink(tud_vendor_read(_vendor_buf, sizeof(_vendor_buf)));
+    log_drain();
+  }
+}
+
+// application writes one packet, host reads it
+static void vendor_in_op(void* arg, uint32_t count)
+{
+  (void) arg;
+
+  for(uint32_t i=0; i<count; i++)
+  {
+    tud_vendor_write(_vendor_buf, sizeof(_vendor_buf));
+    bench_sink((uint32_t) dcd_sim_in(0, EDPT_VENDOR_IN, _vendor_buf, sizeof(_vendor_buf)));
+    tud_task();
+    log_drain();
+  }
+}
+
+void usbd_bench(void)
+{
+  tusb_init();
+
+  set_config();
+  if ( !tud_mounted() )
+  {
+    printf("usbd: set configuration failed\n");
+    return;
+  }
+
+  // one round trip on the vendor pipe before timing it
+  dcd_sim_out(0, EDPT_VENDOR_OUT, _vendor_buf, sizeof(_vendor_buf));
+  tud_task();
+  if ( tud_vendor_read(_vendor_buf, sizeof(_vendor_buf)) != sizeof(_vendor_buf) )
+  {
+    printf("usbd: vendor transfer failed\n");
+    return;
+  }
+
+  bench_run("usbd", "xfer_complete/" DISPATCH_NAME, 0, xfer_complete_op, NULL);
+  bench_run("usbd", "set_config/" DISPATCH_NAME   , 0, set_config_op   , NULL);
+  bench_run("usbd", "vendor_out/" DISPATCH_NAME   , sizeof(_vendor_buf), vendor_out_op, NULL);
+  bench_run("usbd", "vendor_in/" DISPATCH_NAME    , sizeof(_vendor_buf), vendor_in_op , NULL);
+
+#if CFG_TUSB_TRACE
+  tusb_trace_clear();
+  set_config();
+  vendor_out_op(NULL, 1);
+  vendor_in_op(NULL, 1);
+
+  FILE* f = fopen("_build/usbd_trace.bin", "wb");
+  if ( f )
+  {
+    fwrite(&_tusb_trace, sizeof(_tusb_trace), 1, f);
+    fclose(f);
+  }
+#endif
+
+#if CFG_TUSB_DEBUG_DEFERRED
+  // vendor_out_op() drains the log itself
+  log_drain();
+  set_config();
+  dcd_sim_out(0, EDPT_VENDOR_OUT, _vendor_buf, sizeof(_vendor_buf));
+  tud_task();
+  bench_sink(tud_vendor_read(_vendor_buf, sizeof(_vendor_buf)));
+
+  FILE* f = fopen("_build/usbd_log.bin", "wb");
+  if ( f )
+  {
+    uint8_t chunk[256];
+    uint32_t count;
+    while ( (count = tu_log_read(chunk, sizeof(chunk))) ) fwrite(chunk, 1, count, f);
+    fclose(f);
+  }
+#endif
+}
@@ -0,0 +1,426 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Host stack on the simulated host controller: enumerates the stock device models on the
+// root port and behind a hub, exercises each class, then measures enumeration time, a hub
+// hotplug storm and MSC throughput with and without injected latency and NAKs. The bus and
+// tuh_task() share this thread so the program can be profiled as is, e.g. with perf.
+// Frames are virtual 1ms USB frames, the enumeration delays of the stack are counted in them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+#include "portable/sim/hcd_sim.h"
+#include "portable/sim/hcd_sim_model.h"
+
+#define DISK_BLOCK_COUNT  2048
+#define DISK_BLOCK_SIZE   512
+#define MSC_XFER_BLOCKS   64      // per READ10/WRITE10
+#define STORM_CYCLES      50
+#define FRAME_LIMIT       100000  // per wait, a stuck stack fails instead of hanging
+
+enum
+{
+  HUB_ADDR    = CFG_TUH_DEVICE_MAX + 1,
+  CDC_EP_OUT  = 0x02,
+};
+
+#define CHECK(_cond, ...) \
+  do { if ( !(_cond) ) { printf("FAILED line %d: ", __LINE__); printf(__VA_ARGS__); printf("\n"); return false; } } while(0)
+
+static uint8_t _disk[DISK_BLOCK_COUNT*DISK_BLOCK_SIZE];
+static uint8_t _buf[MSC_XFER_BLOCKS*DISK_BLOCK_SIZE];
+
+static hcd_sim_msc_t _msc;
+static hcd_sim_hid_t _hid;
+static hcd_sim_cdc_t _cdc;
+static hcd_sim_hub_t _hub;
+
+//--------------------------------------------------------------------+
+// Stack callbacks
+//--------------------------------------------------------------------+
+
+static uint32_t _mounted; // bit n: device at address n is mounted
+
+static uint8_t  _hid_addr;
+static uint32_t _hid_report_count;
+static hid_gamepad_report_t _hid_report;
+
+static bool _xfer_done;
+static bool _xfer_ok;
+static uint32_t _xfer_len;
+
+void tuh_mount_cb(uint8_t dev_addr)
+{
+  _mounted |= TU_BIT(dev_addr);
+}
+
+void tuh_umount_cb(uint8_t dev_addr)
+{
+  _mounted &= ~TU_BIT(dev_addr);
+}
+
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
+{
+  (void) desc_report; (void) desc_len;
+
+  _hid_addr = dev_addr;
+  tuh_hid_receive_report(dev_addr, instance);
+}
+
+void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
+{
+  (void) dev_addr; (void) instance;
+  _hid_addr = 0;
+}
+
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  memcpy(&_hid_report, report, tu_min16(len, sizeof(_hid_report)));
+  _hid_report_count++;
+
+  tuh_hid_receive_report(dev_addr, instance);
+}
+
+void tuh_cdc_xfer_isr(uint8_t dev_addr, xfer_result_t event, cdc_pipeid_t pipe_id, uint32_t xferred_bytes)
+{
+  (void) dev_addr; (void) pipe_id;
+
+  _xfer_ok   = (event == XFER_RESULT_SUCCESS);
+  _xfer_len  = xferred_bytes;
+  _xfer_done = true;
+}
+
+static bool msc_complete_cb(uint8_t dev_addr, msc_cbw_t const* cbw, msc_csw_t const* csw)
+{
+  (void) dev_addr; (void) cbw;
+
+  _xfer_ok   = (csw->status == MSC_CSW_STATUS_PASSED);
+  _xfer_done = true;
+  return true;
+}
+
+static bool control_complete_cb(uint8_t dev_addr, tusb_control_request_t const * request, xfer_result_t result)
+{
+  (void) dev_addr; (void) request;
+
+  _xfer_ok   = (result == XFER_RESULT_SUCCESS);
+  _xfer_done = true;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+static uint32_t _frame; // last frame run
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+// Run stack and bus until cond() holds
+static bool wait_for(bool (*cond)(void))
+{
+  uint32_t const start = _frame;
+
+  while ( _frame - start < FRAME_LIMIT )
+  {
+    tuh_task();
+    if ( cond() ) return true;
+
+    _frame = hcd_sim_task();
+  }
+
+  return false;
+}
+
+static uint8_t msc_addr(void)
+{
+  for(uint8_t addr = 1; addr <= CFG_TUH_DEVICE_MAX; addr++)
+  {
+    if ( tuh_msc_mounted(addr) ) return addr;
+  }
+  return 0;
+}
+
+static uint8_t cdc_addr(void)
+{
+  for(uint8_t addr = 1; addr <= CFG_TUH_DEVICE_MAX; addr++)
+  {
+    if ( tuh_cdc_serial_is_mounted(addr) ) return addr;
+  }
+  return 0;
+}
+
+static bool msc_mounted   (void) { return msc_addr() != 0; }
+static bool hid_mounted   (void) { return _hid_addr != 0; }
+static bool cdc_mounted   (void) { return cdc_addr() && tu_bit_test(_mounted, cdc_addr()); }
+static bool hub_mounted   (void) { return tu_bit_test(_mounted, HUB_ADDR); }
+static bool hid_received  (void) { return _hid_report_count != 0; }
+static bool xfer_done     (void) { return _xfer_done; }
+
+static bool all_unmounted(void)
+{
+  return _mounted == 0;
+}
+
+static bool children_unmounted(void)
+{
+  return !msc_mounted() && !hid_mounted() && !cdc_mounted();
+}
+
+static inline uint8_t pattern(uint32_t lba, uint32_t i)
+{
+  return (uint8_t) (lba*7 + i);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static bool msc_rw(uint8_t addr, bool write, uint32_t lba, uint16_t count)
+{
+  _xfer_done = false;
+
+  if ( write )
+  {
+    CHECK(tuh_msc_write10(addr, 0, _buf, lba, count, msc_complete_cb), "write10 submit");
+  }else
+  {
+    CHECK(tuh_msc_read10(addr, 0, _buf, lba, count, msc_complete_cb), "read10 submit");
+  }
+
+  CHECK(wait_for(xfer_done) && _xfer_ok, "%s lba %u", write ? "write10" : "read10", (unsigned) lba);
+  return true;
+}
+
+// Write the whole disk then read it back
+static bool msc_throughput(char const* name, uint16_t latency, uint16_t nak)
+{
+  uint8_t const addr = msc_addr();
+  CHECK(addr, "msc not mounted");
+
+  _msc.model.latency = latency;
+  _msc.model.nak     = nak;
+
+  uint32_t const frame0 = _frame;
+  uint64_t const t0 = now_ns();
+
+  for(uint32_t lba = 0; lba < DISK_BLOCK_COUNT; lba += MSC_XFER_BLOCKS)
+  {
+    for(uint32_t i = 0; i < sizeof(_buf); i++) _buf[i] = pattern(lba, i);
+    TU_VERIFY(msc_rw(addr, true, lba, MSC_XFER_BLOCKS));
+  }
+
+  for(uint32_t lba = 0; lba < DISK_BLOCK_COUNT; lba += MSC_XFER_BLOCKS)
+  {
+    memset(_buf, 0, sizeof(_buf));
+    TU_VERIFY(msc_rw(addr, false, lba, MSC_XFER_BLOCKS));
+
+    for(uint32_t i = 0; i < sizeof(_buf); i++)
+    {
+      CHECK(_buf[i] == pattern(lba, i), "data mismatch at lba %u offset %u", (unsigned) lba, (unsigned) i);
+    }
+  }
+
+  double const sec = (double) (now_ns() - t0) / 1e9;
+  uint32_t const bytes = 2u*sizeof(_disk);
+  uint32_t const count = 2u*DISK_BLOCK_COUNT/MSC_XFER_BLOCKS;
+
+  printf("%-24s %u KB, %.1f MB/s, %.1f frames per command\n", name, (unsigned) (bytes/1024),
+         bytes / sec / 1e6, (double) (_frame - frame0) / count);
+
+  _msc.model.latency = 0;
+  _msc.model.nak     = 0;
+
+  return true;
+}
+
+static bool root_msc(void)
+{
+  hcd_sim_msc_init(&_msc, _disk, DISK_BLOCK_COUNT, DISK_BLOCK_SIZE);
+  _msc.not_ready = 2; // goes through REQUEST SENSE during enumeration
+
+  uint32_t const frame0 = _frame;
+  uint64_t const t0 = now_ns();
+
+  CHECK(hcd_sim_attach(0, &_msc.model), "attach msc");
+  CHECK(wait_for(msc_mounted), "msc mount");
+
+  printf("%-24s %u frames, %.0f us\n", "enumerate msc", (unsigned) (_frame - frame0), (double) (now_ns() - t0) / 1e3);
+
+  uint8_t const addr = msc_addr();
+  CHECK(tuh_msc_get_block_count(addr, 0) == DISK_BLOCK_COUNT && tuh_msc_get_block_size(addr, 0) == DISK_BLOCK_SIZE, "capacity");
+
+  TU_VERIFY(msc_throughput("msc throughput", 0, 0));
+  TU_VERIFY(msc_throughput("msc latency 1 nak 2", 1, 2));
+  CHECK(hcd_sim_nak_count() > 0, "no NAK injected");
+
+  // out of range is reported in the CSW
+  _xfer_done = false;
+  CHECK(tuh_msc_read10(addr, 0, _buf, DISK_BLOCK_COUNT, 1, msc_complete_cb), "read10 submit");
+  CHECK(wait_for(xfer_done) && !_xfer_ok, "read10 out of range");
+
+  hcd_sim_detach(0);
+  CHECK(wait_for(all_unmounted), "msc unmount");
+
+  printf("%-24s OK\n", "root msc");
+  return true;
+}
+
+static bool cdc_echo(uint8_t addr, uint32_t len)
+{
+  static uint8_t tx[64];
+  static uint8_t rx[64];
+
+  for(uint32_t i = 0; i < len; i++) tx[i] = (uint8_t) (i + len);
+
+  _xfer_done = false;
+  CHECK(tuh_cdc_send(addr, tx, len, false), "cdc send");
+  CHECK(wait_for(xfer_done) && _xfer_ok && _xfer_len == len, "cdc send complete");
+
+  _xfer_done = false;
+  CHECK(tuh_cdc_receive(addr, rx, sizeof(rx), false), "cdc receive");
+  CHECK(wait_for(xfer_done) && _xfer_ok && _xfer_len == len, "cdc receive complete");
+
+  CHECK(memcmp(tx, rx, len) == 0, "cdc echo mismatch");
+  return true;
+}
+
+static bool hub_children(void)
+{
+  uint32_t frame0 = _frame;
+
+  hcd_sim_hub_init(&_hub, 4);
+  CHECK(hcd_sim_attach(0, &_hub.model), "attach hub");
+  CHECK(wait_for(hub_mounted), "hub mount");
+  printf("%-24s %u frames\n", "enumerate hub", (unsigned) (_frame - frame0));
+
+  //------------- MSC -------------//
+  frame0 = _frame;
+  CHECK(hcd_sim_hub_attach(&_hub, 1, &_msc.model), "attach msc");
+  CHECK(wait_for(msc_mounted), "msc mount");
+  printf("%-24s %u frames\n", "enumerate msc via hub", (unsigned) (_frame - frame0));
+
+  TU_VERIFY(msc_rw(msc_addr(), false, 0, 1));
+  CHECK(_buf[1] == pattern(0, 1), "msc data via hub");
+
+  //------------- HID -------------//
+  hcd_sim_hid_init(&_hid);
+  CHECK(hcd_sim_hub_attach(&_hub, 2, &_hid.model), "attach hid");
+  CHECK(wait_for(hid_mounted), "hid mount");
+
+  hid_gamepad_report_t const report = { .x = 10, .y = -10, .hat = GAMEPAD_HAT_UP, .buttons = GAMEPAD_BUTTON_A };
+  hcd_sim_hid_report(&_hid, &report);
+  CHECK(wait_for(hid_received), "hid report");
+  CHECK(memcmp(&report, &_hid_report, sizeof(report)) == 0 && _hid_report_count == 1, "hid report content");
+
+  //------------- CDC -------------//
+  hcd_sim_cdc_init(&_cdc);
+  CHECK(hcd_sim_hub_attach(&_hub, 3, &_cdc.model), "attach cdc");
+  CHECK(wait_for(cdc_mounted), "cdc mount");
+
+  uint8_t const addr = cdc_addr();
+  TU_VERIFY(cdc_echo(addr, 64));
+  TU_VERIFY(cdc_echo(addr, 5));
+
+  // halted endpoint answers with STALL until CLEAR_FEATURE(ENDPOINT_HALT)
+  hcd_sim_halt(&_cdc.model, CDC_EP_OUT);
+
+  _xfer_done = false;
+  CHECK(tuh_cdc_send(addr, "stall", 5, false), "cdc send");
+  CHECK(wait_for(xfer_done) && !_xfer_ok, "cdc stall");
+
+  tusb_control_request_t const request =
+  {
+    .bmRequestType_bit =
+    {
+      .recipient = TUSB_REQ_RCPT_ENDPOINT,
+      .type      = TUSB_REQ_TYPE_STANDARD,
+      .direction = TUSB_DIR_OUT
+    },
+    .bRequest = TUSB_REQ_CLEAR_FEATURE,
+    .wValue   = TUSB_REQ_FEATURE_EDPT_HALT,
+    .wIndex   = CDC_EP_OUT,
+    .wLength  = 0
+  };
+
+  _xfer_done = false;
+  CHECK(tuh_control_xfer(addr, &request, NULL, control_complete_cb), "clear halt");
+  CHECK(wait_for(xfer_done) && _xfer_ok, "clear halt complete");
+  TU_VERIFY(cdc_echo(addr, 16));
+
+  printf("%-24s OK\n", "hub msc hid cdc");
+  return true;
+}
+
+// Unplug all children at once then plug them back one by one
+static bool hub_storm(void)
+{
+  uint32_t const frame0 = _frame;
+  uint64_t const t0 = now_ns();
+
+  for(uint32_t cycle = 0; cycle < STORM_CYCLES; cycle++)
+  {
+    hcd_sim_hub_detach(&_hub, 1);
+    hcd_sim_hub_detach(&_hub, 2);
+    hcd_sim_hub_detach(&_hub, 3);
+    CHECK(wait_for(children_unmounted), "cycle %u: unmount", (unsigned) cycle);
+
+    CHECK(hcd_sim_hub_attach(&_hub, 1, &_msc.model) && wait_for(msc_mounted), "cycle %u: msc", (unsigned) cycle);
+    CHECK(hcd_sim_hub_attach(&_hub, 2, &_hid.model) && wait_for(hid_mounted), "cycle %u: hid", (unsigned) cycle);
+    CHECK(hcd_sim_hub_attach(&_hub, 3, &_cdc.model) && wait_for(cdc_mounted), "cycle %u: cdc", (unsigned) cycle);
+  }
+
+  double const sec = (double) (now_ns() - t0) / 1e9;
+  uint32_t const count = 3*STORM_CYCLES;
+
+  printf("%-24s %u enumerations, %u frames each, %.0f per second\n", "hub hotplug storm",
+         (unsigned) count, (unsigned) ((_frame - frame0) / count), count / sec);
+
+  TU_VERIFY(cdc_echo(cdc_addr(), 32));
+
+  hcd_sim_detach(0);
+  CHECK(wait_for(all_unmounted), "hub unmount");
+
+  printf("%-24s OK\n", "hub storm");
+  return true;
+}
+
+int main(void)
+{
+  tusb_init();
+
+  bool const ok = root_msc() && hub_children() && hub_storm();
+  return ok ? 0 : 1;
+}
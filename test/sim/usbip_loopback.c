@@ -0,0 +1,460 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// USB/IP loopback test: the device stack with a vendor echo function runs on dcd_sim and is
+// exported by usbip_sim. A minimal USB/IP client on another thread stands in for vhci-hcd:
+// it lists and imports the device, configures it, then streams data through the echo with
+// several URBs outstanding per endpoint, checks the returned stream and unlinks the IN URBs
+// left over at the end.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "tusb.h"
+#include "portable/sim/usbip_sim.h"
+
+#define STREAM_BYTES    (4u*1024u*1024u)
+#define URB_SIZE        512
+#define URB_DEPTH       4     // outstanding URBs per endpoint
+
+enum
+{
+  EPNUM_VENDOR = 1,
+
+  USBIP_VERSION    = 0x0111,
+  OP_REQ_DEVLIST   = 0x8005,
+  OP_REQ_IMPORT    = 0x8003,
+  USBIP_CMD_SUBMIT = 1,
+  USBIP_CMD_UNLINK = 2,
+  USBIP_RET_SUBMIT = 3,
+  USBIP_RET_UNLINK = 4,
+};
+
+// Client side view of the protocol, all fields big endian
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t version;
+  uint16_t code;
+  uint32_t status;
+} op_header_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t command;
+  uint32_t seqnum;
+  uint32_t devid;
+  uint32_t direction;
+  uint32_t ep;
+  uint32_t word[5]; // command specific
+  uint8_t  setup[8];
+} urb_header_t;
+
+TU_VERIFY_STATIC(sizeof(urb_header_t) == 48, "size is not correct");
+
+//--------------------------------------------------------------------+
+// Device: vendor echo
+//--------------------------------------------------------------------+
+
+static tusb_desc_device_t const _desc_device =
+{
+  .bLength            = sizeof(tusb_desc_device_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE,
+  .bcdUSB             = 0x0200,
+  .bDeviceClass       = 0x00,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+  .bMaxPacketSize0    = CFG_TUD_ENDPOINT0_SIZE,
+  .idVendor           = 0xCafe,
+  .idProduct          = 0x4010,
+  .bcdDevice          = 0x0100,
+  .iManufacturer      = 0x00,
+  .iProduct           = 0x00,
+  .iSerialNumber      = 0x00,
+  .bNumConfigurations = 0x01
+};
+
+static uint8_t const _desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN, 0, 100),
+
+  // Interface number, string index, EP Out & IN address, EP size
+  TUD_VENDOR_DESCRIPTOR(0, 0, EPNUM_VENDOR, 0x80 | EPNUM_VENDOR, 64),
+};
+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return (uint8_t const *) &_desc_device;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  (void) index;
+  return _desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) index; (void) langid;
+  return NULL;
+}
+
+static void echo_task(void)
+{
+  uint8_t buf[64];
+
+  while ( 1 )
+  {
+    uint32_t count = tu_min32(tud_vendor_write_available(), sizeof(buf));
+    count = count ? tud_vendor_read(buf, count) : 0;
+    if ( !count ) break;
+
+    tud_vendor_write(buf, count);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Client
+//--------------------------------------------------------------------+
+
+static uint16_t _port;
+static volatile bool _client_done;
+static bool _client_ok;
+
+static int _fd = -1;
+static uint32_t _seqnum;
+
+#define CHECK(_cond, ...) \
+  do { if ( !(_cond) ) { printf("FAILED line %d: ", __LINE__); printf(__VA_ARGS__); printf("\n"); return false; } } while(0)
+
+static bool sock_send(void const* buffer, size_t len)
+{
+  return send(_fd, buffer, len, MSG_NOSIGNAL) == (ssize_t) len;
+}
+
+static bool sock_recv(void* buffer, size_t len)
+{
+  return recv(_fd, buffer, len, MSG_WAITALL) == (ssize_t) len;
+}
+
+static bool client_connect(void)
+{
+  struct sockaddr_in addr =
+  {
+    .sin_family      = AF_INET,
+    .sin_port        = htons(_port),
+    .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+  };
+
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(_fd >= 0, "socket");
+
+  // fail instead of hanging if server stops answering
+  struct timeval const tv = { .tv_sec = 5 };
+  setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  int const one = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  CHECK(connect(_fd, (struct sockaddr*) &addr, sizeof(addr)) == 0, "connect: %s", strerror(errno));
+  return true;
+}
+
+static void client_close(void)
+{
+  close(_fd);
+  _fd = -1;
+}
+
+static bool op_send(uint16_t code)
+{
+  op_header_t const hdr = { htons(USBIP_VERSION), htons(code), 0 };
+  return sock_send(&hdr, sizeof(hdr));
+}
+
+static bool devlist(void)
+{
+  TU_VERIFY(client_connect());
+
+  op_header_t hdr;
+  uint32_t ndev;
+  uint8_t dev[312];
+  uint8_t itf[4];
+
+  CHECK(op_send(OP_REQ_DEVLIST) && sock_recv(&hdr, sizeof(hdr)) && sock_recv(&ndev, sizeof(ndev)), "devlist");
+  CHECK(ntohl(ndev) == 1, "devlist count %u", ntohl(ndev));
+  CHECK(sock_recv(dev, sizeof(dev)) && sock_recv(itf, sizeof(itf)), "devlist device");
+
+  // busid, idVendor, bNumInterfaces and class of interface
+  CHECK(strcmp((char const*) dev + 256, USBIP_SIM_BUSID) == 0, "busid");
+  CHECK(dev[300] == 0xCa && dev[301] == 0xfe && dev[311] == 1, "device info");
+  CHECK(itf[0] == TUSB_CLASS_VENDOR_SPECIFIC, "interface class");
+
+  client_close();
+  return true;
+}
+
+static bool import(char const* busid, bool expect_ok)
+{
+  TU_VERIFY(client_connect());
+
+  char id[32] = { 0 };
+  strncpy(id, busid, sizeof(id) - 1);
+
+  op_header_t hdr;
+  CHECK(op_send(OP_REQ_IMPORT) && sock_send(id, sizeof(id)) && sock_recv(&hdr, sizeof(hdr)), "import");
+  CHECK((hdr.status == 0) == expect_ok, "import status %u", ntohl(hdr.status));
+
+  if ( !expect_ok )
+  {
+    client_close();
+    return true;
+  }
+
+  uint8_t dev[312];
+  CHECK(sock_recv(dev, sizeof(dev)), "import device");
+  return true;
+}
+
+static uint32_t submit(uint8_t epnum, bool dir_in, void const* setup, void const* data, uint32_t len)
+{
+  urb_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+
+  hdr.command   = htonl(USBIP_CMD_SUBMIT);
+  hdr.seqnum    = htonl(++_seqnum);
+  hdr.devid     = htonl(0x00010001);
+  hdr.direction = htonl(dir_in ? 1 : 0);
+  hdr.ep        = htonl(epnum);
+  hdr.word[1]   = htonl(len);        // transfer_buffer_length
+  hdr.word[3]   = htonl(0xffffffff); // number_of_packets: not isochronous
+  if ( setup ) memcpy(hdr.setup, setup, 8);
+
+  if ( !sock_send(&hdr, sizeof(hdr)) ) return 0;
+  if ( !dir_in && len && !sock_send(data, len) ) return 0;
+
+  return _seqnum;
+}
+
+static bool unlink_urb(uint32_t seqnum)
+{
+  urb_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+
+  hdr.command = htonl(USBIP_CMD_UNLINK);
+  hdr.seqnum  = htonl(++_seqnum);
+  hdr.word[0] = htonl(seqnum);
+
+  return sock_send(&hdr, sizeof(hdr));
+}
+
+// receive a RET_SUBMIT/RET_UNLINK header, IN data of RET_SUBMIT is left in socket
+static bool ret_recv(urb_header_t* ret)
+{
+  CHECK(sock_recv(ret, sizeof(urb_header_t)), "no reply");
+
+  ret->command = ntohl(ret->command);
+  ret->seqnum  = ntohl(ret->seqnum);
+  for(uint8_t i = 0; i < 5; i++) ret->word[i] = ntohl(ret->word[i]);
+
+  return true;
+}
+
+static int32_t control(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wLength, void* buffer)
+{
+  tusb_control_request_t const request =
+  {
+    .bmRequestType = bmRequestType,
+    .bRequest      = bRequest,
+    .wValue        = wValue,
+    .wIndex        = 0,
+    .wLength       = wLength
+  };
+  bool const dir_in = (bmRequestType & TUSB_DIR_IN_MASK);
+
+  urb_header_t ret;
+  TU_VERIFY(submit(0, dir_in, &request, buffer, wLength) && ret_recv(&ret), -1);
+  TU_VERIFY(ret.command == USBIP_RET_SUBMIT && ret.word[0] == 0, -1);
+
+  if ( dir_in ) TU_VERIFY(sock_recv(buffer, ret.word[1]), -1);
+  return (int32_t) ret.word[1];
+}
+
+static inline uint8_t pattern(uint32_t i)
+{
+  return (uint8_t) (i * 7 + (i >> 9));
+}
+
+// Stream data through echo keeping URB_DEPTH URBs outstanding per direction
+static bool stream(void)
+{
+  static uint8_t out_buf[URB_SIZE];
+  static uint8_t in_buf[URB_SIZE];
+
+  uint32_t in_seq[URB_DEPTH];
+  uint32_t tx = 0, rx = 0;
+  uint32_t out_pending = 0, in_pending = 0;
+  uint32_t urbs = 0;
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  while ( rx < STREAM_BYTES )
+  {
+    while ( (out_pending < URB_DEPTH) && (tx < STREAM_BYTES) )
+    {
+      for(uint32_t i = 0; i < URB_SIZE; i++) out_buf[i] = pattern(tx + i);
+      CHECK(submit(EPNUM_VENDOR, false, NULL, out_buf, URB_SIZE), "submit OUT");
+      tx += URB_SIZE;
+      out_pending++;
+    }
+
+    while ( in_pending < URB_DEPTH )
+    {
+      in_seq[in_pending] = submit(EPNUM_VENDOR, true, NULL, NULL, URB_SIZE);
+      CHECK(in_seq[in_pending], "submit IN");
+      in_pending++;
+    }
+
+    urb_header_t ret;
+    TU_VERIFY(ret_recv(&ret));
+    CHECK(ret.command == USBIP_RET_SUBMIT && ret.word[0] == 0, "URB %u failed: %d", ret.seqnum, (int32_t) ret.word[0]);
+    urbs++;
+
+    if ( in_pending && (ret.seqnum == in_seq[0]) )
+    {
+      // IN URBs complete in submission order
+      uint32_t const len = ret.word[1];
+      CHECK(len <= URB_SIZE && sock_recv(in_buf, len), "IN data");
+
+      for(uint32_t i = 0; i < len; i++)
+      {
+        CHECK(in_buf[i] == pattern(rx + i), "data mismatch at %u", rx + i);
+      }
+      rx += len;
+
+      memmove(in_seq, in_seq + 1, (URB_DEPTH - 1) * sizeof(uint32_t));
+      in_pending--;
+    }
+    else
+    {
+      CHECK(ret.word[1] == URB_SIZE, "OUT short %u", ret.word[1]);
+      out_pending--;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double const sec = (double) (t1.tv_sec - t0.tv_sec) + (double) (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+  printf("%-24s %u bytes echoed, %.1f MB/s, %.0f URB/s\n", "stream", (unsigned) rx, rx / sec / 1e6, urbs / sec);
+
+  // no more data: unlink IN URBs still waiting
+  for(uint32_t i = 0; i < in_pending; i++)
+  {
+    urb_header_t ret;
+    CHECK(unlink_urb(in_seq[i]) && ret_recv(&ret), "unlink");
+    CHECK(ret.command == USBIP_RET_UNLINK && (int32_t) ret.word[0] == -ECONNRESET, "unlink status %d", (int32_t) ret.word[0]);
+  }
+
+  return true;
+}
+
+static bool client_run(void)
+{
+  TU_VERIFY(devlist());
+  printf("%-24s OK\n", "devlist");
+
+  TU_VERIFY(import("9-9", false));
+  TU_VERIFY(import(USBIP_SIM_BUSID, true));
+  printf("%-24s OK\n", "import");
+
+  tusb_desc_device_t desc_device;
+  CHECK(control(0x80, TUSB_REQ_GET_DESCRIPTOR, TUSB_DESC_DEVICE << 8, sizeof(desc_device), &desc_device) == sizeof(desc_device), "get device descriptor");
+  CHECK(desc_device.idProduct == _desc_device.idProduct, "device descriptor");
+  CHECK(control(0x00, TUSB_REQ_SET_CONFIGURATION, 1, 0, NULL) == 0, "set configuration");
+  printf("%-24s OK\n", "enumerate");
+
+  TU_VERIFY(stream());
+  printf("%-24s OK\n", "unlink");
+
+  client_close();
+  return true;
+}
+
+static void* client_thread(void* arg)
+{
+  (void) arg;
+
+  _client_ok   = client_run();
+  _client_done = true;
+
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// Main: device stack and server share one thread
+//--------------------------------------------------------------------+
+
+static void device_task(void)
+{
+  tud_task_ext(0, false);
+}
+
+int main(void)
+{
+  tusb_init();
+
+  if ( !usbip_sim_init(0, TUSB_SPEED_FULL, NULL, 0, device_task) )
+  {
+    printf("usbip server failed to start\n");
+    return 1;
+  }
+  _port = usbip_sim_port();
+
+  pthread_t client;
+  pthread_create(&client, NULL, client_thread, NULL);
+
+  while ( !_client_done )
+  {
+    usbip_sim_task(1);
+    tud_task_ext(0, false);
+    echo_task();
+  }
+
+  pthread_join(client, NULL);
+  usbip_sim_deinit();
+
+  return _client_ok ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Multithreaded stress test for tu_fifo in single producer/single consumer mode.
+// A writer thread pushes an incrementing sequence through the FIFO while a reader
+// thread drains it concurrently and checks that no item is lost, duplicated or torn.
+// The scenarios follow test/test/test_fifo.c: single items, n items with random
+// chunk sizes, power-of-two and other depths, 4 byte items and zero-copy access.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "tusb_fifo.h"
+
+#define STRESS_ITEMS    (1000u*1000u)
+#define CHUNK_MAX       37
+
+typedef enum
+{
+  MODE_SINGLE,  // tu_fifo_write()/tu_fifo_read()
+  MODE_N,       // tu_fifo_write_n()/tu_fifo_read_n()
+  MODE_ZC,      // tu_fifo_write_reserve()/tu_fifo_read_acquire()
+} stress_mode_t;
+
+typedef struct
+{
+  char const* name;
+  uint16_t depth;
+  uint16_t item_size;
+  stress_mode_t mode;
+
+  tu_fifo_t ff;
+  volatile uint32_t errors;
+} stress_case_t;
+
+static uint8_t ff_buf[1024*4];
+
+// store/check sequence number as item of 1 or 4 bytes
+static inline void item_set(stress_case_t* sc, uint8_t* p, uint32_t seq)
+{
+  if (sc->item_size == 4) memcpy(p, &seq, 4);
+  else *p = (uint8_t) seq;
+}
+
+static inline bool item_check(stress_case_t* sc, uint8_t const* p, uint32_t seq)
+{
+  if (sc->item_size == 4)
+  {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v == seq;
+  }
+
+  return *p == (uint8_t) seq;
+}
+
+// Fill/check a zero-copy span and return updated sequence, or count an error
+static uint32_t span_fill(stress_case_t* sc, void* ptr, uint16_t len, uint32_t seq)
+{
+  uint8_t* p = (uint8_t*) ptr;
+  for(uint16_t i=0; i<len; i++) item_set(sc, p + i*sc->item_size, seq++);
+  return seq;
+}
+
+static uint32_t span_check(stress_case_t* sc, void const* ptr, uint16_t len, uint32_t seq)
+{
+  uint8_t const* p = (uint8_t const*) ptr;
+  for(uint16_t i=0; i<len; i++)
+  {
+    if ( !item_check(sc, p + i*sc->item_size, seq++) ) sc->errors++;
+  }
+  return seq;
+}
+
+static void* writer_thread(void* arg)
+{
+  stress_case_t* sc = (stress_case_t*) arg;
+  tu_fifo_t* ff = &sc->ff;
+  unsigned int rnd = 1;
+  uint32_t seq = 0;
+  uint8_t buf[CHUNK_MAX*4];
+
+  while (seq < STRESS_ITEMS)
+  {
+    uint16_t n = (uint16_t) (1 + rand_r(&rnd) % CHUNK_MAX);
+    if (n > STRESS_ITEMS - seq) n = (uint16_t) (STRESS_ITEMS - seq);
+
+    // let the reader run if fifo is full, host may have a single core only
+    if ( tu_fifo_full(ff) ) sched_yield();
+
+    switch (sc->mode)
+    {
+      case MODE_SINGLE:
+        item_set(sc, buf, seq);
+        if ( tu_fifo_write(ff, buf) ) seq++;
+      break;
+
+      case MODE_N:
+        for(uint16_t i=0; i<n; i++) item_set(sc, buf + i*sc->item_size, seq+i);
+        seq += tu_fifo_write_n(ff, buf, n);
+      break;
+
+      case MODE_ZC:
+      {
+        tu_fifo_buffer_info_t info;
+        n = tu_fifo_write_reserve(ff, &info, n);
+        if (n)
+        {
+          uint32_t s = span_fill(sc, info.ptr_lin, info.len_lin, seq);
+          span_fill(sc, info.ptr_wrap, info.len_wrap, s);
+          seq += tu_fifo_write_commit(ff, n);
+        }
+      }
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+static void* reader_thread(void* arg)
+{
+  stress_case_t* sc = (stress_case_t*) arg;
+  tu_fifo_t* ff = &sc->ff;
+  unsigned int rnd = 2;
+  uint32_t seq = 0;
+  uint8_t buf[CHUNK_MAX*4];
+
+  while (seq < STRESS_ITEMS)
+  {
+    uint16_t n = (uint16_t) (1 + rand_r(&rnd) % CHUNK_MAX);
+
+    if ( tu_fifo_count(ff) > ff->depth ) sc->errors++;
+    if ( tu_fifo_empty(ff) ) sched_yield();
+
+    switch (sc->mode)
+    {
+      case MODE_SINGLE:
+        if ( tu_fifo_read(ff, buf) )
+        {
+          if ( !item_check(sc, buf, seq) ) sc->errors++;
+          seq++;
+        }
+      break;
+
+      case MODE_N:
+        n = tu_fifo_read_n(ff, buf, n);
+        seq = span_check(sc, buf, n, seq);
+      break;
+
+      case MODE_ZC:
+      {
+        tu_fifo_buffer_info_t info;
+        n = tu_fifo_read_acquire(ff, &info, n);
+        if (n)
+        {
+          uint32_t s = span_check(sc, info.ptr_lin, info.len_lin, seq);
+          span_check(sc, info.ptr_wrap, info.len_wrap, s);
+          seq += tu_fifo_read_release(ff, n);
+        }
+      }
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+static bool run_case(stress_case_t* sc)
+{
+  pthread_t wr, rd;
+
+  memset(&sc->ff, 0, sizeof(sc->ff));
+  sc->errors = 0;
+  if ( !tu_fifo_config(&sc->ff, ff_buf, sc->depth, sc->item_size, false) )
+  {
+    printf("%-24s skipped\n", sc->name);
+    return true;
+  }
+
+  pthread_create(&rd, NULL, reader_thread, sc);
+  pthread_create(&wr, NULL, writer_thread, sc);
+  pthread_join(wr, NULL);
+  pthread_join(rd, NULL);
+
+  bool const ok = (sc->errors == 0) && tu_fifo_empty(&sc->ff);
+  printf("%-24s %s (%u errors)\n", sc->name, ok ? "OK" : "FAILED", (unsigned) sc->errors);
+  return ok;
+}
+
+int main(void)
+{
+  static stress_case_t cases[] =
+  {
+    { .name = "single depth 10"  , .depth = 10  , .item_size = 1, .mode = MODE_SINGLE },
+    { .name = "n depth 10"       , .depth = 10  , .item_size = 1, .mode = MODE_N      },
+    { .name = "n depth 64"       , .depth = 64  , .item_size = 1, .mode = MODE_N      },
+    { .name = "n depth 100"      , .depth = 100 , .item_size = 1, .mode = MODE_N      },
+    { .name = "n depth 64 u32"   , .depth = 64  , .item_size = 4, .mode = MODE_N      },
+    { .name = "n depth 1000 u32" , .depth = 1000, .item_size = 4, .mode = MODE_N      },
+    { .name = "zero-copy depth 64",  .depth = 64  , .item_size = 1, .mode = MODE_ZC  },
+    { .name = "zero-copy depth 100", .depth = 100 , .item_size = 4, .mode = MODE_ZC  },
+  };
+
+  bool ok = true;
+  for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++) ok = run_case(&cases[i]) && ok;
+
+  return ok ? 0 : 1;
+}
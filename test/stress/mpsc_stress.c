@@ -0,0 +1,220 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2021 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Multithreaded stress test for tu_fifo in multi producer/single consumer mode.
+// Several writer threads push tagged items into one FIFO while a reader thread
+// drains it concurrently. Each item carries the writer id, a per writer sequence
+// number and a check word, so the reader detects lost, duplicated, reordered and
+// torn items.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "tusb_fifo.h"
+
+#define WRITER_COUNT    4
+#define WRITER_ITEMS    (250u*1000u)
+#define CHUNK_MAX       13
+
+typedef enum
+{
+  MODE_SINGLE,  // tu_fifo_write()
+  MODE_N,       // tu_fifo_write_n()
+  MODE_IOV,     // tu_fifo_write_iov() with two segments
+} stress_mode_t;
+
+// Items are large so that writers spend most of their time copying and get preempted
+// with a claim in flight, the check word at the end detects torn items
+typedef struct
+{
+  uint32_t seq;
+  uint16_t id;
+  uint16_t check;
+  uint32_t payload[12];
+  uint32_t tail;
+} stress_item_t;
+
+typedef struct
+{
+  char const* name;
+  uint16_t depth;
+  stress_mode_t mode;
+
+  tu_fifo_t ff;
+  volatile uint32_t errors;
+} stress_case_t;
+
+typedef struct
+{
+  stress_case_t* sc;
+  uint16_t id;
+} writer_arg_t;
+
+static stress_item_t ff_buf[256];
+
+static inline uint16_t item_check_word(uint16_t id, uint32_t seq)
+{
+  return (uint16_t) ~(id ^ (seq * 2654435761u >> 16));
+}
+
+static inline void item_set(stress_item_t* item, uint16_t id, uint32_t seq)
+{
+  item->seq   = seq;
+  item->id    = id;
+  item->check = item_check_word(id, seq);
+  for(uint8_t i=0; i<TU_ARRAY_SIZE(item->payload); i++) item->payload[i] = seq + i;
+  item->tail  = ~seq;
+}
+
+static void* writer_thread(void* arg)
+{
+  writer_arg_t* wa = (writer_arg_t*) arg;
+  stress_case_t* sc = wa->sc;
+  tu_fifo_t* ff = &sc->ff;
+  unsigned int rnd = 1 + wa->id;
+  uint32_t seq = 0;
+  stress_item_t buf[CHUNK_MAX];
+
+  while (seq < WRITER_ITEMS)
+  {
+    uint16_t n = (uint16_t) (1 + rand_r(&rnd) % CHUNK_MAX);
+    if (n > WRITER_ITEMS - seq) n = (uint16_t) (WRITER_ITEMS - seq);
+
+    for(uint16_t i=0; i<n; i++) item_set(&buf[i], wa->id, seq+i);
+
+    uint16_t written = 0;
+    switch (sc->mode)
+    {
+      case MODE_SINGLE:
+        written = tu_fifo_write(ff, buf);
+      break;
+
+      case MODE_N:
+        written = tu_fifo_write_n(ff, buf, n);
+      break;
+
+      case MODE_IOV:
+      {
+        uint16_t const half = n/2;
+        tu_fifo_iovec_const_t const iov[2] = { { buf, half }, { buf + half, (uint16_t) (n - half) } };
+        written = tu_fifo_write_iov(ff, iov, 2);
+      }
+      break;
+    }
+
+    seq += written;
+
+    // let the others run if fifo is full, host may have a single core only
+    if ( written == 0 ) sched_yield();
+  }
+
+  return NULL;
+}
+
+static void* reader_thread(void* arg)
+{
+  stress_case_t* sc = (stress_case_t*) arg;
+  tu_fifo_t* ff = &sc->ff;
+  uint32_t expected[WRITER_COUNT] = { 0 };
+  uint32_t total = 0;
+  stress_item_t buf[CHUNK_MAX];
+
+  while (total < WRITER_COUNT*WRITER_ITEMS)
+  {
+    if ( tu_fifo_count(ff) > ff->depth ) sc->errors++;
+
+    uint16_t const n = tu_fifo_read_n(ff, buf, CHUNK_MAX);
+    if ( n == 0 ) sched_yield();
+
+    for(uint16_t i=0; i<n; i++)
+    {
+      stress_item_t const* item = &buf[i];
+
+      // items of each writer arrive complete and in order
+      if ( (item->id >= WRITER_COUNT) || (item->check != item_check_word(item->id, item->seq)) ||
+           (item->tail != ~item->seq) || (item->seq != expected[item->id]) )
+      {
+        sc->errors++;
+        continue;
+      }
+
+      expected[item->id]++;
+      total++;
+    }
+  }
+
+  return NULL;
+}
+
+static bool run_case(stress_case_t* sc)
+{
+  pthread_t wr[WRITER_COUNT], rd;
+  writer_arg_t wa[WRITER_COUNT];
+
+  memset(&sc->ff, 0, sizeof(sc->ff));
+  sc->errors = 0;
+  if ( !tu_fifo_config_mpsc(&sc->ff, ff_buf, sc->depth, sizeof(stress_item_t)) )
+  {
+    printf("%-24s skipped\n", sc->name);
+    return true;
+  }
+
+  pthread_create(&rd, NULL, reader_thread, sc);
+  for(uint16_t i=0; i<WRITER_COUNT; i++)
+  {
+    wa[i].sc = sc;
+    wa[i].id = i;
+    pthread_create(&wr[i], NULL, writer_thread, &wa[i]);
+  }
+
+  for(uint16_t i=0; i<WRITER_COUNT; i++) pthread_join(wr[i], NULL);
+  pthread_join(rd, NULL);
+
+  bool const ok = (sc->errors == 0) && tu_fifo_empty(&sc->ff);
+  printf("%-24s %s (%u errors)\n", sc->name, ok ? "OK" : "FAILED", (unsigned) sc->errors);
+  return ok;
+}
+
+int main(void)
+{
+  static stress_case_t cases[] =
+  {
+    { .name = "single depth 10" , .depth = 10 , .mode = MODE_SINGLE },
+    { .name = "n depth 10"      , .depth = 10 , .mode = MODE_N      },
+    { .name = "n depth 64"      , .depth = 64 , .mode = MODE_N      },
+    { .name = "n depth 100"     , .depth = 100, .mode = MODE_N      },
+    { .name = "iov depth 16"    , .depth = 16 , .mode = MODE_IOV    },
+    { .name = "iov depth 256"   , .depth = 256, .mode = MODE_IOV    },
+  };
+
+  bool ok = true;
+  for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); i++) ok = run_case(&cases[i]) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -28,6 +28,7 @@
 #include "tusb_fifo.h"
 #include "tusb.h"
 #include "usbd.h"
+#include "usbd_pvt.h"
 TEST_FILE("usbd_control.c")
 
 // Mock File
@@ -118,10 +119,100 @@ uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
   return NULL;
 }
 
+//--------------------------------------------------------------------+
+// Application driver to observe SOF and event order
+//--------------------------------------------------------------------+
+static char     event_seq[16];
+static uint8_t  event_seq_len;
+static uint32_t sof_frames;
+static uint32_t sof_legacy_calls;
+static uint32_t app_open_count;
+
+static void event_seq_add(char c)
+{
+  if ( event_seq_len < sizeof(event_seq) ) event_seq[event_seq_len++] = c;
+}
+
+static void app_drv_init(void) { }
+static void app_drv_reset(uint8_t rhport_) { (void) rhport_; }
+
+static uint16_t app_drv_open(uint8_t rhport_, tusb_desc_interface_t const * desc_intf, uint16_t max_len)
+{
+  (void) rhport_; (void) desc_intf; (void) max_len;
+  app_open_count++;
+  return 0;
+}
+
+static bool app_drv_control_xfer_cb(uint8_t rhport_, uint8_t stage, tusb_control_request_t const * request)
+{
+  (void) rhport_; (void) stage; (void) request;
+  return false;
+}
+
+static bool app_drv_xfer_cb(uint8_t rhport_, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  (void) rhport_; (void) ep_addr; (void) result; (void) xferred_bytes;
+  return false;
+}
+
+static void app_drv_sof(uint8_t rhport_, uint32_t frame_count)
+{
+  (void) rhport_;
+  sof_frames += frame_count;
+  event_seq_add('S');
+}
+
+static uint16_t app_drv_legacy_open(uint8_t rhport_, tusb_desc_interface_t const * desc_intf, uint16_t max_len)
+{
+  (void) rhport_; (void) desc_intf; (void) max_len;
+  return 0;
+}
+
+static void app_drv_legacy_sof(uint8_t rhport_)
+{
+  (void) rhport_;
+  sof_legacy_calls++;
+}
+
+static usbd_class_driver_t const app_driver[] =
+{
+  {
+  #if CFG_TUSB_DEBUG >= 2
+    .name            = "APP",
+  #endif
+    .init            = app_drv_init,
+    .reset           = app_drv_reset,
+    .open            = app_drv_open,
+    .control_xfer_cb = app_drv_control_xfer_cb,
+    .xfer_cb         = app_drv_xfer_cb,
+    .sof_frames      = app_drv_sof
+  },
+
+  // driver with the sof() callback, written before SOF coalescing
+  {
+  #if CFG_TUSB_DEBUG >= 2
+    .name            = "APP_LEGACY",
+  #endif
+    .init            = app_drv_init,
+    .reset           = app_drv_reset,
+    .open            = app_drv_legacy_open,
+    .control_xfer_cb = app_drv_control_xfer_cb,
+    .xfer_cb         = app_drv_xfer_cb,
+    .sof             = app_drv_legacy_sof
+  }
+};
+
+usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count)
+{
+  *driver_count = TU_ARRAY_SIZE(app_driver);
+  return app_driver;
+}
+
 void setUp(void)
 {
   dcd_int_disable_Ignore();
   dcd_int_enable_Ignore();
+  dcd_sof_enable_Ignore();
 
   if ( !tusb_inited() )
   {
@@ -241,3 +332,669 @@ void test_usbd_control_in_zlp(void)
 
   tud_task();
 }
+
+//--------------------------------------------------------------------+
+// Endpoint transfer queue
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_MSC_OUT = 0x01,
+  EDPT_MSC_IN  = 0x81
+};
+
+uint8_t const data_desc_configuration_msc[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN, 0, 100),
+
+  // Interface number, string index, EP Out & EP In address, EP size
+  TUD_MSC_DESCRIPTOR(0, 0, EDPT_MSC_OUT, EDPT_MSC_IN, 64),
+};
+
+tusb_control_request_t const req_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest = TUSB_REQ_SET_CONFIGURATION,
+  .wValue = 1,
+  .wIndex = 0x0000,
+  .wLength = 0
+};
+
+// bind MSC interface so that completions on its endpoints are dispatched to mscd_xfer_cb()
+static void set_configuration_msc(void)
+{
+  if ( tud_mounted() ) return;
+
+  // bus reset to start from a clean interface & endpoint mapping
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  mscd_reset_Expect(rhport);
+
+  desc_configuration = data_desc_configuration_msc;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, false);
+
+  mscd_open_ExpectAndReturn(rhport, (tusb_desc_interface_t const*) (data_desc_configuration_msc + TUD_CONFIG_DESC_LEN),
+                            TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+
+  // status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_set_configuration, 1);
+
+  tud_task();
+  TEST_ASSERT_TRUE(tud_mounted());
+}
+
+void test_usbd_edpt_xfer_queue(void)
+{
+  uint8_t buf[3][64] = { { 1 }, { 2 }, { 3 } };
+
+  set_configuration_msc();
+
+  // only the first transfer is armed, the rest is queued
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[0], 64, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[0], 64) );
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[1], 64) );
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[2], 32) );
+
+  // queue is full
+  TEST_ASSERT_FALSE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_IN, buf[0], 64) );
+  TEST_ASSERT_EQUAL(3, usbd_edpt_queue_count(rhport, EDPT_MSC_IN));
+  TEST_ASSERT_TRUE( usbd_edpt_busy(rhport, EDPT_MSC_IN) );
+
+  // next transfer is armed from the completion interrupt without waiting for tud_task()
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[1], 64, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf[2], 32, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 32, XFER_RESULT_SUCCESS, true);
+
+  // completions are reported in submission order
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 64, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 64, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 32, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(0, usbd_edpt_queue_count(rhport, EDPT_MSC_IN));
+  TEST_ASSERT_FALSE( usbd_edpt_busy(rhport, EDPT_MSC_IN) );
+}
+
+void test_usbd_edpt_xfer_queue_arm_failed(void)
+{
+  uint8_t buf[3][64] = { { 1 }, { 2 }, { 3 } };
+
+  set_configuration_msc();
+
+  // endpoint busy with a non queued transfer
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, buf[0], 64, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_OUT, buf[0], 64) );
+  TEST_ASSERT_FALSE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_OUT, buf[1], 64) );
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, 64, XFER_RESULT_SUCCESS, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_OUT, XFER_RESULT_SUCCESS, 64, true);
+  tud_task();
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, buf[0], 64, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_OUT, buf[0], 64) );
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_OUT, buf[1], 64) );
+  TEST_ASSERT_TRUE( usbd_edpt_xfer_queue(rhport, EDPT_MSC_OUT, buf[2], 64) );
+
+  // DCD refuses the next transfer: every remaining one is completed as failed
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, buf[1], 64, false);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, 64, XFER_RESULT_SUCCESS, true);
+
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_OUT, XFER_RESULT_SUCCESS, 64, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_OUT, XFER_RESULT_FAILED, 0, true);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_OUT, XFER_RESULT_FAILED, 0, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(0, usbd_edpt_queue_count(rhport, EDPT_MSC_OUT));
+  TEST_ASSERT_FALSE( usbd_edpt_busy(rhport, EDPT_MSC_OUT) );
+}
+
+//--------------------------------------------------------------------+
+// Transfer larger than 64 KB
+//--------------------------------------------------------------------+
+
+// chunk size used by usbd to split transfers for dcd_edpt_xfer(): whole 64 byte packets
+#define XFER_CHUNK  65472
+
+// chunk size is derived from the packet size when the (mocked) driver opens the endpoint
+static void open_msc_edpt(uint8_t ep_addr)
+{
+  uint8_t const* desc = data_desc_configuration_msc + TUD_CONFIG_DESC_LEN + sizeof(tusb_desc_interface_t);
+  if ( ep_addr == EDPT_MSC_IN ) desc += sizeof(tusb_desc_endpoint_t);
+
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const*) desc, true);
+  TEST_ASSERT_TRUE( usbd_edpt_open(rhport, (tusb_desc_endpoint_t const*) desc) );
+}
+
+void test_usbd_edpt_xfer_chunked(void)
+{
+  static uint8_t buf[2*XFER_CHUNK + 20976];
+  uint32_t const total = sizeof(buf);
+
+  buf[0] = 1; buf[XFER_CHUNK] = 2; buf[2*XFER_CHUNK] = 3;
+
+  set_configuration_msc();
+  open_msc_edpt(EDPT_MSC_IN);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf, XFER_CHUNK, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_IN, buf, total) );
+
+  // next chunks are submitted from completion, without going through tud_task()
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf + XFER_CHUNK, XFER_CHUNK, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, XFER_CHUNK, XFER_RESULT_SUCCESS, true);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf + 2*XFER_CHUNK, 20976, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, XFER_CHUNK, XFER_RESULT_SUCCESS, true);
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 20976, XFER_RESULT_SUCCESS, true);
+
+  // single completion for the whole transfer
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, total, true);
+  tud_task();
+
+  TEST_ASSERT_FALSE( usbd_edpt_busy(rhport, EDPT_MSC_IN) );
+}
+
+void test_usbd_edpt_xfer_chunked_short_packet(void)
+{
+  static uint8_t buf[2*XFER_CHUNK];
+
+  set_configuration_msc();
+  open_msc_edpt(EDPT_MSC_OUT);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, buf, XFER_CHUNK, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_OUT, buf, sizeof(buf)) );
+
+  // short packet ends the transfer early
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, buf + XFER_CHUNK, XFER_CHUNK, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, XFER_CHUNK, XFER_RESULT_SUCCESS, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, 100, XFER_RESULT_SUCCESS, true);
+
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_OUT, XFER_RESULT_SUCCESS, XFER_CHUNK + 100, true);
+  tud_task();
+
+  TEST_ASSERT_FALSE( usbd_edpt_busy(rhport, EDPT_MSC_OUT) );
+}
+
+void test_usbd_edpt_xfer_chunked_packet_size(void)
+{
+  static uint8_t buf[70000];
+  uint8_t const ep_addr = 0x83;
+  tusb_desc_endpoint_t const desc_ep =
+  {
+    .bLength          = sizeof(tusb_desc_endpoint_t),
+    .bDescriptorType  = TUSB_DESC_ENDPOINT,
+    .bEndpointAddress = ep_addr,
+    .bmAttributes     = { .xfer = TUSB_XFER_INTERRUPT },
+    .wMaxPacketSize   = 48,
+    .bInterval        = 1
+  };
+
+  set_configuration_msc();
+
+  dcd_edpt_open_ExpectAndReturn(rhport, &desc_ep, true);
+  TEST_ASSERT_TRUE( usbd_edpt_open(rhport, &desc_ep) );
+
+  // chunks are a multiple of a packet size that is not a power of two: 1365 * 48
+  dcd_edpt_xfer_ExpectAndReturn(rhport, ep_addr, buf, 65520, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, ep_addr, buf, sizeof(buf)) );
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, ep_addr, buf + 65520, sizeof(buf) - 65520, true);
+  dcd_event_xfer_complete(rhport, ep_addr, 65520, XFER_RESULT_SUCCESS, true);
+}
+
+//--------------------------------------------------------------------+
+// ISR completion hook & latency
+//--------------------------------------------------------------------+
+
+static uint32_t timestamp;
+static uint32_t isr_cb_count;
+static uint32_t isr_cb_len;
+static bool     isr_cb_busy;
+
+uint32_t tud_latency_timestamp_cb(void)
+{
+  return timestamp;
+}
+
+static void edpt_isr_cb(uint8_t rhport_, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  isr_cb_count++;
+  isr_cb_len  = xferred_bytes;
+  isr_cb_busy = usbd_edpt_busy(rhport_, ep_addr);
+  timestamp  += 5;
+}
+
+void test_usbd_edpt_isr_cb(void)
+{
+  uint8_t buf[64] = { 1 };
+  tud_edpt_latency_t lat;
+
+  set_configuration_msc();
+  tud_edpt_latency_reset();
+  isr_cb_count = 0;
+
+  TEST_ASSERT_TRUE( usbd_edpt_isr_cb_set(rhport, EDPT_MSC_IN, edpt_isr_cb) );
+
+  // completion in ISR is handed over right away, endpoint is ready to be re-armed from the hook
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf, 64, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_IN, buf, 64) );
+
+  timestamp = 100;
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_EQUAL(1, isr_cb_count);
+  TEST_ASSERT_EQUAL(64, isr_cb_len);
+  TEST_ASSERT_FALSE(isr_cb_busy);
+  TEST_ASSERT_FALSE( tud_task_event_ready() );
+
+  tud_edpt_latency_get(EDPT_MSC_IN, &lat);
+  TEST_ASSERT_EQUAL(1, lat.count);
+  TEST_ASSERT_EQUAL(0, lat.max);
+
+  // completion outside of ISR still goes through tud_task() and xfer_cb()
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf, 32, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_IN, buf, 32) );
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 32, XFER_RESULT_SUCCESS, false);
+  timestamp += 20;
+
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 32, true);
+  tud_task();
+  TEST_ASSERT_EQUAL(1, isr_cb_count);
+
+  tud_edpt_latency_get(EDPT_MSC_IN, &lat);
+  TEST_ASSERT_EQUAL(2, lat.count);
+  TEST_ASSERT_EQUAL(20, lat.total);
+  TEST_ASSERT_EQUAL(20, lat.max);
+
+  TEST_ASSERT_TRUE( usbd_edpt_isr_cb_set(rhport, EDPT_MSC_IN, NULL) );
+}
+
+//--------------------------------------------------------------------+
+// Event priority
+//--------------------------------------------------------------------+
+
+static void deferred_func(void* param)
+{
+  (void) param;
+  event_seq_add('F');
+}
+
+static bool msc_xfer_cb_seq(uint8_t rhport_, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes, int num_calls)
+{
+  (void) rhport_; (void) ep_addr; (void) result; (void) xferred_bytes; (void) num_calls;
+  event_seq_add('X');
+  return true;
+}
+
+void test_usbd_event_priority(void)
+{
+  uint8_t buf[64] = { 1 };
+  tud_task_stats_t stats;
+
+  set_configuration_msc();
+  tud_task_stats_reset();
+  event_seq_len = 0;
+  sof_frames    = 0;
+  sof_legacy_calls = 0;
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, buf, 64, true);
+  TEST_ASSERT_TRUE( usbd_edpt_xfer(rhport, EDPT_MSC_IN, buf, 64) );
+
+  // post from lowest to highest priority, SOFs are coalesced into one event
+  dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+  usbd_defer_func(deferred_func, NULL, true);
+  dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+  dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+
+  desc_device = (uint8_t const *) &data_desc_device;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_get_desc_device, true);
+
+  tud_task_stats_get(&stats);
+  TEST_ASSERT_EQUAL(2, stats.sof_coalesced);
+
+  // deferred call & setup in posting order, then transfer complete, then SOF
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_CTRL_IN, (uint8_t*)&data_desc_device, sizeof(tusb_desc_device_t), sizeof(tusb_desc_device_t), true);
+  mscd_xfer_cb_AddCallback(msc_xfer_cb_seq);
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 64, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(3, event_seq_len);
+  TEST_ASSERT_EQUAL_CHAR_ARRAY("FXS", event_seq, 3);
+  TEST_ASSERT_EQUAL(3, sof_frames);
+  TEST_ASSERT_EQUAL(3, sof_legacy_calls);
+
+  // finish control transfer
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_OUT, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, sizeof(tusb_desc_device_t), 0, false);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_OUT, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_get_desc_device, 1);
+  tud_task();
+}
+
+void test_usbd_event_overflow(void)
+{
+  tud_task_stats_t stats;
+
+  tud_task_stats_reset();
+  event_seq_len = 0;
+
+  for(uint8_t i=0; i<CFG_TUD_TASK_QUEUE_HIGH_SZ+2; i++)
+  {
+    usbd_defer_func(deferred_func, NULL, true);
+  }
+
+  tud_task_stats_get(&stats);
+  TEST_ASSERT_EQUAL(2, stats.overflow[TUD_EVENT_PRIO_HIGH]);
+  TEST_ASSERT_EQUAL(0, stats.overflow[TUD_EVENT_PRIO_XFER]);
+  TEST_ASSERT_EQUAL(0, stats.overflow[TUD_EVENT_PRIO_LOW]);
+
+  tud_task();
+  TEST_ASSERT_EQUAL(CFG_TUD_TASK_QUEUE_HIGH_SZ, event_seq_len);
+}
+
+//--------------------------------------------------------------------+
+// Endpoint context
+//--------------------------------------------------------------------+
+
+void test_usbd_edpt_ctx(void)
+{
+  static uint32_t itf_ctx;
+
+  tusb_desc_endpoint_t const desc_ep =
+  {
+    .bLength          = sizeof(tusb_desc_endpoint_t),
+    .bDescriptorType  = TUSB_DESC_ENDPOINT,
+    .bEndpointAddress = 0x82,
+    .bmAttributes     = { .xfer = TUSB_XFER_BULK },
+    .wMaxPacketSize   = 64,
+    .bInterval        = 0
+  };
+
+  set_configuration_msc();
+
+  dcd_edpt_open_ExpectAndReturn(rhport, &desc_ep, true);
+  TEST_ASSERT_TRUE( usbd_edpt_open_ctx(rhport, &desc_ep, &itf_ctx) );
+
+  TEST_ASSERT_EQUAL_PTR(&itf_ctx, usbd_edpt_ctx(rhport, 0x82));
+  TEST_ASSERT_NULL( usbd_edpt_ctx(rhport, 0x02) );
+
+  // context is dropped when endpoint is closed
+  dcd_edpt_close_Expect(rhport, 0x82);
+  usbd_edpt_close(rhport, 0x82);
+  TEST_ASSERT_NULL( usbd_edpt_ctx(rhport, 0x82) );
+}
+
+//--------------------------------------------------------------------+
+// SOF Timer
+//--------------------------------------------------------------------+
+
+static void timer_cb(uint8_t rhport_, void* ctx)
+{
+  (void) rhport_;
+  (*(uint8_t*) ctx)++;
+}
+
+static void sof_frames_process(uint32_t count)
+{
+  for(uint32_t i=0; i<count; i++) dcd_event_bus_signal(rhport, DCD_EVENT_SOF, true);
+  tud_task();
+}
+
+void test_usbd_sof_timer(void)
+{
+  static usbd_timer_t timer_oneshot, timer_periodic, timer_long;
+  static uint8_t oneshot_count, periodic_count, long_count;
+
+  set_configuration_msc();
+  oneshot_count = periodic_count = long_count = 0;
+
+  TEST_ASSERT_TRUE( usbd_timer_start(rhport, &timer_oneshot , timer_cb, &oneshot_count , 3, 0) );
+  TEST_ASSERT_TRUE( usbd_timer_start(rhport, &timer_periodic, timer_cb, &periodic_count, 2, 2) );
+  TEST_ASSERT_TRUE( usbd_timer_start(rhport, &timer_long    , timer_cb, &long_count    , 2*CFG_TUD_TIMER_WHEEL_SZ + 8, 0) );
+
+  sof_frames_process(1);
+  TEST_ASSERT_EQUAL(0, oneshot_count);
+  TEST_ASSERT_EQUAL(0, periodic_count);
+
+  sof_frames_process(1);
+  TEST_ASSERT_EQUAL(0, oneshot_count);
+  TEST_ASSERT_EQUAL(1, periodic_count);
+
+  // coalesced SOFs fire each periodic expiry within them once
+  sof_frames_process(2);
+  TEST_ASSERT_EQUAL(1, oneshot_count);
+  TEST_ASSERT_EQUAL(2, periodic_count);
+  TEST_ASSERT_FALSE( usbd_timer_armed(&timer_oneshot) );
+  TEST_ASSERT_TRUE( usbd_timer_armed(&timer_periodic) );
+
+  usbd_timer_stop(rhport, &timer_periodic);
+  TEST_ASSERT_FALSE( usbd_timer_armed(&timer_periodic) );
+
+  // long timer shares its slot with earlier rounds
+  sof_frames_process(CFG_TUD_TIMER_WHEEL_SZ);
+  TEST_ASSERT_EQUAL(2, periodic_count);
+  TEST_ASSERT_EQUAL(0, long_count);
+  TEST_ASSERT_TRUE( usbd_timer_armed(&timer_long) );
+
+  // burst longer than a wheel turn
+  sof_frames_process(2*CFG_TUD_TIMER_WHEEL_SZ);
+  TEST_ASSERT_EQUAL(1, long_count);
+  TEST_ASSERT_FALSE( usbd_timer_armed(&timer_long) );
+
+  // bus reset disarms all timers
+  TEST_ASSERT_TRUE( usbd_timer_start(rhport, &timer_periodic, timer_cb, &periodic_count, 1, 1) );
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  mscd_reset_Expect(rhport);
+  tud_task();
+  TEST_ASSERT_FALSE( usbd_timer_armed(&timer_periodic) );
+
+  sof_frames_process(4);
+  TEST_ASSERT_EQUAL(2, periodic_count);
+}
+
+//--------------------------------------------------------------------+
+// Task
+//--------------------------------------------------------------------+
+
+void test_usbd_task_wakeup(void)
+{
+  tud_task_stats_t stats;
+
+  tud_task_stats_reset();
+  TEST_ASSERT_FALSE( tud_task_event_ready() );
+
+  TEST_ASSERT_TRUE( tud_task_wakeup(true) );
+  TEST_ASSERT_TRUE( tud_task_event_ready() );
+
+  // non-blocking from isr, drains the wake up
+  tud_task_ext(100, true);
+  TEST_ASSERT_FALSE( tud_task_event_ready() );
+
+  // at most one wake up is queued, repeated wake ups can't fill the transfer queue
+  for(uint32_t i=0; i<CFG_TUD_TASK_QUEUE_SZ+1; i++) TEST_ASSERT_TRUE( tud_task_wakeup(false) );
+  tud_task_stats_get(&stats);
+  TEST_ASSERT_EQUAL(0, stats.overflow[TUD_EVENT_PRIO_HIGH]);
+  TEST_ASSERT_EQUAL(0, stats.overflow[TUD_EVENT_PRIO_XFER]);
+
+  tud_task();
+  TEST_ASSERT_FALSE( tud_task_event_ready() );
+
+  // processed wake up allows the next one
+  TEST_ASSERT_TRUE( tud_task_wakeup(false) );
+  TEST_ASSERT_TRUE( tud_task_event_ready() );
+  tud_task();
+}
+
+void test_usbd_xfer_stale_after_set_config(void)
+{
+  tusb_control_request_t const req_set_config0 =
+  {
+    .bmRequestType = 0x00,
+    .bRequest = TUSB_REQ_SET_CONFIGURATION,
+    .wValue = 0,
+    .wIndex = 0x0000,
+    .wLength = 0
+  };
+
+  set_configuration_msc();
+
+  // completion is still queued when host selects configuration 0 then 1 again
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_config0, true);
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, true);
+
+  dcd_edpt_close_all_Expect(rhport);
+  mscd_reset_Expect(rhport);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+
+  mscd_open_ExpectAndReturn(rhport, (tusb_desc_interface_t const*) (data_desc_configuration_msc + TUD_CONFIG_DESC_LEN),
+                            TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+
+  // completion belongs to the closed endpoint: not dispatched to MSC opened by the new configuration
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_set_configuration, 1);
+  tud_task();
+  TEST_ASSERT_TRUE(tud_mounted());
+
+  // completions after the endpoint is reopened are dispatched
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 13, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 13, XFER_RESULT_SUCCESS, false);
+  tud_task();
+}
+
+void test_usbd_xfer_stale_after_bus_reset(void)
+{
+  set_configuration_msc();
+
+  // completion and wake up are still queued when bus is reset, bus events are processed first
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 64, XFER_RESULT_SUCCESS, true);
+  TEST_ASSERT_TRUE( tud_task_wakeup(true) );
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, true);
+
+  // completion is dropped instead of reaching the reset driver, wake up is still processed
+  mscd_reset_Expect(rhport);
+  tud_task();
+  TEST_ASSERT_FALSE( tud_task_event_ready() );
+  TEST_ASSERT_TRUE( tud_task_wakeup(true) );
+  tud_task();
+}
+
+//--------------------------------------------------------------------+
+// Binding cache
+//--------------------------------------------------------------------+
+
+static void bus_reset_set_config_msc(uint16_t msc_len)
+{
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  mscd_reset_Expect(rhport);
+
+  desc_configuration = data_desc_configuration_msc;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, false);
+
+  mscd_open_ExpectAndReturn(rhport, (tusb_desc_interface_t const*) (data_desc_configuration_msc + TUD_CONFIG_DESC_LEN),
+                            TUD_MSC_DESC_LEN, msc_len);
+}
+
+static void set_config_status(void)
+{
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_set_configuration, 1);
+
+  tud_task();
+  TEST_ASSERT_TRUE(tud_mounted());
+}
+
+void test_usbd_bind_cache(void)
+{
+  // first configuration probes all drivers
+  bus_reset_set_config_msc(TUD_MSC_DESC_LEN);
+  set_config_status();
+
+  // same configuration again: only MSC is opened
+  app_open_count = 0;
+  bus_reset_set_config_msc(TUD_MSC_DESC_LEN);
+  set_config_status();
+  TEST_ASSERT_EQUAL(0, app_open_count);
+
+  // endpoints are bound without parsing the descriptor
+  mscd_xfer_cb_ExpectAndReturn(rhport, EDPT_MSC_IN, XFER_RESULT_SUCCESS, 13, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 13, XFER_RESULT_SUCCESS, false);
+  tud_task();
+
+  // driver claims a different length: reset and probe again
+  bus_reset_set_config_msc(TUD_MSC_DESC_LEN - 1);
+  dcd_edpt_close_all_Expect(rhport);
+  mscd_reset_Expect(rhport);
+  mscd_open_ExpectAndReturn(rhport, (tusb_desc_interface_t const*) (data_desc_configuration_msc + TUD_CONFIG_DESC_LEN),
+                            TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+  set_config_status();
+  TEST_ASSERT_EQUAL(1, app_open_count);
+}
+
+void test_usbd_bind_cache_mismatch_keeps_state(void)
+{
+  static uint8_t const desc_cfg_remote_wakeup[] =
+  {
+    TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+    TUD_MSC_DESCRIPTOR(0, 0, EDPT_MSC_OUT, EDPT_MSC_IN, 64),
+  };
+
+  tusb_control_request_t const req_set_remote_wakeup =
+  {
+    .bmRequestType = 0x00,
+    .bRequest = TUSB_REQ_SET_FEATURE,
+    .wValue = TUSB_REQ_FEATURE_REMOTE_WAKEUP,
+    .wIndex = 0x0000,
+    .wLength = 0
+  };
+
+  tusb_desc_interface_t const* desc_msc = (tusb_desc_interface_t const*) (desc_cfg_remote_wakeup + TUD_CONFIG_DESC_LEN);
+  desc_configuration = desc_cfg_remote_wakeup;
+
+  // first configuration computes the plan
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  mscd_reset_Expect(rhport);
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, false);
+  mscd_open_ExpectAndReturn(rhport, desc_msc, TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+  set_config_status();
+
+  // re-enumeration, host enables remote wakeup before configuring
+  dcd_event_bus_reset(rhport, TUSB_SPEED_FULL, false);
+  mscd_reset_Expect(rhport);
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_remote_wakeup, false);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_set_remote_wakeup, 1);
+  tud_task();
+
+  // driver claims a different length: fall back to probing
+  dcd_event_setup_received(rhport, (uint8_t*) &req_set_configuration, false);
+  mscd_open_ExpectAndReturn(rhport, desc_msc, TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN - 1);
+  dcd_edpt_close_all_Expect(rhport);
+  mscd_reset_Expect(rhport);
+  mscd_open_ExpectAndReturn(rhport, desc_msc, TUD_MSC_DESC_LEN, TUD_MSC_DESC_LEN);
+  set_config_status();
+
+  // device state is kept by the fallback: still connected, remote wakeup supported & enabled
+  dcd_event_bus_signal(rhport, DCD_EVENT_SUSPEND, false);
+  tud_task();
+
+  dcd_remote_wakeup_Expect(rhport);
+  TEST_ASSERT_TRUE( tud_remote_wakeup() );
+
+  dcd_event_bus_signal(rhport, DCD_EVENT_RESUME, false);
+  tud_task();
+}
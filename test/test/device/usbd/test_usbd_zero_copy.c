@@ -0,0 +1,200 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "unity.h"
+
+// Files to test
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+#include "usbd_pvt.h"
+TEST_FILE("usbd_control.c")
+
+// Mock File
+#include "mock_dcd.h"
+#include "mock_msc_device.h"
+
+// built with CFG_TUD_CONTROL_ZERO_COPY=1 (see project.yml), control stages ending in one transfer
+TU_VERIFY_STATIC(CFG_TUD_CONTROL_ZERO_COPY, "test requires CFG_TUD_CONTROL_ZERO_COPY");
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CTRL_OUT = 0x00,
+  EDPT_CTRL_IN  = 0x80
+};
+
+uint8_t const rhport = 0;
+
+tusb_control_request_t const req_get_desc_configuration =
+{
+  .bmRequestType = 0x80,
+  .bRequest = TUSB_REQ_GET_DESCRIPTOR,
+  .wValue = (TUSB_DESC_CONFIGURATION << 8),
+  .wIndex = 0x0000,
+  .wLength = 256
+};
+
+uint8_t const* desc_configuration;
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  return desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) langid;
+
+  return NULL;
+}
+
+static TU_ATTR_ALIGNED(4) uint8_t vendor_out_buf[CFG_TUD_ENDPOINT0_SIZE*4];
+static uint8_t vendor_out_data_stage;
+
+bool tud_vendor_control_xfer_cb(uint8_t rhport_, uint8_t stage, tusb_control_request_t const * request)
+{
+  if ( stage == CONTROL_STAGE_SETUP ) return tud_control_xfer(rhport_, request, vendor_out_buf, request->wLength);
+  if ( stage == CONTROL_STAGE_DATA  ) vendor_out_data_stage++;
+  return true;
+}
+
+void setUp(void)
+{
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+
+  if ( !tusb_inited() )
+  {
+    mscd_init_Expect();
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Control IN
+//--------------------------------------------------------------------+
+
+void test_usbd_control_in_zero_copy(void)
+{
+  // aligned descriptor is sent with one transfer, then ZLP since request length is larger
+  TU_ATTR_ALIGNED(4) uint8_t desc[CFG_TUD_ENDPOINT0_SIZE*2] =
+  {
+    // Config number, interface count, string index, total length, attribute, power in mA
+    TUD_CONFIG_DESCRIPTOR(1, 0, 0, CFG_TUD_ENDPOINT0_SIZE*2, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+  };
+
+  desc_configuration = desc;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_get_desc_configuration, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, desc, sizeof(desc), true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, sizeof(desc), 0, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_OUT, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_OUT, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_get_desc_configuration, 1);
+
+  tud_task();
+}
+
+void test_usbd_control_in_zero_copy_misaligned(void)
+{
+  // misaligned descriptor still goes through bounce buffer packet by packet, then ZLP
+  TU_ATTR_ALIGNED(4) uint8_t desc_storage[CFG_TUD_ENDPOINT0_SIZE*2 + 1] =
+  {
+    0,
+    // Config number, interface count, string index, total length, attribute, power in mA
+    TUD_CONFIG_DESCRIPTOR(1, 0, 0, CFG_TUD_ENDPOINT0_SIZE*2, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+  };
+  uint8_t* desc = desc_storage + 1;
+
+  desc_configuration = desc;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_get_desc_configuration, false);
+
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_CTRL_IN, desc, CFG_TUD_ENDPOINT0_SIZE, CFG_TUD_ENDPOINT0_SIZE, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, CFG_TUD_ENDPOINT0_SIZE, 0, false);
+
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_CTRL_IN, desc + CFG_TUD_ENDPOINT0_SIZE, CFG_TUD_ENDPOINT0_SIZE,
+                                         CFG_TUD_ENDPOINT0_SIZE, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, CFG_TUD_ENDPOINT0_SIZE, 0, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_OUT, NULL, 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_OUT, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_get_desc_configuration, 1);
+
+  tud_task();
+}
+
+//--------------------------------------------------------------------+
+// Control OUT
+//--------------------------------------------------------------------+
+
+void test_usbd_control_out_zero_copy_short(void)
+{
+  tusb_control_request_t const req_vendor_out =
+  {
+    .bmRequestType = 0x40, // vendor, device, OUT
+    .bRequest      = 0x01,
+    .wValue        = 0,
+    .wIndex        = 0,
+    .wLength       = sizeof(vendor_out_buf)
+  };
+
+  vendor_out_data_stage = 0;
+  dcd_event_setup_received(rhport, (uint8_t*) &req_vendor_out, false);
+
+  // whole data stage in one transfer, host ends it early with a ZLP after 2 full packets
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_OUT, vendor_out_buf, sizeof(vendor_out_buf), true);
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_OUT, 2*CFG_TUD_ENDPOINT0_SIZE, 0, false);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+  TEST_ASSERT_EQUAL(1, vendor_out_data_stage);
+
+  dcd_event_xfer_complete(rhport, EDPT_CTRL_IN, 0, 0, false);
+  dcd_edpt0_status_complete_ExpectWithArray(rhport, &req_vendor_out, 1);
+  tud_task();
+}
@@ -74,7 +74,15 @@
 //--------------------------------------------------------------------
 
 #define CFG_TUD_TASK_QUEUE_SZ    100
+#define CFG_TUD_TASK_QUEUE_HIGH_SZ 16
+#define CFG_TUD_TASK_QUEUE_LOW_SZ  4
+#define CFG_TUD_TIMER_WHEEL_SZ     8
 #define CFG_TUD_ENDPOINT0_SIZE    64
+#define CFG_TUD_BIND_CACHE        1
+#define CFG_TUD_EDPT_QUEUE_SZ     2
+#define CFG_TUD_EDPT_XFER_CHUNK   1
+#define CFG_TUD_EDPT_ISR_CB       1
+#define CFG_TUD_EDPT_LATENCY      1
 
 //------------- CLASS -------------//
 //#define CFG_TUD_CDC              0
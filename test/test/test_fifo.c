@@ -33,6 +33,7 @@ TU_FIFO_DEF(tu_ff, FIFO_SIZE, uint8_t, false);
 tu_fifo_t* ff = &tu_ff;
 tu_fifo_buffer_info_t info;
 
+// Overwriting, write info/reserve and records are not available with multiple writers
 void setUp(void)
 {
   tu_fifo_clear(ff);
@@ -207,6 +208,7 @@ void test_get_read_info_when_wrapped()
 
 void test_get_write_info_when_no_wrap()
 {
+
   uint8_t ch = 1;
 
   // write 2 items
@@ -225,6 +227,7 @@ void test_get_write_info_when_no_wrap()
 
 void test_get_write_info_when_wrapped()
 {
+
   uint8_t ch = 1;
 
   // write 6 items
@@ -245,6 +248,7 @@ void test_get_write_info_when_wrapped()
 
 void test_empty(void)
 {
+
   uint8_t temp;
   TEST_ASSERT_TRUE(tu_fifo_empty(ff));
 
@@ -295,11 +299,12 @@ void test_full(void)
 
 void test_rd_idx_wrap()
 {
+
   tu_fifo_t ff10;
   uint8_t buf[10];
   uint8_t dst[10];
 
-  tu_fifo_config(&ff10, buf, 10, 1, 1);
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff10, buf, 10, 1, 1));
 
   uint16_t n;
 
@@ -315,4 +320,374 @@ void test_rd_idx_wrap()
   n = tu_fifo_read_n(&ff10, dst, 4);
   TEST_ASSERT_EQUAL(n, 2);
   TEST_ASSERT_EQUAL(ff10.rd_idx, 6);
-}
\ No newline at end of file
+}
+
+void test_pow2_wrap(void)
+{
+  tu_fifo_t ff8;
+  uint8_t buf[8];
+  uint8_t data[20];
+  uint8_t rd[20];
+
+  for(uint8_t i=0; i<sizeof(data); i++) data[i] = i;
+
+  tu_fifo_config(&ff8, buf, 8, 1, false);
+  TEST_ASSERT_TRUE(ff8.pow2);
+
+  // push the absolute pointers around the 2*depth index space a few times
+  for(uint8_t loop=0; loop<5; loop++)
+  {
+    TEST_ASSERT_EQUAL(5, tu_fifo_write_n(&ff8, data, 5));
+    TEST_ASSERT_EQUAL(5, tu_fifo_count(&ff8));
+    TEST_ASSERT_EQUAL(3, tu_fifo_write_n(&ff8, data+5, 10));
+    TEST_ASSERT_TRUE(tu_fifo_full(&ff8));
+
+    TEST_ASSERT_EQUAL(8, tu_fifo_read_n(&ff8, rd, 20));
+    TEST_ASSERT_EQUAL_MEMORY(data, rd, 8);
+    TEST_ASSERT_TRUE(tu_fifo_empty(&ff8));
+    TEST_ASSERT_TRUE(ff8.wr_idx < 16);
+  }
+}
+
+void test_pow2_overflow(void)
+{
+
+  tu_fifo_t ff8;
+  uint8_t buf[8];
+  uint8_t rd[8];
+
+  tu_fifo_config(&ff8, buf, 8, 1, true);
+
+  for(uint8_t i=0; i<11; i++) tu_fifo_write(&ff8, &i);
+
+  TEST_ASSERT_TRUE(tu_fifo_overflowed(&ff8));
+  TEST_ASSERT_EQUAL(8, tu_fifo_count(&ff8));
+
+  // read corrects read pointer and only gets the latest items
+  TEST_ASSERT_EQUAL(8, tu_fifo_read_n(&ff8, rd, 8));
+  for(uint8_t i=0; i<8; i++) TEST_ASSERT_EQUAL(i+3, rd[i]);
+}
+
+void test_write_reserve_commit(void)
+{
+
+  uint8_t data[FIFO_SIZE];
+  uint8_t rd[FIFO_SIZE];
+  for(uint8_t i=0; i<FIFO_SIZE; i++) data[i] = i;
+
+  // move pointers so that a reservation wraps: wr = 6, rd = 6
+  tu_fifo_write_n(ff, data, 6);
+  tu_fifo_read_n(ff, rd, 6);
+
+  TEST_ASSERT_EQUAL(8, tu_fifo_write_reserve(ff, &info, 8));
+  TEST_ASSERT_EQUAL(FIFO_SIZE-6, info.len_lin);
+  TEST_ASSERT_EQUAL(4, info.len_wrap);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer+6, info.ptr_lin);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer, info.ptr_wrap);
+
+  // nothing is visible before commit
+  memcpy(info.ptr_lin, data, info.len_lin);
+  memcpy(info.ptr_wrap, data+info.len_lin, info.len_wrap);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // commit less than reserved
+  TEST_ASSERT_EQUAL(7, tu_fifo_write_commit(ff, 7));
+  TEST_ASSERT_EQUAL(7, tu_fifo_count(ff));
+
+  TEST_ASSERT_EQUAL(7, tu_fifo_read_n(ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(data, rd, 7);
+
+  // commit without reservation does nothing
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_commit(ff, 3));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_write_reserve_full(void)
+{
+
+  uint8_t data[FIFO_SIZE] = { 0 };
+  tu_fifo_write_n(ff, data, FIFO_SIZE);
+
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_reserve(ff, &info, 1));
+  TEST_ASSERT_EQUAL(0, info.len_lin);
+  TEST_ASSERT_NULL(info.ptr_lin);
+}
+
+void test_write_reserve_cleared(void)
+{
+
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_reserve(ff, &info, 4));
+
+  // a clear in between drops the reservation
+  tu_fifo_clear(ff);
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_commit(ff, 4));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_read_acquire_release(void)
+{
+  uint8_t data[FIFO_SIZE];
+  uint8_t rd[FIFO_SIZE];
+  for(uint8_t i=0; i<FIFO_SIZE; i++) data[i] = i;
+
+  // rd = 7, wr = 7 + 6
+  tu_fifo_write_n(ff, data, 7);
+  tu_fifo_read_n(ff, rd, 7);
+  tu_fifo_write_n(ff, data, 6);
+
+  TEST_ASSERT_EQUAL(6, tu_fifo_read_acquire(ff, &info, 100));
+  TEST_ASSERT_EQUAL(3, info.len_lin);
+  TEST_ASSERT_EQUAL(3, info.len_wrap);
+  TEST_ASSERT_EQUAL_MEMORY(data, info.ptr_lin, 3);
+  TEST_ASSERT_EQUAL_MEMORY(data+3, info.ptr_wrap, 3);
+
+  // data stays in fifo until released
+  TEST_ASSERT_EQUAL(6, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(4, tu_fifo_read_release(ff, 4));
+  TEST_ASSERT_EQUAL(2, tu_fifo_count(ff));
+
+  TEST_ASSERT_EQUAL(2, tu_fifo_read_n(ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(data+4, rd, 2);
+
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_acquire(ff, &info, 1));
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_release(ff, 1));
+}
+
+void test_reserve_item_size(void)
+{
+
+  TU_FIFO_DEF(ff4, FIFO_SIZE, uint32_t, false);
+  tu_fifo_clear(&ff4);
+
+  uint32_t data[3] = { 1, 2, 3 };
+  tu_fifo_write_n(&ff4, data, 3);
+
+  // spans are in items but pointers must honor item size
+  TEST_ASSERT_EQUAL(2, tu_fifo_write_reserve(&ff4, &info, 2));
+  TEST_ASSERT_EQUAL_PTR(ff4.buffer + 3*sizeof(uint32_t), info.ptr_lin);
+  tu_fifo_write_commit(&ff4, 0);
+
+  tu_fifo_get_read_info(&ff4, &info);
+  TEST_ASSERT_EQUAL(3, info.len_lin);
+  TEST_ASSERT_EQUAL_UINT32_ARRAY(data, info.ptr_lin, 3);
+}
+
+void test_config_max_depth(void)
+{
+  tu_fifo_t ffmax;
+  uint8_t buf[1];
+
+  // buffer is not touched by config, only the index space is checked
+  TEST_ASSERT_TRUE (tu_fifo_config(&ffmax, buf, TU_FIFO_DEPTH_MAX, 1, false));
+  TEST_ASSERT_FALSE(tu_fifo_config(&ffmax, buf, TU_FIFO_DEPTH_MAX+1, 1, false));
+}
+
+void test_write_iov(void)
+{
+  uint8_t rd[FIFO_SIZE];
+
+  // wr = rd = 7 so the block wraps
+  tu_fifo_write_n(ff, "0123456", 7);
+  tu_fifo_read_n(ff, rd, 7);
+
+  tu_fifo_iovec_const_t const iov[] = { { "hd", 2 }, { NULL, 0 }, { "payld", 5 } };
+  TEST_ASSERT_EQUAL(7, tu_fifo_write_iov(ff, iov, 3));
+  TEST_ASSERT_EQUAL(7, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(7, tu_fifo_read_n(ff, rd, sizeof(rd)));
+  TEST_ASSERT_EQUAL_MEMORY("hdpayld", rd, 7);
+
+  // block is written all or nothing
+  tu_fifo_write_n(ff, "01234", 5);
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_iov(ff, iov, 3));
+  TEST_ASSERT_EQUAL(5, tu_fifo_count(ff));
+}
+
+void test_read_iov(void)
+{
+  uint8_t hdr[2], payload[6], rd[FIFO_SIZE];
+
+  // wr = rd = 7 so the data wraps
+  tu_fifo_write_n(ff, "0123456", 7);
+  tu_fifo_read_n(ff, rd, 7);
+  tu_fifo_write_n(ff, "hdpayld", 7);
+
+  memset(payload, 0, sizeof(payload));
+  tu_fifo_iovec_t const iov[] = { { hdr, 2 }, { payload, 6 } };
+  TEST_ASSERT_EQUAL(7, tu_fifo_read_iov(ff, iov, 2));
+  TEST_ASSERT_EQUAL_MEMORY("hd", hdr, 2);
+  TEST_ASSERT_EQUAL_MEMORY("payld", payload, 5);
+  TEST_ASSERT_EQUAL(0, payload[5]);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_iov(ff, iov, 2));
+}
+
+// move both pointers to pos by passing one record through an empty fifo
+static void record_seek(uint8_t pos)
+{
+  uint8_t buf[FIFO_SIZE] = { 0 };
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, buf, pos - TU_FIFO_RECORD_HDR_SIZE));
+  TEST_ASSERT_EQUAL(pos - TU_FIFO_RECORD_HDR_SIZE, tu_fifo_record_read(ff, buf, sizeof(buf)));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_record_write_read(void)
+{
+
+  uint8_t rd[FIFO_SIZE];
+  uint16_t len;
+
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, "ab", 2));
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, NULL, 0));
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, "c", 1));
+  TEST_ASSERT_EQUAL(9, tu_fifo_count(ff));
+
+  TEST_ASSERT_TRUE(tu_fifo_record_peek_len(ff, &len));
+  TEST_ASSERT_EQUAL(2, len);
+  TEST_ASSERT_EQUAL(9, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(2, tu_fifo_record_read(ff, rd, sizeof(rd)));
+  TEST_ASSERT_EQUAL_MEMORY("ab", rd, 2);
+
+  // empty record is kept as such
+  TEST_ASSERT_TRUE(tu_fifo_record_peek_len(ff, &len));
+  TEST_ASSERT_EQUAL(0, len);
+  TEST_ASSERT_EQUAL(0, tu_fifo_record_read(ff, rd, sizeof(rd)));
+
+  // record is truncated to the read buffer
+  TEST_ASSERT_EQUAL(0, tu_fifo_record_read(ff, NULL, 0));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+  TEST_ASSERT_FALSE(tu_fifo_record_peek_len(ff, &len));
+}
+
+void test_record_full(void)
+{
+
+  uint8_t data[FIFO_SIZE] = { 0 };
+
+  TEST_ASSERT_FALSE(tu_fifo_record_write(ff, data, FIFO_SIZE - 1));
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, data, FIFO_SIZE - TU_FIFO_RECORD_HDR_SIZE));
+  TEST_ASSERT_FALSE(tu_fifo_record_write(ff, data, 0));
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(ff));
+
+  // does not fit at the end nor at the start of the buffer
+  tu_fifo_clear(ff);
+  record_seek(5);
+  TEST_ASSERT_FALSE(tu_fifo_record_write(ff, data, 4));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_record_wrap(void)
+{
+
+  uint8_t rd[FIFO_SIZE];
+  uint16_t len;
+
+  // tail of 4 bytes is too short for a 3 byte record and is padded
+  record_seek(6);
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, "xyz", 3));
+  TEST_ASSERT_EQUAL(4 + 5, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL_MEMORY("xyz", ff->buffer + TU_FIFO_RECORD_HDR_SIZE, 3);
+
+  TEST_ASSERT_TRUE(tu_fifo_record_peek_len(ff, &len));
+  TEST_ASSERT_EQUAL(3, len);
+  TEST_ASSERT_EQUAL(3, tu_fifo_record_read(ff, rd, sizeof(rd)));
+  TEST_ASSERT_EQUAL_MEMORY("xyz", rd, 3);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // tail of 1 byte has no room for a pad header
+  tu_fifo_clear(ff);
+  record_seek(9);
+  TEST_ASSERT_TRUE(tu_fifo_record_write(ff, "uv", 2));
+  TEST_ASSERT_EQUAL(1 + 4, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(2, tu_fifo_record_read(ff, rd, sizeof(rd)));
+  TEST_ASSERT_EQUAL_MEMORY("uv", rd, 2);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_record_reserve_commit(void)
+{
+
+  uint16_t len;
+
+  record_seek(6);
+
+  // padded reservation, commit less than reserved
+  uint8_t* buf = (uint8_t*) tu_fifo_record_reserve(ff, 4);
+  TEST_ASSERT_EQUAL_PTR(ff->buffer + TU_FIFO_RECORD_HDR_SIZE, buf);
+  memcpy(buf, "ok", 2);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  TEST_ASSERT_TRUE(tu_fifo_record_commit(ff, 2));
+  TEST_ASSERT_EQUAL(4 + 4, tu_fifo_count(ff));
+  TEST_ASSERT_FALSE(tu_fifo_record_commit(ff, 2));
+
+  uint8_t const* rec = (uint8_t const*) tu_fifo_record_acquire(ff, &len);
+  TEST_ASSERT_EQUAL_PTR(buf, rec);
+  TEST_ASSERT_EQUAL(2, len);
+  TEST_ASSERT_EQUAL_MEMORY("ok", rec, 2);
+  TEST_ASSERT_TRUE(tu_fifo_record_release(ff));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+  TEST_ASSERT_FALSE(tu_fifo_record_release(ff));
+  TEST_ASSERT_NULL(tu_fifo_record_acquire(ff, &len));
+}
+
+void test_hwfifo_read(void)
+{
+  volatile uint32_t reg32 = 0x44332211;
+  volatile uint16_t reg16 = 0x2211;
+  volatile uint8_t  reg8  = 0x11;
+  uint8_t buf[24];
+
+  static const uint8_t expect32[] = { 0x11, 0x22, 0x33, 0x44, 0x11, 0x22, 0x33, 0x44, 0x11, 0x22, 0x33 };
+  static const uint8_t expect16[] = { 0x11, 0x22, 0x11, 0x22, 0x11 };
+
+  // aligned and misaligned destination, with 1-3 byte tail
+  for(uint8_t offset=0; offset<4; offset++)
+  {
+    memset(buf, 0, sizeof(buf));
+    tu_hwfifo_read32(&reg32, buf+offset, 11);
+    TEST_ASSERT_EQUAL_MEMORY(expect32, buf+offset, 11);
+    TEST_ASSERT_EQUAL(0, buf[offset+11]);
+
+    memset(buf, 0, sizeof(buf));
+    tu_hwfifo_read16(&reg16, buf+offset, 5);
+    TEST_ASSERT_EQUAL_MEMORY(expect16, buf+offset, 5);
+    TEST_ASSERT_EQUAL(0, buf[offset+5]);
+
+    memset(buf, 0, sizeof(buf));
+    tu_hwfifo_read8(&reg8, buf+offset, 6);
+    for(uint8_t i=0; i<6; i++) TEST_ASSERT_EQUAL(0x11, buf[offset+i]);
+    TEST_ASSERT_EQUAL(0, buf[offset+6]);
+  }
+}
+
+void test_hwfifo_write(void)
+{
+  volatile uint32_t reg32;
+  volatile uint16_t reg16;
+  volatile uint8_t  reg8;
+  uint8_t buf[24];
+
+  for(uint8_t i=0; i<sizeof(buf); i++) buf[i] = i+1;
+
+  // register holds the last access, trailing bytes are packed LSB first
+  for(uint8_t offset=0; offset<4; offset++)
+  {
+    uint8_t const* src = buf+offset;
+
+    tu_hwfifo_write32(&reg32, src, 16);
+    TEST_ASSERT_EQUAL_HEX32(tu_u32(src[15], src[14], src[13], src[12]), reg32);
+
+    tu_hwfifo_write32(&reg32, src, 19);
+    TEST_ASSERT_EQUAL_HEX32(tu_u32(0, src[18], src[17], src[16]), reg32);
+
+    tu_hwfifo_write16(&reg16, src, 10);
+    TEST_ASSERT_EQUAL_HEX16(tu_u16(src[9], src[8]), reg16);
+
+    tu_hwfifo_write16(&reg16, src, 11);
+    TEST_ASSERT_EQUAL_HEX16(src[10], reg16);
+
+    tu_hwfifo_write8(&reg8, src, 7);
+    TEST_ASSERT_EQUAL(src[6], reg8);
+  }
+}
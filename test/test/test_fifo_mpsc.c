@@ -0,0 +1,162 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "tusb_fifo.h"
+
+// Built with CFG_TUSB_FIFO_MPSC=1, see test-specific defines in project.yml
+
+#define FIFO_SIZE 10
+uint8_t ff_buf[FIFO_SIZE];
+tu_fifo_t tu_ff;
+tu_fifo_t* ff = &tu_ff;
+
+void setUp(void)
+{
+  tu_fifo_config_mpsc(ff, ff_buf, FIFO_SIZE, 1);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_mpsc_write_read(void)
+{
+  uint8_t rd[FIFO_SIZE];
+
+  TEST_ASSERT_TRUE(tu_fifo_write(ff, "a"));
+  TEST_ASSERT_EQUAL(FIFO_SIZE - 1, tu_fifo_write_n(ff, "bcdefghijklm", 12));
+  TEST_ASSERT_FALSE(tu_fifo_write(ff, "x"));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  TEST_ASSERT_EQUAL(4, tu_fifo_read_n(ff, rd, 4));
+  TEST_ASSERT_EQUAL_MEMORY("abcd", rd, 4);
+
+  // claimed index follows the published one across the wrap
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_n(ff, "klmnop", 6));
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY("efghijklmn", rd, FIFO_SIZE);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+  TEST_ASSERT_EQUAL(ff->wr_idx, ff->wr_claim);
+}
+
+void test_mpsc_write_iov(void)
+{
+  tu_fifo_iovec_const_t iov[2] = { { "abc", 3 }, { "defg", 4 } };
+  uint8_t rd[FIFO_SIZE];
+
+  // iov is written completely or not at all
+  TEST_ASSERT_EQUAL(7, tu_fifo_write_iov(ff, iov, 2));
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_iov(ff, iov, 2));
+  TEST_ASSERT_EQUAL(7, tu_fifo_count(ff));
+
+  TEST_ASSERT_EQUAL(7, tu_fifo_read_n(ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY("abcdefg", rd, 7);
+}
+
+void test_mpsc_pending_writer(void)
+{
+  uint8_t rd[FIFO_SIZE];
+
+  // emulate a preempted writer which claimed slots 0..2 and is still copying
+  ff->wr_claim = 3 | (1ul << 16);
+
+  // items of the interrupting writer stay invisible until all writers are done
+  TEST_ASSERT_EQUAL(3, tu_fifo_write_n(ff, "def", 3));
+  TEST_ASSERT_TRUE(tu_fifo_write(ff, "g"));
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // preempted writer finishes without publishing, the next writer publishes everything
+  memcpy(ff->buffer, "abc", 3);
+  ff->wr_claim -= (1ul << 16);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+
+  // space is accounted from the claimed index
+  TEST_ASSERT_EQUAL(FIFO_SIZE - 7, tu_fifo_write_n(ff, "hijklmnop", 9));
+  TEST_ASSERT_FALSE(tu_fifo_write(ff, "x"));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY("abcdefghij", rd, FIFO_SIZE);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+}
+
+void test_mpsc_not_overwritable(void)
+{
+  tu_fifo_t ff8;
+  uint8_t buf[8];
+
+  TEST_ASSERT_FALSE(tu_fifo_set_overwritable(ff, true));
+  TEST_ASSERT_TRUE(tu_fifo_set_overwritable(ff, false));
+
+  // other FIFOs keep their single writer behavior
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff8, buf, 8, 1, true));
+  TEST_ASSERT_TRUE(tu_fifo_set_overwritable(&ff8, false));
+  TEST_ASSERT_TRUE(tu_fifo_set_overwritable(&ff8, true));
+}
+
+void test_mpsc_single_writer_api(void)
+{
+  tu_fifo_buffer_info_t info;
+
+  tu_fifo_write_n(ff, "abc", 3);
+
+  // writing past the claimed index is refused and leaves the indices untouched
+  tu_fifo_get_write_info(ff, &info);
+  TEST_ASSERT_EQUAL(0, info.len_lin + info.len_wrap);
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_reserve(ff, &info, 2));
+  TEST_ASSERT_EQUAL(0, info.len_lin + info.len_wrap);
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_commit(ff, 2));
+  tu_fifo_advance_write_pointer(ff, 2);
+  TEST_ASSERT_FALSE(tu_fifo_record_write(ff, "x", 1));
+
+  TEST_ASSERT_EQUAL(3, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(ff->wr_idx, ff->wr_claim);
+}
+
+void test_mpsc_other_fifo_single_writer(void)
+{
+  tu_fifo_t ff8;
+  uint8_t buf[8];
+  uint8_t rd[8];
+  tu_fifo_buffer_info_t info;
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ff8, buf, 8, 1, true));
+
+  // zero copy write and overwrite are available for FIFOs not configured with tu_fifo_config_mpsc()
+  tu_fifo_get_write_info(&ff8, &info);
+  TEST_ASSERT_EQUAL(8, info.len_lin + info.len_wrap);
+  memcpy(info.ptr_lin, "abcdef", 6);
+  tu_fifo_advance_write_pointer(&ff8, 6);
+
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_n(&ff8, "ghij", 4));
+  TEST_ASSERT_EQUAL(8, tu_fifo_read_n(&ff8, rd, 8));
+  TEST_ASSERT_EQUAL_MEMORY("cdefghij", rd, 8);
+}
@@ -0,0 +1,129 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "tusb_fifo.h"
+
+// Built with CFG_TUSB_FIFO_STATS=1, see test-specific defines in project.yml
+
+#define FIFO_SIZE 10
+TU_FIFO_DEF(tu_ff, FIFO_SIZE, uint8_t, false);
+tu_fifo_t* ff = &tu_ff;
+tu_fifo_stats_t stats;
+
+void setUp(void)
+{
+  tu_fifo_set_overwritable(ff, false);
+  tu_fifo_clear(ff);
+  tu_fifo_reset_stats(ff);
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_stats(void)
+{
+  uint8_t data[FIFO_SIZE+2] = { 0 };
+
+  // 2 items rejected when full, 1 underrun
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_write_n(ff, data, FIFO_SIZE+2));
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, data, FIFO_SIZE+1));
+  TEST_ASSERT_FALSE(tu_fifo_read(ff, data));
+
+  tu_fifo_get_stats(ff, &stats);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, stats.high_water);
+  TEST_ASSERT_EQUAL(2, stats.overflow);
+  TEST_ASSERT_EQUAL(2, stats.underrun);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, stats.bytes_written);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, stats.bytes_read);
+
+  // statistics survive a clear, high-water restarts at the fill level on reset
+  tu_fifo_write_n(ff, data, 3);
+  tu_fifo_clear(ff);
+  tu_fifo_write_n(ff, data, 4);
+  tu_fifo_get_stats(ff, &stats);
+  TEST_ASSERT_EQUAL(FIFO_SIZE + 7, stats.bytes_written);
+
+  tu_fifo_reset_stats(ff);
+  tu_fifo_get_stats(ff, &stats);
+  TEST_ASSERT_EQUAL(4, stats.high_water);
+  TEST_ASSERT_EQUAL(0, stats.overflow);
+  TEST_ASSERT_EQUAL(0, stats.bytes_written);
+
+  // overwritten items count as overflow
+  tu_fifo_set_overwritable(ff, true);
+  tu_fifo_write_n(ff, data, FIFO_SIZE);
+  tu_fifo_set_overwritable(ff, false);
+  tu_fifo_get_stats(ff, &stats);
+  TEST_ASSERT_EQUAL(4, stats.overflow);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, stats.high_water);
+}
+
+void test_stats_zero_copy(void)
+{
+  tu_fifo_buffer_info_t info;
+
+  // reserve/commit and advancing the write pointer count like writes
+  TEST_ASSERT_EQUAL(6, tu_fifo_write_reserve(ff, &info, 6));
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_commit(ff, 4));
+  tu_fifo_advance_write_pointer(ff, 3);
+
+  // acquire/release and advancing the read pointer count like reads
+  TEST_ASSERT_EQUAL(5, tu_fifo_read_acquire(ff, &info, 5));
+  TEST_ASSERT_EQUAL(5, tu_fifo_read_release(ff, 5));
+  tu_fifo_advance_read_pointer(ff, 1);
+
+  tu_fifo_get_stats(ff, &stats);
+  TEST_ASSERT_EQUAL(7, stats.high_water);
+  TEST_ASSERT_EQUAL(7, stats.bytes_written);
+  TEST_ASSERT_EQUAL(6, stats.bytes_read);
+  TEST_ASSERT_EQUAL(0, stats.overflow);
+  TEST_ASSERT_EQUAL(0, stats.underrun);
+}
+
+void test_stats_item_size(void)
+{
+  TU_FIFO_DEF(ff4, 4, uint32_t, false);
+  uint32_t data[5] = { 0 };
+
+  tu_fifo_clear(&ff4);
+  tu_fifo_reset_stats(&ff4);
+
+  // items are counted in overflow and high-water, bytes in the totals
+  TEST_ASSERT_EQUAL(4, tu_fifo_write_n(&ff4, data, 5));
+  TEST_ASSERT_EQUAL(2, tu_fifo_read_n(&ff4, data, 2));
+
+  tu_fifo_get_stats(&ff4, &stats);
+  TEST_ASSERT_EQUAL(4, stats.high_water);
+  TEST_ASSERT_EQUAL(1, stats.overflow);
+  TEST_ASSERT_EQUAL(4*sizeof(uint32_t), stats.bytes_written);
+  TEST_ASSERT_EQUAL(2*sizeof(uint32_t), stats.bytes_read);
+}
@@ -0,0 +1,99 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+#include "tusb_fifo.h"
+
+// Built with CFG_TUSB_FIFO_WIDE_INDEX=1, see test-specific defines in project.yml
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_wide_index_enabled(void)
+{
+  TEST_ASSERT_EQUAL(4, sizeof(tu_fifo_idx_t));
+  TEST_ASSERT_TRUE(TU_FIFO_DEPTH_MAX > UINT16_MAX);
+}
+
+void test_wide_index(void)
+{
+  #define WIDE_DEPTH  100000
+  static uint8_t buf[WIDE_DEPTH];
+  static uint8_t data[WIDE_DEPTH];
+  static uint8_t rd[WIDE_DEPTH];
+  tu_fifo_t ffw;
+
+  for(uint32_t i=0; i<WIDE_DEPTH; i++) data[i] = (uint8_t) (i*7);
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ffw, buf, WIDE_DEPTH, 1, false));
+
+  // wrap around more than 16 bit index space
+  for(uint8_t loop=0; loop<3; loop++)
+  {
+    TEST_ASSERT_EQUAL(70000, tu_fifo_write_n(&ffw, data, 70000));
+    TEST_ASSERT_EQUAL(70000, tu_fifo_count(&ffw));
+    TEST_ASSERT_EQUAL(70000, tu_fifo_read_n(&ffw, rd, WIDE_DEPTH));
+    TEST_ASSERT_EQUAL_MEMORY(data, rd, 70000);
+  }
+
+  TEST_ASSERT_EQUAL(WIDE_DEPTH, tu_fifo_write_n(&ffw, data, WIDE_DEPTH));
+  TEST_ASSERT_TRUE(tu_fifo_full(&ffw));
+}
+
+void test_wide_index_pow2(void)
+{
+  #define WIDE_POW2_DEPTH  (1ul << 17)
+  static uint8_t buf[WIDE_POW2_DEPTH];
+  static uint8_t data[WIDE_POW2_DEPTH];
+  static uint8_t rd[WIDE_POW2_DEPTH];
+  tu_fifo_t ffw;
+
+  for(uint32_t i=0; i<WIDE_POW2_DEPTH; i++) data[i] = (uint8_t) (i*3);
+
+  TEST_ASSERT_TRUE(tu_fifo_config(&ffw, buf, WIDE_POW2_DEPTH, 1, false));
+  TEST_ASSERT_TRUE(ffw.pow2);
+
+  // absolute pointers pass the 2*depth index space several times
+  for(uint8_t loop=0; loop<5; loop++)
+  {
+    TEST_ASSERT_EQUAL(90000, tu_fifo_write_n(&ffw, data, 90000));
+    TEST_ASSERT_EQUAL(WIDE_POW2_DEPTH - 90000, tu_fifo_write_n(&ffw, data + 90000, 90000));
+    TEST_ASSERT_TRUE(tu_fifo_full(&ffw));
+
+    TEST_ASSERT_EQUAL(WIDE_POW2_DEPTH, tu_fifo_read_n(&ffw, rd, WIDE_POW2_DEPTH));
+    TEST_ASSERT_EQUAL_MEMORY(data, rd, WIDE_POW2_DEPTH);
+    TEST_ASSERT_TRUE(ffw.wr_idx < 2*WIDE_POW2_DEPTH);
+  }
+}
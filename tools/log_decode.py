@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+"""Reconstruct TinyUSB deferred log (CFG_TUSB_DEBUG_DEFERRED) text.
+
+Format strings are read from section .tu_log_fmt of the firmware ELF, records
+only carry their offset to tu_log_fmt_base and the raw arguments. Input is
+either the byte stream returned by tu_log_read() (e.g. captured from a UART),
+or a memory dump containing the _tu_log ring e.g. taken with
+    (gdb) dump binary value log.bin _tu_log
+
+    log_decode.py firmware.elf log.bin
+
+Arguments printed with %s are looked up in the loaded sections of the ELF,
+strings only known at runtime are shown as their address. Record layout must
+match src/common/tusb_log.h.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_MAGIC = 0x474f4c54
+LOG_VERSION = 1
+REC_MARK = 0xA5000000
+REC_MARK_MASK = 0xFF000000
+REC_PRINTF, REC_MEM, REC_VAR = 0, 1, 2
+
+FMT_SECTION = '.tu_log_fmt'
+FMT_BASE_SYMBOL = 'tu_log_fmt_base'
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+CONVERSION = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXcsp%])')
+
+
+class Elf:
+    """Just enough of an ELF reader to look up sections, a symbol and strings"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+
+        if self.data[:4] != b'\x7fELF':
+            sys.exit('%s is not an ELF file' % path)
+
+        is64 = self.data[4] == 2
+        self.order = '<' if self.data[5] == 1 else '>'
+
+        if is64:
+            shoff, = struct.unpack_from(self.order + 'Q', self.data, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.order + 'HHH', self.data, 0x3A)
+            sh_fmt = 'IIQQQQIIQQ'
+        else:
+            shoff, = struct.unpack_from(self.order + 'I', self.data, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(self.order + 'HHH', self.data, 0x2E)
+            sh_fmt = 'IIIIIIIIII'
+
+        self.sections = []
+        for i in range(shnum):
+            name, stype, flags, addr, offset, size, link, _, _, entsize = \
+                struct.unpack_from(self.order + sh_fmt, self.data, shoff + i * shentsize)
+            self.sections.append({'name': name, 'type': stype, 'flags': flags, 'addr': addr, 'offset': offset,
+                                  'size': size, 'link': link, 'entsize': entsize})
+
+        strtab = self.sections[shstrndx]
+        for sec in self.sections:
+            sec['name'] = self.cstring(strtab['offset'] + sec['name'])
+
+        self.is64 = is64
+
+    def cstring(self, offset):
+        end = self.data.index(b'\0', offset)
+        return self.data[offset:end].decode('utf-8', 'replace')
+
+    def section(self, name):
+        for sec in self.sections:
+            if sec['name'] == name:
+                return sec
+        return None
+
+    def symbol(self, name):
+        for sec in self.sections:
+            if sec['type'] != SHT_SYMTAB:
+                continue
+            strtab = self.sections[sec['link']]
+            for i in range(sec['size'] // sec['entsize']):
+                off = sec['offset'] + i * sec['entsize']
+                if self.is64:
+                    st_name, _, _, _, st_value, _ = struct.unpack_from(self.order + 'IBBHQQ', self.data, off)
+                else:
+                    st_name, st_value, _, _, _, _ = struct.unpack_from(self.order + 'IIIBBH', self.data, off)
+                if self.cstring(strtab['offset'] + st_name) == name:
+                    return st_value
+        return None
+
+    def string_at(self, addr, sections):
+        for sec in sections:
+            if sec['type'] != SHT_NOBITS and sec['addr'] <= addr < sec['addr'] + sec['size']:
+                return self.cstring(sec['offset'] + addr - sec['addr'])
+        return None
+
+
+class Decoder:
+    def __init__(self, elf):
+        self.elf = elf
+        self.order = elf.order
+
+        self.fmt_section = elf.section(FMT_SECTION)
+        self.fmt_base = elf.symbol(FMT_BASE_SYMBOL)
+        if self.fmt_section is None or self.fmt_base is None:
+            sys.exit('%s or %s not found, firmware not built with CFG_TUSB_DEBUG_DEFERRED' %
+                     (FMT_SECTION, FMT_BASE_SYMBOL))
+
+        # arguments are 32 bit, strings referenced by %s live in loaded sections
+        self.str_sections = [s for s in elf.sections if s['flags'] & SHF_ALLOC and s is not self.fmt_section]
+
+    def format_string(self, fmt_id):
+        addr = (self.fmt_base + struct.unpack('i', struct.pack('I', fmt_id))[0]) & 0xffffffffffffffff
+        fmt = self.elf.string_at(addr, [self.fmt_section])
+        return fmt if fmt is not None else '<unknown format %08X>\n' % fmt_id
+
+    def string_arg(self, addr):
+        for sec in self.str_sections:
+            # arguments are truncated to 32 bit, compare against the truncated address
+            start = sec['addr'] & 0xffffffff
+            if sec['type'] != SHT_NOBITS and start <= addr < start + sec['size']:
+                return self.elf.cstring(sec['offset'] + addr - start)
+        return '<str %08X>' % addr
+
+    def printf(self, fmt, args):
+        args = list(args)
+
+        def next_arg():
+            return args.pop(0) if args else None
+
+        def convert(m):
+            flags, width, prec, _, conv = m.groups()
+            if conv == '%':
+                return '%'
+            if width == '*':
+                width = str(next_arg() or 0)
+            if prec == '*':
+                prec = str(next_arg() or 0)
+            spec = '%' + flags + (width or '') + ('.' + prec if prec is not None else '')
+
+            value = next_arg()
+            if value is None:
+                return '<?>'
+            if conv in 'di':
+                return (spec + 'd') % struct.unpack('i', struct.pack('I', value))[0]
+            if conv == 'u':
+                return (spec + 'd') % value
+            if conv in 'oxX':
+                return (spec + conv) % value
+            if conv == 'c':
+                return (spec + 'c') % (value & 0xff)
+            if conv == 's':
+                return (spec + 's') % self.string_arg(value)
+            return '0x%08x' % value  # %p
+
+        return CONVERSION.sub(convert, fmt)
+
+    @staticmethod
+    def memory(data, total, inline):
+        if inline:
+            return ''.join('%02X ' % b for b in data)
+
+        if not total:
+            return 'NULL\n'
+
+        # same layout as tu_print_mem()
+        lines = []
+        for i in range(0, len(data), 16):
+            row = data[i:i + 16]
+            hexs = ' '.join('%02X' % b for b in row).ljust(16 * 3 - 1)
+            text = ''.join(chr(b) if 32 <= b < 127 else '.' for b in row)
+            lines.append('%04X:  %s  |%s|\n' % (i, hexs, text))
+        if len(data) < total:
+            lines.append('  ... %u of %u bytes logged\n' % (len(data), total))
+        return ''.join(lines)
+
+    def record(self, words):
+        """Decode record from list of words, return (text, words used) or None if incomplete"""
+        if not words or (words[0] & REC_MARK_MASK) != REC_MARK:
+            return None
+
+        rtype = (words[0] >> 16) & 0xff
+        count = words[0] & 0xffff
+        nwords = 2 + (count if rtype == REC_PRINTF else (count + 3) // 4)
+        if len(words) < nwords:
+            return None
+
+        if rtype == REC_PRINTF:
+            return self.printf(self.format_string(words[1]), words[2:nwords]), nwords
+
+        data = b''.join(struct.pack(self.order + 'I', w) for w in words[2:nwords])[:count]
+        return self.memory(data, words[1], rtype == REC_VAR), nwords
+
+    def words(self, data):
+        return list(struct.unpack_from(self.order + '%uI' % (len(data) // 4), data))
+
+    def decode_stream(self, data):
+        words = self.words(data)
+        out = []
+        while words:
+            decoded = self.record(words)
+            if decoded is None:
+                out.append('<%u undecodable words>\n' % len(words))
+                break
+            out.append(decoded[0])
+            words = words[decoded[1]:]
+        return ''.join(out)
+
+    def decode_dump(self, data, offset):
+        _, version, depth, wr_idx, rd_idx, dropped = struct.unpack_from(self.order + '6I', data, offset)
+        if version != LOG_VERSION:
+            sys.exit('unsupported log version %u' % version)
+
+        buf = self.words(data[offset + 24:offset + 24 + depth * 4])
+        if len(buf) < depth:
+            sys.exit('dump truncated: ring of %u words does not fit' % depth)
+
+        pending = [buf[(rd_idx + i) % depth] for i in range((wr_idx - rd_idx) & 0xffffffff)]
+        out = []
+        while pending:
+            decoded = self.record(pending)
+            if decoded is None:
+                break  # record still being written
+            out.append(decoded[0])
+            pending = pending[decoded[1]:]
+
+        if dropped:
+            out.append('<%u records dropped>\n' % dropped)
+        return ''.join(out)
+
+    def decode(self, data):
+        if len(data) >= 4 and (struct.unpack_from(self.order + 'I', data)[0] & REC_MARK_MASK) == REC_MARK:
+            return self.decode_stream(data)
+
+        offset = data.find(struct.pack(self.order + 'I', LOG_MAGIC))
+        if offset < 0:
+            sys.exit('input is neither a record stream nor contains the log ring (magic %08X)' % LOG_MAGIC)
+        return self.decode_dump(data, offset)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Reconstruct TinyUSB deferred log text')
+    parser.add_argument('elf', help='firmware ELF built with CFG_TUSB_DEBUG_DEFERRED')
+    parser.add_argument('log', help='tu_log_read() byte stream or memory dump containing _tu_log')
+    args = parser.parse_args()
+
+    with open(args.log, 'rb') as f:
+        data = f.read()
+
+    text = Decoder(Elf(args.elf)).decode(data)
+    sys.stdout.write(text.replace('\r\n', '\n'))
+
+
+if __name__ == '__main__':
+    main()
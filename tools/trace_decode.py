@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Decode a TinyUSB binary event trace (CFG_TUSB_TRACE) into a timeline.
+
+The input is a memory dump containing the _tusb_trace ring, e.g. taken with
+    (gdb) dump binary value trace.bin _tusb_trace
+A larger dump (e.g. whole RAM) works as well, the ring is located by its magic.
+Byte order is detected from the magic. Record layout and event numbering must
+match src/common/tusb_trace.h.
+
+    trace_decode.py trace.bin                 timestamps in raw ticks
+    trace_decode.py --tick-hz 48000000 trace.bin   timestamps in us
+"""
+
+import argparse
+import struct
+import sys
+
+TRACE_MAGIC = 0x52545554
+TRACE_VERSION = 1
+HEADER_SIZE = 12
+RECORD_SIZE = 12
+
+# dcd_eventid_t and hcd_eventid_t, traced as offset from their range base
+DCD_EVENTS = ['INVALID', 'BUS_RESET', 'UNPLUGGED', 'SOF', 'SUSPEND', 'RESUME', 'SETUP_RECEIVED', 'XFER_COMPLETE',
+              'FUNC_CALL', 'WAKEUP']
+HCD_EVENTS = ['DEVICE_ATTACH', 'DEVICE_REMOVE', 'XFER_COMPLETE', 'FUNC_CALL']
+
+RANGES = {
+    0x00: ('DCD', DCD_EVENTS),
+    0x10: ('USBD_POST', DCD_EVENTS),
+    0x20: ('USBD_GET', DCD_EVENTS),
+    0x40: ('HCD', HCD_EVENTS),
+    0x50: ('USBH_GET', HCD_EVENTS),
+}
+
+EVENTS = {
+    0x30: 'USBD_XFER',
+    0x31: 'USBD_XFER_QUEUE',
+    0x32: 'USBD_CLASS_OPEN',
+    0x33: 'USBD_CLASS_XFER_CB',
+    0x34: 'USBD_CLASS_ISR_CB',
+    0x35: 'USBD_CONTROL_XFER_CB',
+    0x36: 'USBD_QUEUE_OVERFLOW',
+    0x60: 'USBH_XFER',
+    0x61: 'USBH_CLASS_XFER_CB',
+}
+
+XFER_RESULTS = ['SUCCESS', 'FAILED', 'STALLED']
+SPEEDS = ['Full', 'Low', 'High']
+NO_DRIVER = 0xff
+
+
+def lookup(table, idx):
+    return table[idx] if idx < len(table) else str(idx)
+
+
+def find_ring(data):
+    """Return (offset, byte order prefix) of the ring in data"""
+    for order in ('<', '>'):
+        offset = data.find(struct.pack(order + 'I', TRACE_MAGIC))
+        while offset >= 0:
+            version, rec_size = struct.unpack_from(order + 'BB', data, offset + 4)
+            if version == TRACE_VERSION and rec_size == RECORD_SIZE:
+                return offset, order
+            offset = data.find(struct.pack(order + 'I', TRACE_MAGIC), offset + 1)
+    return None
+
+
+def event_name(event):
+    if event in EVENTS:
+        return EVENTS[event]
+    base = event & 0xf0
+    if base in RANGES:
+        prefix, names = RANGES[base]
+        return prefix + ' ' + lookup(names, event & 0x0f)
+    return 'UNKNOWN_%02X' % event
+
+
+def event_details(event, ep_addr, driver, result, length):
+    base = event & 0xf0
+    name = event_name(event)
+    drv = '' if driver == NO_DRIVER else ' drv %u' % driver
+
+    if base in (0x00, 0x10, 0x20):
+        sub = event & 0x0f
+        prio = ' prio %u' % driver if (base == 0x10 and driver != NO_DRIVER) else ''
+        if sub == DCD_EVENTS.index('SETUP_RECEIVED'):
+            return 'bmRequestType %02X bRequest %02X wValue %04X wIndex %04X' % (
+                driver, result, length & 0xffff, length >> 16)
+        if sub == DCD_EVENTS.index('XFER_COMPLETE'):
+            return 'EP %02X %s %u bytes%s' % (ep_addr, lookup(XFER_RESULTS, result), length, prio)
+        if sub == DCD_EVENTS.index('BUS_RESET'):
+            return '%s Speed%s' % (lookup(SPEEDS, length), prio)
+        return prio.strip()
+
+    if base in (0x40, 0x50):
+        if (event & 0x0f) == HCD_EVENTS.index('XFER_COMPLETE'):
+            return 'dev %u EP %02X %s %u bytes' % (driver, ep_addr, lookup(XFER_RESULTS, result), length)
+        return 'dev %u' % driver
+
+    if name in ('USBD_XFER', 'USBD_XFER_QUEUE'):
+        return 'EP %02X %u bytes%s%s' % (ep_addr, length, drv, '' if result else ' REFUSED')
+    if name == 'USBH_XFER':
+        return 'dev %u EP %02X %u bytes%s' % (driver, ep_addr, length, '' if result else ' REFUSED')
+    if name == 'USBD_CLASS_OPEN':
+        return 'itf %u %u bytes%s' % (ep_addr, length, drv)
+    if name == 'USBD_QUEUE_OVERFLOW':
+        return '%s prio %u' % (lookup(DCD_EVENTS, result), driver)
+
+    return 'EP %02X %s %u bytes%s' % (ep_addr, lookup(XFER_RESULTS, result), length, drv)
+
+
+def decode(data, tick_hz):
+    found = find_ring(data)
+    if found is None:
+        sys.exit('trace ring not found (magic %08X)' % TRACE_MAGIC)
+    offset, order = found
+
+    _, _, _, depth, wr_idx = struct.unpack_from(order + 'IBBHI', data, offset)
+    if offset + HEADER_SIZE + depth * RECORD_SIZE > len(data):
+        sys.exit('dump truncated: ring of %u records does not fit' % depth)
+
+    count = min(wr_idx, depth)
+    first = wr_idx - count
+    print('%u records, %u dropped' % (count, first))
+
+    unit = 'us' if tick_hz else 'ticks'
+    print('%10s %14s %12s  %-26s %s' % ('seq', 'time (' + unit + ')', 'delta', 'event', 'details'))
+
+    prev = None
+    for seq in range(first, wr_idx):
+        slot = offset + HEADER_SIZE + (seq % depth) * RECORD_SIZE
+        time, event, ep_addr, driver, result, length = struct.unpack_from(order + 'IBBBBI', data, slot)
+
+        delta = 0 if prev is None else (time - prev) & 0xffffffff
+        prev = time
+        if tick_hz:
+            time_str, delta_str = '%.3f' % (time * 1e6 / tick_hz), '%.3f' % (delta * 1e6 / tick_hz)
+        else:
+            time_str, delta_str = str(time), str(delta)
+
+        print('%10u %14s %12s  %-26s %s' % (seq & 0xffffffff, time_str, '+' + delta_str, event_name(event),
+                                          event_details(event, ep_addr, driver, result, length)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode TinyUSB binary event trace')
+    parser.add_argument('dump', help='binary memory dump containing _tusb_trace')
+    parser.add_argument('--tick-hz', type=float, default=0, help='timestamp tick rate, print times in us')
+    args = parser.parse_args()
+
+    with open(args.dump, 'rb') as f:
+        decode(f.read(), args.tick_hz)
+
+
+if __name__ == '__main__':
+    main()